@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * @file    audio.h
+  * @brief   Effet sonore : échantillonnage de Vp (PA1) et analyse par bandes.
+  *
+  *          TIM6 (TRGO) déclenche les conversions régulières d'ADC1 à
+  *          AUDIO_RATE_HZ ; le DMA (DMA1 canal 1, circulaire) remplit deux
+  *          moitiés de AUDIO_BLOCK échantillons. L'interruption de
+  *          demi-transfert ou de fin de transfert ne fait que signaler la
+  *          moitié prête : l'analyse se fait dans la boucle principale
+  *          pendant que le DMA remplit l'autre moitié.
+  *
+  *          Analyse d'un bloc, en virgule fixe :
+  *          - un filtre de Goertzel par fréquence de AUDIO_BINS (coefficients
+  *            Q14, états 32 bits, produits 64 bits) : deux fréquences par
+  *            bande pour les graves, les médiums et les aigus ;
+  *          - l'énergie du bloc par paires d'échantillons (SMLAD), qui ferme
+  *            la porte de bruit en dessous de AUDIO_GATE_RMS ;
+  *          - un gain automatique par bande (crête à décroissance lente) ;
+  *          - un temps détecté quand les graves dépassent leur moyenne de
+  *            AUDIO_BEAT_RATIO_Q4 / 16, au plus un par AUDIO_BEAT_HOLD_MS.
+  *
+  *          Les graves donnent le rouge, les médiums le vert, les aigus le
+  *          bleu ; un temps ajoute un éclair blanc. Le lissage (attaque
+  *          rapide, retombée lente) est fait à chaque période PWM par
+  *          Audio_Render.
+  *
+  *          Le bloc de 256 échantillons dure 32 ms à 8 kHz ; son analyse
+  *          prend de l'ordre de 0,2 ms à 64 MHz (Audio_GetStats).
+  ******************************************************************************
+  */
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Fréquence d'échantillonnage : TIM6 à 16 MHz après prédiviseur, ARR 1999 */
+#define AUDIO_RATE_HZ           8000U
+
+/* Echantillons par moitié de tampon (pair, pour les paires SMLAD) */
+#define AUDIO_BLOCK             256U
+
+/* Fréquences analysées : k * AUDIO_RATE_HZ / AUDIO_BLOCK */
+#define AUDIO_BINS              6U
+#define AUDIO_BANDS             3U
+
+/* Porte de bruit : valeur efficace minimale du bloc, en pas d'ADC */
+#define AUDIO_GATE_RMS          8U
+
+/* Crête minimale du gain automatique (amplitude de Goertzel) */
+#define AUDIO_AGC_FLOOR         4096U
+
+/* Décroissance de la crête : 1/AUDIO_AGC_DECAY par bloc (~2 s) */
+#define AUDIO_AGC_DECAY         64U
+
+/* Temps : graves au-dessus de 1,5 fois leur moyenne (Q4) */
+#define AUDIO_BEAT_RATIO_Q4     24U
+#define AUDIO_BEAT_HOLD_MS      250U
+
+/* Moyenne des graves : 1/AUDIO_BEAT_AVG de chaque bloc */
+#define AUDIO_BEAT_AVG          16
+
+/**
+ * @brief  Compteurs de l'analyse
+ */
+typedef struct {
+	uint32_t blocks;        /*!< Blocs analysés */
+	uint32_t overruns;      /*!< Moitiés réécrites avant leur analyse */
+	uint32_t beats;         /*!< Temps détectés */
+	uint16_t busy_us;       /*!< Durée de l'analyse du dernier bloc */
+	uint16_t busy_max_us;   /*!< Analyse la plus longue */
+} Audio_Stats_t;
+
+/**
+ * @brief  Démarre ou arrête l'échantillonnage selon l'effet courant, puis
+ *         analyse les moitiés de tampon prêtes
+ * @note   A appeler dans la boucle principale ; l'ADC doit être étalonné
+ *         (Sensor_Init)
+ * @retval None
+ */
+void Audio_Process(void);
+
+/**
+ * @brief  Moitié de tampon remplie par le DMA
+ * @param  half: 0 première moitié, 1 seconde
+ * @note   Appelé sous interruption (DMA1 canal 1)
+ * @retval None
+ */
+void Audio_DMA_Callback(uint8_t half);
+
+/**
+ * @brief  Niveaux lissés de l'effet sonore
+ * @param  r, g, b: reçoivent les niveaux 0..65535
+ * @note   Appelé sous interruption à chaque période PWM (effects.c)
+ * @retval None
+ */
+void Audio_Render(uint16_t *r, uint16_t *g, uint16_t *b);
+
+/**
+ * @brief  Indique si l'échantillonnage est en cours
+ * @retval 1 si TIM6 et le DMA tournent
+ */
+uint8_t Audio_IsRunning(void);
+
+/**
+ * @brief  Compteurs de l'analyse
+ * @retval Pointeur vers les compteurs
+ */
+const Audio_Stats_t *Audio_GetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_H__ */
@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file    boot.h
+  * @brief   Chargeur résident (pages 0 à 3 de la flash) : mise à jour de
+  *          l'application par le port série virtuel, sans SWD.
+  *
+  *          Au reset, le chargeur démarre l'application sauf si elle est
+  *          absente (premier double-mot effacé) ou si l'application a
+  *          demandé la mise à jour (Boot_Request, mot magique en SRAM2).
+  *
+  *          En mise à jour, le chargeur se copie en SRAM2 et s'y exécute :
+  *          l'USB continue d'être servi pendant les effacements et les
+  *          programmations, la page suivante est effacée pendant que la
+  *          courante se remplit. Il se présente comme un CDC simple
+  *          (bcdDevice BOOT_BCD_DEVICE, produit "AnimLED boot").
+  *
+  *          Trames (32 bits en petit boutiste), terminées par le CRC-32
+  *          (celui de zlib) de l'en-tête et des données :
+  *          - BOOT_FRAME_START  arg = taille de l'image, données = CRC-32 de
+  *                              l'image -> réponse
+  *          - BOOT_FRAME_DATA   arg = adresse, données multiples de 8 octets,
+  *                              sans traverser de page, adresses croissantes
+  *          - BOOT_FRAME_END    vérifie l'image relue en flash, la valide et
+  *                              redémarre -> réponse
+  *          Réponse (8 octets) : BOOT_FRAME_SYNC type statut 0 arg. Une
+  *          erreur est signalée une fois ; les trames suivantes sont
+  *          ignorées jusqu'au prochain BOOT_FRAME_START.
+  ******************************************************************************
+  */
+#ifndef __BOOT_H__
+#define __BOOT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "show.h"
+
+/* Réservé dans STM32L412K8TX_FLASH.ld (région BOOT) */
+#define BOOT_BASE               0x08000000UL
+#define BOOT_SIZE               0x2000UL
+#define BOOT_APP_BASE           (BOOT_BASE + BOOT_SIZE)
+#define BOOT_APP_SIZE           (SHOW_BASE - BOOT_APP_BASE)
+
+/* Demande de mise à jour, dernier mot de la SRAM2 (conservée au reset) */
+#define BOOT_REQUEST            (*(__IO uint32_t *)(SRAM2_BASE + SRAM2_SIZE - 4U))
+#define BOOT_REQUEST_MAGIC      0xB007C0DEUL
+
+#define BOOT_BCD_DEVICE         0x0B00U
+
+#define BOOT_FRAME_SYNC         0xB7U
+#define BOOT_FRAME_START        0x01U
+#define BOOT_FRAME_DATA         0x02U
+#define BOOT_FRAME_END          0x03U
+
+/* En-tête : sync type len_l len_h arg(4) */
+#define BOOT_FRAME_HEADER       8U
+#define BOOT_FRAME_MAX          1024U
+
+#define BOOT_OK                 0x00U
+#define BOOT_ERR_CRC            0x01U   /*!< CRC de trame faux */
+#define BOOT_ERR_ADDR           0x02U   /*!< Hors de l'application ou alignement */
+#define BOOT_ERR_SEQ            0x03U   /*!< Trame inattendue (sans START, adresse en arrière) */
+#define BOOT_ERR_FLASH          0x04U   /*!< Effacement ou programmation en échec */
+#define BOOT_ERR_IMAGE          0x05U   /*!< CRC de l'image relue faux */
+
+/**
+ * @brief  Redémarre dans le chargeur
+ * @retval None (ne revient pas)
+ */
+void Boot_Request(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOT_H__ */
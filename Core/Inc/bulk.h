@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+  * @file    bulk.h
+  * @brief   Transport binaire sur l'interface vendeur USB (EP 0x03 / 0x83).
+  *
+  *          Un transfert OUT = une commande ; le point de terminaison reste
+  *          en NAK tant que la boucle principale ne l'a pas traitée, ce qui
+  *          régule l'hôte sans perte.
+  *
+  *          Commandes (16 bits en petit boutiste) :
+  *          - BULK_PKT_UNIVERSE   0 len_l len_h + len canaux à partir du 1
+  *                                (source MERGE_SRC_HOST de la fusion)
+  *          - BULK_PKT_TELEMETRY  -> réponse Bulk_Telemetry_t
+  *          - BULK_PKT_CLOCK      -> réponse Bulk_Clock_t
+  *          - BULK_PKT_WATCHDOG   -> réponse Bulk_Watchdog_t
+  *          - BULK_PKT_LATENCY    [mode] -> réponse Bulk_Latency_t ; le mode
+  *                                (@ref Latency_Mode_t), s'il est donné,
+  *                                remet la mesure à zéro
+  *          - BULK_PKT_SHOW       0 off_l off_h + données -> réponse
+  *                                Bulk_Show_t ; morceau du fichier de
+  *                                spectacle à la position off, multiple
+  *                                de 8 octets. Le morceau 0 commence par
+  *                                l'en-tête (show.h), qui ouvre l'écriture ;
+  *                                un morceau déjà reçu est ignoré.
+  ******************************************************************************
+  */
+#ifndef __BULK_H__
+#define __BULK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "settings.h"
+#include "host.h"
+#include "clock.h"
+#include "watchdog.h"
+#include "latency.h"
+#include "usbd_composite.h"
+
+#define BULK_PKT_UNIVERSE       0xB0U
+#define BULK_PKT_TELEMETRY      0xB1U
+#define BULK_PKT_CLOCK          0xB2U
+#define BULK_PKT_WATCHDOG       0xB3U
+#define BULK_PKT_LATENCY        0xB4U
+#define BULK_PKT_SHOW           0xB5U
+
+/* En-tête d'univers : les canaux restent alignés sur 32 bits */
+#define BULK_UNIVERSE_HEADER    4U
+
+/* En-tête d'un morceau de spectacle, comme celui d'univers */
+#define BULK_SHOW_HEADER        4U
+
+/* Etat renvoyé pour un morceau de spectacle */
+#define BULK_SHOW_OK            0U      /* Programmé, fichier incomplet */
+#define BULK_SHOW_DONE          1U      /* Fichier complet, en-tête programmé */
+#define BULK_SHOW_REJECTED      2U      /* Pas d'écriture ouverte, taille, enregistreur occupé ou flash en échec */
+
+/* Univers complet, arrondi au paquet */
+#define BULK_RX_SIZE            (((BULK_UNIVERSE_HEADER + DMX_UNIVERSE_SIZE) / COMPOSITE_VENDOR_PACKET_SIZE + 1U) \
+		* COMPOSITE_VENDOR_PACKET_SIZE)
+
+/**
+ * @brief  Etat de la carte renvoyé à l'hôte
+ */
+typedef struct {
+	uint8_t type;           /*!< BULK_PKT_TELEMETRY */
+	uint8_t source;         /*!< @ref Output_Source_t */
+	uint8_t dmx;            /*!< Bit n : ligne DMX n présente */
+	uint8_t sync;           /*!< Etat de la synchronisation */
+	uint32_t uptime_ms;     /*!< HAL_GetTick() */
+	uint32_t bpm_x10;       /*!< Tempo courant */
+	uint32_t merge_hash;    /*!< Empreinte de l'univers fusionné */
+	Host_Stats_t host;      /*!< Compteurs du flux SOF */
+	int16_t temperature;    /*!< Température de la puce, 0,1 degré */
+	uint16_t vdda_mv;       /*!< Alimentation analogique mesurée */
+	uint32_t derate;        /*!< Facteur PWM thermique, 65536 sans réduction */
+	uint16_t audio_us;      /*!< Analyse du dernier bloc audio */
+	uint16_t audio_lost;    /*!< Blocs audio perdus (16 bits de poids faible) */
+	uint8_t record;         /*!< Bit 0 : enregistrement, bit 1 : rejeu,
+	                             bit 2 : dernier enregistrement perdu */
+	uint8_t reserved[3];
+} Bulk_Telemetry_t;
+
+/**
+ * @brief  Bilan des profils d'horloge renvoyé à l'hôte
+ */
+typedef struct {
+	uint8_t type;           /*!< BULK_PKT_CLOCK */
+	uint8_t profile;        /*!< @ref Clock_Profile_t courant */
+	uint8_t reserved[2];
+	Clock_Stats_t clock;
+} Bulk_Clock_t;
+
+/**
+ * @brief  Délais des tâches surveillées renvoyés à l'hôte
+ */
+typedef struct {
+	uint8_t type;           /*!< BULK_PKT_WATCHDOG */
+	uint8_t last_valid;     /*!< 1 si last relève un reset IWDG */
+	uint8_t reserved[2];
+	Watchdog_Report_t now;  /*!< Etat courant */
+	Watchdog_Report_t last; /*!< Relevé avant le dernier reset IWDG */
+} Bulk_Watchdog_t;
+
+/**
+ * @brief  Mesure de latence DMX vers lumière renvoyée à l'hôte
+ */
+typedef struct {
+	uint8_t type;           /*!< BULK_PKT_LATENCY */
+	uint8_t mode;           /*!< Valeur de @ref Latency_Mode_t */
+	uint8_t reserved[2];
+	Latency_Stats_t latency;
+} Bulk_Latency_t;
+
+/**
+ * @brief  Accusé d'un morceau de spectacle
+ */
+typedef struct {
+	uint8_t type;           /*!< BULK_PKT_SHOW */
+	uint8_t status;         /*!< BULK_SHOW_OK, BULK_SHOW_DONE ou BULK_SHOW_REJECTED */
+	uint8_t reserved[2];
+	uint32_t next;          /*!< Position du morceau suivant */
+} Bulk_Show_t;
+
+extern USBD_Vendor_ItfTypeDef Bulk_fops;
+
+/**
+ * @brief  Traite la dernière commande reçue et réarme la réception
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Bulk_Process(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BULK_H__ */
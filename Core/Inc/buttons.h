@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+  * @file    buttons.h
+  * @brief   Moteur de boutons SW1..SW3 : capture des fronts par EXTI,
+  *          anti-rebond temporisé par TIM2 CH1 et file d'événements
+  *          (appui, relâchement, appui long, répétition, accord).
+  ******************************************************************************
+  */
+#ifndef __BUTTONS_H__
+#define __BUTTONS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Identifiants des boutons */
+#define BUTTON_SW1              0U
+#define BUTTON_SW2              1U
+#define BUTTON_SW3              2U
+#define BUTTON_COUNT            3U
+
+#define BUTTON_MASK(id)         (1U << (id))
+
+/* Niveau lu sur la broche quand le bouton est enfoncé (tirage externe) */
+#define BUTTON_ACTIVE_STATE     GPIO_PIN_RESET
+
+/* Temporisations (ms) */
+#define BUTTON_DEBOUNCE_MS      20U
+#define BUTTON_LONG_MS          600U
+#define BUTTON_REPEAT_MS        100U
+#define BUTTON_CHORD_MS         80U
+
+/* Profondeur de la file d'événements (puissance de 2) */
+#define BUTTON_QUEUE_SIZE       16U
+
+/**
+ * @brief  Types d'événements boutons
+ */
+typedef enum {
+	BUTTON_EVT_PRESS = 0,   /*!< Appui validé après anti-rebond */
+	BUTTON_EVT_RELEASE,     /*!< Relâchement validé */
+	BUTTON_EVT_LONG,        /*!< Maintien au-delà de BUTTON_LONG_MS */
+	BUTTON_EVT_REPEAT,      /*!< Répétition automatique après l'appui long */
+	BUTTON_EVT_CHORD        /*!< Plusieurs boutons enfoncés ensemble */
+} Button_EventType_t;
+
+/**
+ * @brief  Evénement bouton
+ */
+typedef struct {
+	uint8_t type;           /*!< Valeur de @ref Button_EventType_t */
+	uint8_t button;         /*!< Identifiant du bouton (BUTTON_SWx) */
+	uint8_t mask;           /*!< Boutons enfoncés au moment de l'événement */
+	uint8_t repeat;         /*!< Nombre de répétitions (saturé à 255) */
+	uint32_t time;          /*!< Horodatage TIM2 : premier front pour un appui
+	                             ou un relâchement, échéance sinon */
+} Button_Event_t;
+
+/**
+ * @brief  Initialise le moteur de boutons (état initial des broches)
+ * @note   TIM2 doit être démarré en base de temps avant l'appel
+ * @retval None
+ */
+void Buttons_Init(void);
+
+/**
+ * @brief  Retire le prochain événement de la file
+ * @param  evt: événement retourné
+ * @retval 1 si un événement a été lu, 0 si la file est vide
+ */
+uint8_t Buttons_GetEvent(Button_Event_t *evt);
+
+/**
+ * @brief  Indique si des événements attendent dans la file
+ * @retval 1 si la file n'est pas vide
+ */
+uint8_t Buttons_Pending(void);
+
+/**
+ * @brief  Masque des boutons actuellement enfoncés (état stable)
+ * @retval Masque BUTTON_MASK()
+ */
+uint8_t Buttons_GetState(void);
+
+/**
+ * @brief  A appeler depuis HAL_GPIO_EXTI_Callback
+ * @param  GPIO_Pin: broche ayant déclenché l'interruption
+ * @retval None
+ */
+void Buttons_EXTI_Callback(uint16_t GPIO_Pin);
+
+/**
+ * @brief  A appeler sur l'échéance de TIM2 CH1
+ * @retval None
+ */
+void Buttons_Timer_Callback(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BUTTONS_H__ */
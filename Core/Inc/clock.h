@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file    clock.h
+  * @brief   Profils d'horloge : pleine vitesse ou économie.
+  *
+  *          - CLOCK_PROFILE_FULL : 64 MHz par la PLL, plage de tension 1,
+  *            3 états d'attente flash (SystemClock_Config) ;
+  *          - CLOCK_PROFILE_ECO : 16 MHz directement sur HSI16, PLL arrêtée,
+  *            plage de tension 2, 2 états d'attente.
+  *
+  *          16 MHz est la seule fréquence de la plage 2 (26 MHz au plus)
+  *          dont la base de temps TIM2 à 16 MHz est un diviseur entier.
+  *          Au changement de profil, les diviseurs de TIM2, TIM6 et TIM15
+  *          et la période de TIM1 sont recalculés : base de temps,
+  *          échantillonnage audio, capture de synchronisation et fréquence
+  *          PWM ne changent pas. Les USART et
+  *          l'I2C de l'écran sont cadencés par HSI16, leurs débits ne
+  *          dépendent pas du profil.
+  *
+  *          La pleine vitesse est exigée par l'USB (plage 1 seulement),
+  *          le menu, le ruban de LED (temps de bit en ticks à 64 MHz),
+  *          l'enregistrement et la synchronisation ; l'économie est prise
+  *          après CLOCK_ECO_DELAY_MS sans aucune de ces demandes, c'est à
+  *          dire en fonctionnement établi DMX vers PWM.
+  ******************************************************************************
+  */
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+#define CLOCK_FULL_HZ           64000000UL
+#define CLOCK_ECO_HZ            16000000UL
+
+/* Courant typique coeur et flash de la fiche technique, en uA (3,3 V) */
+#define CLOCK_FULL_UA           5400U
+#define CLOCK_ECO_UA            1300U
+#define CLOCK_SUPPLY_MV         3300U
+
+/* Délai sans demande de pleine vitesse avant le passage en économie */
+#define CLOCK_ECO_DELAY_MS      2000U
+
+/**
+ * @brief  Profils d'horloge
+ */
+typedef enum {
+	CLOCK_PROFILE_FULL = 0,
+	CLOCK_PROFILE_ECO,
+	CLOCK_PROFILE_COUNT
+} Clock_Profile_t;
+
+/**
+ * @brief  Bilan par profil
+ */
+typedef struct {
+	uint32_t time_ms[CLOCK_PROFILE_COUNT];          /*!< Durée passée dans le profil */
+	uint32_t energy_mj[CLOCK_PROFILE_COUNT];        /*!< Energie estimée (CLOCK_xxx_UA) */
+	uint32_t switches;                              /*!< Changements de profil */
+	uint16_t latency_us[CLOCK_PROFILE_COUNT];       /*!< Dernier passage vers le profil */
+	uint16_t latency_max_us[CLOCK_PROFILE_COUNT];   /*!< Passage le plus long */
+} Clock_Stats_t;
+
+/**
+ * @brief  Relève les réglages des timers à pleine vitesse
+ * @note   A appeler une fois les timers initialisés, profil FULL
+ * @retval None
+ */
+void Clock_Init(void);
+
+/**
+ * @brief  Change de profil et recalcule les timers
+ * @param  profile: valeur de @ref Clock_Profile_t
+ * @retval None
+ */
+void Clock_SetProfile(uint8_t profile);
+
+/**
+ * @brief  Profil courant
+ * @retval Valeur de @ref Clock_Profile_t
+ */
+uint8_t Clock_GetProfile(void);
+
+/**
+ * @brief  Choisit le profil selon les demandes de pleine vitesse
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Clock_Process(void);
+
+/**
+ * @brief  Rétablit les horloges du profil courant au sortir du mode Stop
+ * @note   Le réveil se fait sur HSI16, PLL et HSI48 arrêtées
+ * @retval None
+ */
+void Clock_Restore(void);
+
+/**
+ * @brief  Bilan des profils, durée du profil courant comprise
+ * @retval Pointeur sur le bilan mis à jour
+ */
+const Clock_Stats_t *Clock_GetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_H__ */
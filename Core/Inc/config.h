@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file    config.h
+  * @brief   Réglages enregistrés en flash : clés et valeurs sur deux pages
+  *          dédiées (fin de la flash), en écriture par ajout.
+  *
+  *          Chaque page commence par un en-tête (CONFIG_MAGIC, numéro de
+  *          génération) ; la page active est celle de plus haute génération.
+  *          Une écriture ajoute un enregistrement à la suite des précédents
+  *          sans rien effacer ; la dernière valeur d'une clé fait foi. Page
+  *          pleine, la dernière valeur de chaque clé est recopiée dans
+  *          l'autre page, effacée au préalable, puis son en-tête est
+  *          programmé en dernier : une coupure pendant la recopie laisse
+  *          l'ancienne page active. L'usure est ainsi répartie sur les deux
+  *          pages, un effacement pour 256 écritures de petites valeurs.
+  *
+  *          Enregistrement : clé (octet), longueur (octet), empreinte sur 16
+  *          bits de la clé, de la longueur et de la valeur, puis la valeur,
+  *          complété à un multiple de 8 octets. Un enregistrement tronqué
+  *          par une coupure est ignoré.
+  *
+  *          Au démarrage, la page active est parcourue une fois et la
+  *          position de la dernière valeur de chaque clé est notée en RAM :
+  *          une lecture est un simple accès indexé, et le parcours est borné
+  *          par la taille de la page quel que soit le nombre d'écritures
+  *          passées.
+  ******************************************************************************
+  */
+#ifndef __CONFIG_H__
+#define __CONFIG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Réservé dans STM32L412K8TX_FLASH.ld, après le spectacle */
+#define CONFIG_BASE             0x0800F000UL
+#define CONFIG_PAGES            2U
+
+/* "CFG1" : à changer avec le format des enregistrements */
+#define CONFIG_MAGIC            0x31474643UL
+
+/* Taille maximale d'une valeur */
+#define CONFIG_VALUE_MAX        60U
+
+/**
+ * @brief  Clés enregistrées ; les numéros sont ceux de la flash et ne
+ *         doivent pas changer
+ */
+typedef enum {
+	CONFIG_KEY_DMX_ADDRESS = 0,
+	CONFIG_KEY_PERSONALITY = 1,
+	CONFIG_KEY_LOSS_POLICY = 2,
+	CONFIG_KEY_CONTRAST = 3,
+	CONFIG_KEY_EFFECT = 4,
+	CONFIG_KEY_SYNC_MODE = 5,
+	CONFIG_KEY_RX2_MODE = 6,
+	CONFIG_KEY_MERGE_MODE = 7,
+	CONFIG_KEY_OUTPUT_MODE = 8,
+	CONFIG_KEY_COUNT
+} Config_Key_t;
+
+/**
+ * @brief  Choisit la page active et relève la dernière valeur de chaque clé
+ * @note   Efface et initialise une page si aucune n'est valide (premier
+ *         démarrage, ~22 ms)
+ * @retval None
+ */
+void Config_Init(void);
+
+/**
+ * @brief  Dernière valeur enregistrée d'une clé
+ * @param  key: valeur de @ref Config_Key_t
+ * @param  len: reçoit la longueur de la valeur
+ * @retval Valeur en flash, NULL si la clé n'a jamais été écrite
+ */
+const uint8_t *Config_Get(uint8_t key, uint8_t *len);
+
+/**
+ * @brief  Enregistre une valeur, sauf si elle est identique à la dernière
+ * @param  key: valeur de @ref Config_Key_t
+ * @param  data: valeur
+ * @param  len: longueur, au plus CONFIG_VALUE_MAX
+ * @note   Bloque ~90 us par double-mot, ~22 ms de plus quand la page
+ *         active est pleine (recopie dans l'autre page)
+ * @retval HAL_OK ou code d'erreur
+ */
+HAL_StatusTypeDef Config_Set(uint8_t key, const void *data, uint8_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONFIG_H__ */
@@ -0,0 +1,102 @@
+/**
+  ******************************************************************************
+  * @file    cue.h
+  * @brief   Conduite : liste de cues datés à la microseconde, jouée depuis
+  *          l'emplacement du spectacle.
+  *
+  *          Chaque cue est déclenché par une comparaison de TIM2 CH2 à son
+  *          échéance exacte : ni la charge de la boucle principale ni le
+  *          retard d'une interruption ne décalent la suite, les échéances
+  *          étant calculées depuis la précédente et non depuis l'instant
+  *          de traitement.
+  *
+  *          Format (à la suite de l'en-tête Show_Header_t) : CUE_TAG, le
+  *          nombre de cues (32 bits), puis les cues triés par date
+  *          croissante (Cue_t, 8 octets). Les cues sont lus un à un en
+  *          flash, seul l'index courant est gardé en RAM.
+  *
+  *          La conduite prend les sorties quand ni l'hôte ni le DMX ne
+  *          les pilotent, à la place des effets autonomes, et repart du
+  *          début à chaque reprise.
+  ******************************************************************************
+  */
+#ifndef __CUE_H__
+#define __CUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* "CUE1" */
+#define CUE_TAG                 0x31455543UL
+
+/* Attente maximale programmée d'un coup (ticks TIM2 < 2^31) */
+#define CUE_MAX_WAIT_US         60000000UL
+
+/**
+ * @brief  Types de cues
+ */
+typedef enum {
+	CUE_SCENE = 0,          /*!< Couleur arg R, G, B appliquée à l'échéance */
+	CUE_FADE,               /*!< Fondu vers R, G, B, atteint au cue suivant */
+	CUE_EFFECT,             /*!< Effet arg[0] calé sur l'échéance, tempo
+	                             arg[1..2] en BPM x 10 (0 : inchangé) */
+	CUE_LOOP,               /*!< Retour au début de la liste */
+	CUE_TYPE_COUNT
+} Cue_Type_t;
+
+/**
+ * @brief  Cue, 8 octets
+ */
+typedef struct {
+	uint32_t time;          /*!< Echéance en us depuis le début */
+	uint8_t type;           /*!< Valeur de @ref Cue_Type_t */
+	uint8_t arg[3];
+} Cue_t;
+
+/**
+ * @brief  Arrête la conduite
+ * @note   TIM2 doit être démarré en base de temps avant l'appel
+ * @retval None
+ */
+void Cue_Init(void);
+
+/**
+ * @brief  Démarre la conduite si elle ne tourne pas
+ * @note   Appelée par la boucle principale quand les sorties sont libres
+ * @retval 1 si une conduite valide est en cours
+ */
+uint8_t Cue_Play(void);
+
+/**
+ * @brief  Arrête la conduite et rend l'effet choisi avant son départ
+ * @retval None
+ */
+void Cue_Stop(void);
+
+/**
+ * @brief  Source de sortie demandée par la conduite
+ * @retval OUTPUT_SRC_EFFECT après un cue CUE_EFFECT, OUTPUT_SRC_CUE sinon
+ */
+uint8_t Cue_GetSource(void);
+
+/**
+ * @brief  A appeler sur l'échéance de TIM2 CH2
+ * @retval None
+ */
+void Cue_Timer_Callback(void);
+
+/**
+ * @brief  Avance le fondu en cours
+ * @note   A appeler à chaque période PWM, comme les effets
+ * @retval None
+ */
+void Cue_Update(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CUE_H__ */
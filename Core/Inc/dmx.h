@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file    dmx.h
+  * @brief   Réception DMX512 par DMA sur deux lignes.
+  *
+  *          Ligne A : USART1 (PB7), DMA1 canal 5.
+  *          Ligne B : USART2 sur PA3 (RX2), DMA1 canal 6. PA3 est partagé
+  *                    avec l'entrée de synchronisation (TIM15 CH2) : la
+  *                    ligne B n'existe que lorsqu'elle est sélectionnée.
+  ******************************************************************************
+  */
+#ifndef __DMX_H__
+#define __DMX_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "settings.h"
+
+#define DMX_LINE_A              0U
+#define DMX_LINE_B              1U
+#define DMX_LINE_COUNT          2U
+
+/* Code de départ des trames de niveaux */
+#define DMX_START_CODE          0x00U
+
+/* Absence de trame au-delà de laquelle une ligne est perdue (ms) */
+#define DMX_LOSS_TIMEOUT_MS     1000U
+
+/* Carte des canaux modifiés : un bit par canal */
+#define DMX_CHANGED_WORDS       (DMX_UNIVERSE_SIZE / 32U)
+
+/* Empreinte de trame (FNV-1a sur des mots de 32 bits) */
+#define DMX_HASH_SEED           2166136261UL
+#define DMX_HASH_PRIME          16777619UL
+
+/**
+ * @brief  Univers reçu, recopié hors interruption
+ */
+typedef struct {
+	uint8_t slots[DMX_UNIVERSE_SIZE] __attribute__((aligned(4))); /*!< Canal 1 en slots[0] */
+	uint16_t length;        /*!< Canaux présents dans la trame (les suivants valent 0) */
+	uint32_t tick;          /*!< HAL_GetTick() à la réception */
+	uint32_t changed[DMX_CHANGED_WORDS]; /*!< Bit n : canal n+1 modifié depuis la trame précédente */
+	uint32_t hash;          /*!< Empreinte des 512 canaux */
+} Dmx_Universe_t;
+
+extern UART_HandleTypeDef huart2;
+extern DMA_HandleTypeDef hdma_usart2_rx;
+
+/**
+ * @brief  Démarre la réception sur la ligne A
+ * @retval None
+ */
+void Dmx_Init(void);
+
+/**
+ * @brief  Attribue PA3 à la ligne B (USART2) ou à la synchronisation
+ * @param  enable: 1 pour la ligne B, 0 pour rendre PA3 à TIM15
+ * @retval None
+ */
+void Dmx_SetLineB(uint8_t enable);
+
+/**
+ * @brief  Recopie la dernière trame complète d'une ligne si elle est nouvelle
+ * @param  line: DMX_LINE_A ou DMX_LINE_B
+ * @param  u: univers de destination
+ * @retval 1 si une nouvelle trame a été recopiée
+ */
+uint8_t Dmx_Poll(uint8_t line, Dmx_Universe_t *u);
+
+/**
+ * @brief  Compare deux univers par mots de 32 bits (4 canaux)
+ * @param  cur, prev: univers alignés sur 32 bits
+ * @param  changed: carte des canaux modifiés, complétée (OU) sur la plage
+ * @param  first, last: plage de mots [first, last)
+ * @param  hash: empreinte accumulée jusqu'au mot first
+ * @retval Empreinte accumulée jusqu'au mot last
+ */
+uint32_t Dmx_Compare(const uint32_t *cur, const uint32_t *prev, uint32_t *changed,
+		uint16_t first, uint16_t last, uint32_t hash);
+
+/**
+ * @brief  Indique si une plage de canaux a changé
+ * @param  changed: carte des canaux modifiés
+ * @param  first: premier canal (indice 0 = canal 1)
+ * @param  count: nombre de canaux
+ * @retval 1 si au moins un canal de la plage a changé
+ */
+uint8_t Dmx_RangeChanged(const uint32_t *changed, uint16_t first, uint16_t count);
+
+/**
+ * @brief  Choisit le canal repère de la ligne A, daté à sa réception
+ * @param  slot: canal 1..512, 0 sans repère
+ * @note   Effectif à la trame suivante ; sans ISR_FAST_PATH, aucune trame
+ *         n'est datée
+ * @retval None
+ */
+void Dmx_SetMarker(uint16_t slot);
+
+/**
+ * @brief  Date du canal repère dans la dernière trame rendue par Dmx_Poll
+ * @param  line: DMX_LINE_A ou DMX_LINE_B
+ * @param  stamp: reçoit TIMEBASE_NOW() à la réception du canal repère
+ * @note   Une date n'est rendue qu'une fois
+ * @retval 1 si la trame est datée
+ */
+uint8_t Dmx_GetStamp(uint8_t line, uint32_t *stamp);
+
+/**
+ * @brief  Ancienneté de la dernière trame valide
+ * @param  line: DMX_LINE_A ou DMX_LINE_B
+ * @retval Age en ms, 0xFFFFFFFF si aucune trame ou ligne inactive
+ */
+uint32_t Dmx_GetAge(uint8_t line);
+
+/**
+ * @brief  Indique si une ligne reçoit des trames
+ * @param  line: DMX_LINE_A ou DMX_LINE_B
+ * @retval 1 si une trame a été reçue depuis moins de DMX_LOSS_TIMEOUT_MS
+ */
+uint8_t Dmx_IsPresent(uint8_t line);
+
+/**
+ * @brief  A appeler depuis HAL_UART_ErrorCallback (BREAK = erreur de trame)
+ * @param  huart: pointeur vers le handle UART
+ * @retval None
+ */
+void Dmx_UART_ErrorCallback(UART_HandleTypeDef *huart);
+
+/**
+ * @brief  A appeler depuis HAL_UART_RxHalfCpltCallback (256 canaux reçus)
+ * @param  huart: pointeur vers le handle UART
+ * @retval None
+ */
+void Dmx_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart);
+
+/**
+ * @brief  A appeler depuis HAL_UART_RxCpltCallback (trame trop longue)
+ * @param  huart: pointeur vers le handle UART
+ * @retval None
+ */
+void Dmx_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+
+#if ISR_FAST_PATH
+/**
+ * @brief  Gestionnaire direct de l'interruption USART d'une ligne
+ * @param  line: DMX_LINE_A ou DMX_LINE_B
+ * @retval None
+ */
+void Dmx_UART_IRQHandler(uint8_t line);
+
+/**
+ * @brief  Gestionnaire direct de l'interruption du canal DMA d'une ligne
+ * @param  line: DMX_LINE_A ou DMX_LINE_B
+ * @retval None
+ */
+void Dmx_DMA_IRQHandler(uint8_t line);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DMX_H__ */
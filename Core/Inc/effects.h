@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file    effects.h
+  * @brief   Effets autonomes calés sur la phase du tempo.
+  ******************************************************************************
+  */
+#ifndef __EFFECTS_H__
+#define __EFFECTS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Durée de l'éclair stroboscopique en fraction de temps (Q32 : 1/16) */
+#define EFFECTS_STROBE_WIDTH    0x10000000UL
+
+/* Nombre de temps pour un tour de roue chromatique (puissance de 2) */
+#define EFFECTS_RAINBOW_BEATS   4U
+
+/**
+ * @brief  Calcule l'effet courant (Settings.effect) et l'applique aux
+ *         sorties si elles sont attribuées aux effets
+ * @param  phase: phase dans le temps courant (Q32)
+ * @param  beats: nombre de temps écoulés
+ * @note   Appelé sous interruption à chaque période PWM
+ * @retval None
+ */
+void Effects_Update(uint32_t phase, uint32_t beats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EFFECTS_H__ */
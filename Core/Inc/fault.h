@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file    fault.h
+  * @brief   Relevé des défauts du processeur et redémarrage immédiat.
+  *
+  *          NMI, HardFault, MemManage, BusFault et UsageFault entrent par
+  *          FAULT_ENTRY (gestionnaires sans prologue, stm32l4xx_it.c) : le
+  *          cadre empilé par le processeur, les registres de diagnostic
+  *          (CFSR, HFSR, MMFAR, BFAR) et les adresses de retour trouvées
+  *          sur la pile sont relevés en SRAM2 conservée (retain.h), puis la
+  *          carte redémarre aussitôt ; les sorties sont rétablies depuis
+  *          l'état conservé.
+  *
+  *          Au démarrage suivant, le relevé est signalé sur la ligne d'état
+  *          de l'écran jusqu'à l'ouverture du menu, et lisible par l'hôte
+  *          (HOST_PKT_FAULT, host.h).
+  ******************************************************************************
+  */
+#ifndef __FAULT_H__
+#define __FAULT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Adresses de retour relevées sur la pile, et mots examinés au plus */
+#define FAULT_TRACE_DEPTH       8U
+#define FAULT_SCAN_WORDS        128U
+
+/**
+ * @brief  Entrée d'un gestionnaire de défaut déclaré naked : cadre empilé
+ *         (MSP ou PSP selon EXC_RETURN) et EXC_RETURN passés à Fault_Capture
+ */
+#define FAULT_ENTRY()           __asm volatile ( \
+		"tst lr, #4\n\t" \
+		"ite eq\n\t" \
+		"mrseq r0, msp\n\t" \
+		"mrsne r0, psp\n\t" \
+		"mov r1, lr\n\t" \
+		"b Fault_Capture")
+
+/**
+ * @brief  Relevé d'un défaut
+ */
+typedef struct {
+	uint32_t exception;     /*!< Numéro d'exception : 2 NMI, 3 HardFault, 4 MemManage,
+	                             5 BusFault, 6 UsageFault ; 0 : aucun relevé */
+	uint32_t r0;
+	uint32_t r1;
+	uint32_t r2;
+	uint32_t r3;
+	uint32_t r12;
+	uint32_t lr;
+	uint32_t pc;            /*!< Instruction fautive (ou suivante, défaut imprécis) */
+	uint32_t xpsr;
+	uint32_t sp;            /*!< Pile avant l'empilement du cadre */
+	uint32_t exc_return;
+	uint32_t cfsr;
+	uint32_t hfsr;
+	uint32_t mmfar;
+	uint32_t bfar;
+	uint32_t uptime_ms;     /*!< HAL_GetTick() au défaut */
+	uint32_t count;         /*!< Défauts depuis la mise sous tension */
+	uint32_t trace[FAULT_TRACE_DEPTH];  /*!< Adresses de retour probables, 0 au-delà */
+} Fault_Info_t;
+
+/**
+ * @brief  Reprend le relevé du démarrage précédent et active MemManage,
+ *         BusFault et UsageFault
+ * @note   A appeler après Retain_Init
+ * @retval None
+ */
+void Fault_Init(void);
+
+/**
+ * @brief  Relève le défaut et redémarre
+ * @param  frame: cadre empilé (r0 r1 r2 r3 r12 lr pc xpsr)
+ * @param  exc_return: valeur de LR à l'entrée du gestionnaire
+ * @note   Appelée par FAULT_ENTRY uniquement
+ * @retval None (ne revient pas)
+ */
+void Fault_Capture(uint32_t *frame, uint32_t exc_return) __attribute__((noreturn, used));
+
+/**
+ * @brief  Dernier défaut relevé
+ * @retval Pointeur sur le relevé, NULL si aucun
+ */
+const Fault_Info_t *Fault_Get(void);
+
+/**
+ * @brief  Indique si le défaut relevé n'a pas encore été vu
+ * @retval 1 si le redémarrage est dû à ce défaut et n'a pas été acquitté
+ */
+uint8_t Fault_IsPending(void);
+
+/**
+ * @brief  Acquitte le défaut relevé, qui reste lisible
+ * @retval None
+ */
+void Fault_Acknowledge(void);
+
+/**
+ * @brief  Efface le relevé
+ * @retval None
+ */
+void Fault_Clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FAULT_H__ */
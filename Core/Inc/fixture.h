@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    fixture.h
+  * @brief   Projecteur DMX : lecture des canaux selon la personnalité et
+  *          l'adresse, et comportement en cas de perte du signal.
+  ******************************************************************************
+  */
+#ifndef __FIXTURE_H__
+#define __FIXTURE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Durée de l'extinction progressive (politique LOSS_FADE) */
+#define FIXTURE_FADE_MS         2000U
+
+/**
+ * @brief  Réinitialise l'état du projecteur (aucun DMX reçu)
+ * @retval None
+ */
+void Fixture_Init(void);
+
+/**
+ * @brief  Applique les nouvelles trames fusionnées ou la politique de perte
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Fixture_Process(void);
+
+/**
+ * @brief  Indique si le DMX doit piloter les sorties
+ * @retval 1 si un signal a été reçu et que la politique de perte ne rend
+ *         pas la main aux effets autonomes
+ */
+uint8_t Fixture_IsActive(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FIXTURE_H__ */
@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    flash.h
+  * @brief   Effacement et programmation de la flash interne (pages de 2 Ko,
+  *          double-mots de 64 bits).
+  *
+  *          La L412 n'a qu'une banque : pendant un effacement (~22 ms) ou une
+  *          programmation (~90 us), l'exécution depuis la flash est suspendue,
+  *          interruptions comprises.
+  ******************************************************************************
+  */
+#ifndef __FLASH_H__
+#define __FLASH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Granularité de programmation */
+#define FLASH_DWORD_SIZE        8U
+
+/**
+ * @brief  Efface la page contenant une adresse
+ * @param  addr: adresse dans la page
+ * @retval HAL_OK ou code d'erreur
+ */
+HAL_StatusTypeDef Flash_ErasePage(uint32_t addr);
+
+/**
+ * @brief  Programme une zone déjà effacée
+ * @param  addr: adresse alignée sur 8 octets
+ * @param  data: données
+ * @param  len: nombre d'octets, multiple de FLASH_DWORD_SIZE
+ * @retval HAL_OK ou code d'erreur
+ */
+HAL_StatusTypeDef Flash_Program(uint32_t addr, const void *data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FLASH_H__ */
@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    host.h
+  * @brief   Pilotage des sorties par l'hôte USB (port série virtuel).
+  *
+  *          L'hôte envoie une image RGB par trame USB (1 ms). Chaque image
+  *          reçue pendant la trame N est appliquée au SOF de la trame N+1 :
+  *          TIM1 est alors recalé sur le SOF (période de 1 ms, compteur
+  *          remis à zéro et comparaisons chargées par une mise à jour
+  *          logicielle), la latence est constante à une trame près.
+  *
+  *          Paquets (octets, 16 bits en petit boutiste) :
+  *          - HOST_PKT_RGB8  seq r g b
+  *          - HOST_PKT_RGB16 seq rl rh gl gh bl bh
+  *          - HOST_PKT_STATS reset  -> réponse HOST_PKT_STATS + Host_Stats_t
+  *          - HOST_PKT_BOOT  'B' 'O' 'O' 'T'  -> redémarrage dans le chargeur
+  *          - HOST_PKT_FAULT clear  -> réponse HOST_PKT_FAULT + Fault_Info_t
+  *                                     (exception 0 : aucun défaut relevé)
+  ******************************************************************************
+  */
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+#define HOST_PKT_STATS          0xA0U
+#define HOST_PKT_RGB8           0xA1U
+#define HOST_PKT_RGB16          0xA2U
+#define HOST_PKT_BOOT           0xA3U
+#define HOST_PKT_FAULT          0xA4U
+
+/* Période PWM verrouillée sur le SOF : 64 MHz / 1 kHz */
+#define HOST_SOF_TICKS          64000U
+
+/* SOF arrivé moins de 20 us après un débordement : la période est déjà
+   terminée, la remise à zéro ne produit pas de mise à jour en plus */
+#define HOST_SOF_GUARD          1280U
+
+/* Silence de l'hôte au-delà duquel les sorties lui sont reprises (ms) */
+#define HOST_STREAM_TIMEOUT_MS  100U
+
+/**
+ * @brief  Compteurs du flux, remis à zéro par HOST_PKT_STATS
+ */
+typedef struct {
+	uint32_t frames;        /*!< Images appliquées */
+	uint32_t late;          /*!< SOF sans nouvelle image (précédente répétée) */
+	uint32_t dropped;       /*!< Images remplacées avant d'être appliquées */
+	uint32_t lost;          /*!< Images manquantes d'après les numéros */
+	int32_t drift_ppm;      /*!< Ecart moyen entre SOF et horloge de TIM1 */
+	uint32_t jitter_ns;     /*!< Ecart maximal d'un SOF à la moyenne */
+} Host_Stats_t;
+
+/**
+ * @brief  Remet le flux et les compteurs à zéro
+ * @retval None
+ */
+void Host_Init(void);
+
+/**
+ * @brief  Rend les sorties si l'hôte s'est tu
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Host_Process(void);
+
+/**
+ * @brief  Indique si l'hôte pilote les sorties
+ * @retval 1 si une image a été reçue depuis moins de HOST_STREAM_TIMEOUT_MS
+ */
+uint8_t Host_IsStreaming(void);
+
+/**
+ * @brief  Compteurs du flux
+ * @retval Pointeur sur les compteurs (mis à jour sous interruption)
+ */
+const Host_Stats_t *Host_GetStats(void);
+
+/**
+ * @brief  A appeler depuis CDC_Receive_FS
+ * @param  buf: données reçues
+ * @param  len: nombre d'octets
+ * @retval None
+ */
+void Host_Receive(const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief  A appeler à l'entrée de l'interruption USB quand le SOF est levé
+ * @retval None
+ */
+void Host_SOF(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_H__ */
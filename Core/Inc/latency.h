@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file    latency.h
+  * @brief   Mesure de la latence DMX vers lumière.
+  *
+  *          Deux instants sont datés sur TIM2 (TIMEBASE_NOW) :
+  *          - la réception du dernier canal de l'empreinte sur la ligne A
+  *            (Dmx_SetMarker, fin du premier transfert DMA) ;
+  *          - l'événement de mise à jour de TIM1 qui charge les nouveaux
+  *            rapports cycliques (registres CCR préchargés), retrouvé dans
+  *            TIM1_Tick à partir du compteur de TIM1.
+  *
+  *          Seules les trames qui modifient les sorties PWM sont mesurées :
+  *          le ruban (strip.h) n'a pas d'événement de mise à jour comparable.
+  *          La date d'écriture est prise après celle des CCR : une écriture
+  *          qui précède de peu un événement est reportée au suivant, la
+  *          mesure ne peut que surestimer la latence.
+  *
+  *          Les mesures vont dans un histogramme de LATENCY_BINS classes de
+  *          LATENCY_BIN_US ; la dernière classe reçoit les dépassements. Les
+  *          centiles rendus sont la borne haute de leur classe.
+  *
+  *          En mode LATENCY_MARKER, la broche LED (PA5) passe à l'état bas
+  *          à la réception du canal et remonte à l'application : la largeur
+  *          de l'impulsion est la latence, à corréler à l'oscilloscope avec
+  *          la ligne DMX et la sortie PWM.
+  *
+  *          La datation exige ISR_FAST_PATH. Une interruption de canal
+  *          retardée de plus de deux temps de canal (88 us) fait perdre la
+  *          trame en cours (débordement de l'USART).
+  ******************************************************************************
+  */
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Histogramme : 256 classes de 100 us, jusqu'à 25,6 ms */
+#define LATENCY_BIN_US          100U
+#define LATENCY_BINS            256U
+
+/**
+ * @brief  Modes de mesure
+ */
+typedef enum {
+	LATENCY_OFF = 0,
+	LATENCY_ON,                 /*!< Mesure seule */
+	LATENCY_MARKER,             /*!< Mesure et impulsion sur PA5 */
+	LATENCY_MODE_COUNT
+} Latency_Mode_t;
+
+/**
+ * @brief  Résultats de la mesure, en microsecondes
+ */
+typedef struct {
+	uint32_t count;         /*!< Mesures depuis le dernier changement de mode */
+	uint32_t missed;        /*!< Trames appliquées sans datation du canal */
+	uint32_t last_us;       /*!< Dernière mesure */
+	uint32_t p50_us;        /*!< Médiane */
+	uint32_t p99_us;        /*!< 99e centile */
+	uint32_t max_us;        /*!< Plus longue mesure */
+} Latency_Stats_t;
+
+/**
+ * @brief  Change de mode et remet l'histogramme à zéro
+ * @param  mode: valeur de @ref Latency_Mode_t
+ * @retval None
+ */
+void Latency_SetMode(uint8_t mode);
+
+/**
+ * @brief  Mode courant
+ * @retval Valeur de @ref Latency_Mode_t
+ */
+uint8_t Latency_GetMode(void);
+
+/**
+ * @brief  Trame DMX traitée par Fixture_Process
+ * @param  written: 1 si les niveaux PWM viennent d'être écrits
+ * @note   Appelé dans la boucle principale, après l'écriture des CCR
+ * @retval None
+ */
+void Latency_Frame(uint8_t written);
+
+/**
+ * @brief  Canal repère reçu
+ * @note   Appelé sous interruption (DMA de la ligne A)
+ * @retval None
+ */
+void Latency_Slot_Callback(void);
+
+/**
+ * @brief  Relève l'application des niveaux à l'événement de mise à jour
+ * @note   Appelé sous interruption à chaque période PWM (TIM1_Tick)
+ * @retval None
+ */
+void Latency_Tick(void);
+
+/**
+ * @brief  Résultats de la mesure, centiles recalculés
+ * @retval Pointeur vers les résultats
+ */
+const Latency_Stats_t *Latency_GetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LATENCY_H__ */
@@ -42,6 +42,18 @@ extern "C" {
 /* Exported constants --------------------------------------------------------*/
 /* USER CODE BEGIN EC */
 
+/* Interruptions chaudes (TIM1, TIM2, DMX, ruban) traitées au niveau
+   registre ; 0 pour repasser par les gestionnaires génériques HAL */
+#ifndef ISR_FAST_PATH
+#define ISR_FAST_PATH           1
+#endif
+
+/* Mesure DWT de l'entrée en interruption au début du traitement utile
+   (tableau Isr_Cycles, à lire au débogueur) */
+#ifndef ISR_PROFILE
+#define ISR_PROFILE             0
+#endif
+
 /* USER CODE END EC */
 
 /* Exported macro ------------------------------------------------------------*/
@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file    menu.h
+  * @brief   Menu de configuration sur l'afficheur SSD1306, piloté par
+  *          SW1..SW3.
+  *
+  *          SW1 long      : entrer / sortir du menu
+  *          SW1 court     : éditer / valider l'entrée sélectionnée
+  *          SW2 / SW3     : descendre / monter, ou -/+ en édition
+  *                          (répétition accélérée au maintien)
+  *          SW2 + SW3     : retour
+  *
+  *          Hors menu, SW2 frappe le tempo (sauf en synchro esclave) et
+  *          SW3 change d'effet. L'accueil affiche l'état de la
+  *          synchronisation et des lignes DMX.
+  ******************************************************************************
+  */
+#ifndef __MENU_H__
+#define __MENU_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/**
+ * @brief  Affiche l'écran d'accueil et applique le contraste
+ * @retval None
+ */
+void Menu_Init(void);
+
+/**
+ * @brief  Traite les événements boutons en attente et la mire de test
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Menu_Process(void);
+
+/**
+ * @brief  Indique si le menu est ouvert
+ * @retval 1 si le menu est affiché
+ */
+uint8_t Menu_IsActive(void);
+
+/**
+ * @brief  Indique si la mire de test pilote les sorties
+ * @retval 1 si la mire est active
+ */
+uint8_t Menu_IsTestActive(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MENU_H__ */
@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file    merge.h
+  * @brief   Fusion des sources DMX en un univers unique (HTP, LTP ou
+  *          secours par ordre de priorité selon Settings.merge_mode).
+  *
+  *          Sources : lignes DMX A et B (recopiées par Merge_Process) et
+  *          univers fournis par l'hôte USB ou rejoués depuis la flash
+  *          (Merge_Submit).
+  ******************************************************************************
+  */
+#ifndef __MERGE_H__
+#define __MERGE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/**
+ * @brief  Sources de la fusion, par ordre de priorité en mode secours
+ */
+typedef enum {
+	MERGE_SRC_LINE_A = 0,   /*!< Ligne DMX A (USART1) */
+	MERGE_SRC_LINE_B,       /*!< Ligne DMX B (USART2 sur PA3) */
+	MERGE_SRC_HOST,         /*!< Univers envoyé par l'hôte USB */
+	MERGE_SRC_SHOW,         /*!< Enregistrement rejoué (record.c), écarté dès qu'une autre source est présente */
+	MERGE_SRC_COUNT
+} Merge_Source_t;
+
+/* Silence d'une source déclenchant la bascule sur la suivante (ms) */
+#define MERGE_FAILOVER_MS       100U
+
+/**
+ * @brief  Remet l'univers fusionné à zéro
+ * @retval None
+ */
+void Merge_Init(void);
+
+/**
+ * @brief  Fournit un univers pour une source qui ne passe pas par dmx.c
+ * @param  src: valeur de @ref Merge_Source_t
+ * @param  slots: canaux à partir du canal 1
+ * @param  length: nombre de canaux (les suivants valent 0)
+ * @note   Pris en compte au prochain Merge_Process
+ * @retval None
+ */
+void Merge_Submit(uint8_t src, const uint8_t *slots, uint16_t length);
+
+/**
+ * @brief  Recopie les nouvelles trames et recalcule l'univers fusionné
+ * @note   A appeler dans la boucle principale
+ * @retval 1 si l'univers fusionné a été mis à jour
+ */
+uint8_t Merge_Process(void);
+
+/**
+ * @brief  Univers fusionné (canal 1 à l'indice 0)
+ * @retval Pointeur sur DMX_UNIVERSE_SIZE octets
+ */
+const uint8_t *Merge_GetUniverse(void);
+
+/**
+ * @brief  Canaux de l'univers fusionné modifiés par le dernier
+ *         Merge_Process ayant retourné 1
+ * @retval Carte de DMX_CHANGED_WORDS mots, bit n = canal n+1
+ */
+const uint32_t *Merge_GetChanged(void);
+
+/**
+ * @brief  Indique si une plage de l'univers fusionné a changé
+ * @param  first: premier canal (indice 0 = canal 1)
+ * @param  count: nombre de canaux
+ * @retval 1 si au moins un canal de la plage a changé
+ */
+uint8_t Merge_SlotsChanged(uint16_t first, uint16_t count);
+
+/**
+ * @brief  Empreinte de l'univers fusionné
+ * @retval Hash FNV-1a des 512 canaux
+ */
+uint32_t Merge_GetHash(void);
+
+/**
+ * @brief  Indique si une source reçoit des trames
+ * @param  src: valeur de @ref Merge_Source_t
+ * @retval 1 si une trame a été reçue depuis moins de DMX_LOSS_TIMEOUT_MS
+ */
+uint8_t Merge_IsSourcePresent(uint8_t src);
+
+/**
+ * @brief  Indique si au moins une source reçoit des trames
+ * @retval 1 si une source est présente
+ */
+uint8_t Merge_IsPresent(void);
+
+/**
+ * @brief  Source retenue en mode secours
+ * @retval Valeur de @ref Merge_Source_t
+ */
+uint8_t Merge_GetActiveSource(void);
+
+/**
+ * @brief  Durée du dernier calcul de fusion
+ * @retval Cycles CPU (DWT)
+ */
+uint32_t Merge_GetCycles(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MERGE_H__ */
@@ -0,0 +1,120 @@
+/**
+  ******************************************************************************
+  * @file    output.h
+  * @brief   Sorties PWM RGB sur TIM1 (CH1 = bleu, CH2 = rouge, CH3 = vert).
+  ******************************************************************************
+  */
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/**
+ * @brief  Sources pouvant piloter les sorties
+ */
+typedef enum {
+	OUTPUT_SRC_NONE = 0,    /*!< Sorties éteintes */
+	OUTPUT_SRC_TEST,        /*!< Mire de test du menu */
+	OUTPUT_SRC_DMX,         /*!< Univers DMX fusionné */
+	OUTPUT_SRC_HOST,        /*!< Flux d'images de l'hôte USB */
+	OUTPUT_SRC_EFFECT,      /*!< Effets autonomes */
+	OUTPUT_SRC_CUE,         /*!< Conduite (cue.h) */
+	OUTPUT_SRC_COUNT
+} Output_Source_t;
+
+/**
+ * @brief  Démarre les trois voies PWM, sorties éteintes
+ * @retval None
+ */
+void Output_Init(void);
+
+/**
+ * @brief  Choisit l'usage de TIM1 : trois voies PWM ou ruban de LED
+ * @param  mode: valeur de @ref Settings_OutputMode_t
+ * @note   A appeler après Tempo_Init, le ruban reprenant la cadence du tempo
+ * @retval None
+ */
+void Output_SetMode(uint8_t mode);
+
+/**
+ * @brief  Applique des niveaux linéaires 16 bits
+ * @note   En mode ruban, tout le ruban prend la couleur (8 bits)
+ * @param  r, g, b: niveaux 0..65535
+ * @retval None
+ */
+void Output_SetRGB16(uint16_t r, uint16_t g, uint16_t b);
+
+/**
+ * @brief  Recalcule les comparaisons PWM après un changement de période
+ * @note   Sans effet quand le ruban est actif
+ * @retval None
+ */
+void Output_Refresh(void);
+
+/**
+ * @brief  Limite appliquée à tous les rapports cycliques PWM (réduction
+ *         thermique, sensor.h)
+ * @param  k: facteur 0..65536, 65536 sans limite
+ * @note   Les niveaux demandés sont conservés, seules les comparaisons
+ *         changent ; sans effet sur le ruban
+ * @retval None
+ */
+void Output_SetLimit(uint32_t k);
+
+/**
+ * @brief  Sélectionne la source qui pilote les sorties
+ * @param  src: valeur de @ref Output_Source_t ; OUTPUT_SRC_NONE éteint
+ * @retval None
+ */
+void Output_SetSource(uint8_t src);
+
+/**
+ * @brief  Source pilotant actuellement les sorties
+ * @retval Valeur de @ref Output_Source_t
+ */
+uint8_t Output_GetSource(void);
+
+/**
+ * @brief  Indique si les trois sorties PWM sont éteintes
+ * @note   Toujours 0 quand le ruban est actif
+ * @retval 1 si les niveaux R, G, B sont nuls
+ */
+uint8_t Output_IsDark(void);
+
+/**
+ * @brief  Niveaux appliqués en PWM
+ * @retval R, G, B 16 bits
+ */
+const uint16_t *Output_GetLevels(void);
+
+/**
+ * @brief  Applique des niveaux 16 bits si src est la source sélectionnée
+ * @param  src: source émettrice
+ * @param  r, g, b: niveaux 0..65535
+ * @retval None
+ */
+void Output_Write(uint8_t src, uint16_t r, uint16_t g, uint16_t b);
+
+/**
+ * @brief  Applique des niveaux 8 bits avec correction gamma 2
+ * @param  r, g, b: niveaux 0..255
+ * @retval None
+ */
+void Output_SetRGB8(uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief  Conversion 8 bits vers niveau linéaire 16 bits (gamma 2)
+ * @param  v: niveau 0..255
+ * @retval Niveau 0..65535
+ */
+uint16_t Output_Gamma8(uint8_t v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OUTPUT_H__ */
@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * @file    power.h
+  * @brief   Veille : mode Stop 1 quand la carte n'a rien à afficher.
+  *
+  *          La carte passe en Stop 1 quand l'USB est suspendu, que les
+  *          sorties sont éteintes (aucune source, ou DMX à zéro) et que rien
+  *          n'attend d'échéance (boutons, conduite, enregistrement), depuis
+  *          au moins POWER_IDLE_MS. Elle se réveille sur :
+  *          - le bit de start d'une ligne DMX (USART1, USART2 si PA3 est en
+  *            DMX), cadencés par HSI16 qui reste disponible en Stop ;
+  *          - un front de SW1 à SW3 (EXTI) ;
+  *          - la reprise USB (EXTI 17).
+  *
+  *          L'IWDG compte aussi en Stop : LPTIM1, cadencé par le LSI,
+  *          réveille la carte toutes les POWER_WAKE_MS pour le recharger,
+  *          puis elle repart en Stop sans remonter ses horloges si rien
+  *          d'autre n'est en attente.
+  *
+  *          Stop 2 ne convient pas : seuls LPUART1, I2C3 et LPTIM y restent
+  *          actifs, ni USART1 ni l'USB ne pourraient réveiller la carte.
+  *
+  *          Le réveil se fait sur HSI16 : les interruptions en attente
+  *          (BREAK DMX notamment) sont servies aussitôt, à 16 MHz, pendant
+  *          que les horloges du profil courant redémarrent (PLL et HSI48,
+  *          quelques dizaines de us).
+  ******************************************************************************
+  */
+#ifndef __POWER_H__
+#define __POWER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "watchdog.h"
+
+/* Durée minimale de l'état de repos avant l'entrée en Stop */
+#define POWER_IDLE_MS           1000U
+
+/* Réveil périodique en Stop pour l'IWDG (LPTIM1, LSI / 32) */
+#define POWER_WAKE_MS           (WATCHDOG_TIMEOUT_MS / 2U)
+
+/**
+ * @brief  Horloge de réveil et lignes EXTI de réveil
+ * @retval None
+ */
+void Power_Init(void);
+
+/**
+ * @brief  Attend la prochaine interruption, en Stop 1 si la carte est au
+ *         repos, en Sleep sinon
+ * @note   A appeler en fin de boucle principale, rien n'étant à traiter
+ * @retval None
+ */
+void Power_Idle(void);
+
+/**
+ * @brief  Nombre d'entrées en Stop depuis le démarrage
+ * @retval Compteur
+ */
+uint32_t Power_GetStops(void);
+
+/**
+ * @brief  A appeler sur l'interruption LPTIM1
+ * @note   Le réveil est d'ordinaire traité avant de démasquer les
+ *         interruptions ; ne fait qu'acquitter un réveil tardif
+ * @retval None
+ */
+void Power_Timer_Callback(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __POWER_H__ */
@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+  * @file    record.h
+  * @brief   Enregistrement des trames DMX reçues dans l'emplacement du
+  *          spectacle et rejeu autonome en l'absence de console.
+  *
+  *          Seuls les canaux de l'empreinte sont enregistrés, avec la date
+  *          de chaque trame ; une trame identique à la précédente ne coûte
+  *          rien, une trame modifiée ne coûte que ses canaux modifiés.
+  *
+  *          Format (à la suite de l'en-tête Show_Header_t) :
+  *          - RECORD_TAG, puis le nombre de canaux enregistrés (16 bits) et
+  *            deux octets réservés ;
+  *          - une entrée par trame modifiée : délai depuis l'entrée
+  *            précédente en ms (varint), nombre de plages (octet), puis par
+  *            plage : canaux sautés depuis la plage précédente (varint),
+  *            nombre de canaux (octet, 1 à 255) et leurs valeurs ;
+  *          - une dernière entrée sans plage donne la durée de la fin
+  *            avant le retour au début.
+  *          La première entrée contient tous les canaux. Les varint sont en
+  *          base 128, poids faibles d'abord, bit 7 = octet suivant.
+  *
+  *          Le rejeu (politique de perte LOSS_PLAYBACK) replace les canaux
+  *          à l'adresse courante et les injecte dans la fusion (source
+  *          MERGE_SRC_SHOW) : personnalité, ruban et politique de perte
+  *          restent ceux du DMX reçu.
+  ******************************************************************************
+  */
+#ifndef __RECORD_H__
+#define __RECORD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* "DMXR" */
+#define RECORD_TAG              0x52584D44UL
+
+/* Double-mots programmés par passage de la boucle principale (~85 us chacun) */
+#define RECORD_DWORDS_PER_PASS  4U
+
+/* Répétition de la trame rejouée, comme une console */
+#define RECORD_REFRESH_MS       25U
+
+/**
+ * @brief  Arrête l'enregistrement et le rejeu
+ * @retval None
+ */
+void Record_Init(void);
+
+/**
+ * @brief  Commence un enregistrement, l'ancien spectacle est effacé
+ * @note   Bloque le temps d'effacer l'emplacement (environ 90 ms)
+ * @retval None
+ */
+void Record_Start(void);
+
+/**
+ * @brief  Termine l'enregistrement en cours et le valide
+ * @retval None
+ */
+void Record_Stop(void);
+
+/**
+ * @brief  Indique si un enregistrement est en cours
+ * @retval 1 si en cours
+ */
+uint8_t Record_IsRecording(void);
+
+/**
+ * @brief  Indique si l'enregistrement est en cours de rejeu
+ * @retval 1 si rejoué
+ */
+uint8_t Record_IsPlaying(void);
+
+/**
+ * @brief  Indique si le dernier enregistrement a été perdu sur un échec de
+ *         la flash
+ * @note   Remis à zéro par Record_Start
+ * @retval 1 si perdu
+ */
+uint8_t Record_HasFailed(void);
+
+/**
+ * @brief  Enregistre une trame reçue
+ * @param  slots: canaux à partir de l'adresse
+ * @param  count: nombre de canaux (empreinte)
+ * @note   Appelée par Fixture_Process à chaque univers fusionné ; la trame
+ *         est codée en RAM, la flash n'est programmée que par
+ *         Record_Process
+ * @retval None
+ */
+void Record_Frame(const uint8_t *slots, uint16_t count);
+
+/**
+ * @brief  Programme la flash par petits morceaux ou avance le rejeu
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Record_Process(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RECORD_H__ */
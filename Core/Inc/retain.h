@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file    retain.h
+  * @brief   Etat conservé en SRAM2 à travers les redémarrages à chaud.
+  *
+  *          La section .retain (non initialisée, STM32L412K8TX_FLASH.ld)
+  *          suit la partie du chargeur copiée en SRAM2 : ni le démarrage
+  *          de l'application ni une session de mise à jour ne l'écrasent.
+  *          Elle contient :
+  *          - l'état : réglages, niveaux et registres PWM de TIM1, relevés
+  *            toutes les RETAIN_SAVE_MS par la boucle principale ;
+  *          - la dernière trame DMX fusionnée, relevée à chaque trame.
+  *          - le relevé du dernier défaut du processeur (fault.h).
+  *          Chaque partie porte un mot magique, sa taille et une empreinte
+  *          FNV-1a ; une partie invalide (mise sous tension, coupure
+  *          pendant l'écriture, autre version du programme) est ignorée.
+  *
+  *          Après un reset à chaud (logiciel, chien de garde, défaut,
+  *          broche NRST), les rapports cycliques sont rétablis juste après
+  *          SystemClock_Config, bien avant la fin de l'initialisation, puis
+  *          la trame conservée est réinjectée dans la fusion comme un
+  *          rejeu : le projecteur la rend à l'identique et applique sa
+  *          politique de perte si la console ne revient pas.
+  ******************************************************************************
+  */
+#ifndef __RETAIN_H__
+#define __RETAIN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "settings.h"
+
+/* "RTN1" : à changer avec la disposition de Retain_State_t */
+#define RETAIN_MAGIC            0x314E5452UL
+
+/* Période de relevé de l'état */
+#define RETAIN_SAVE_MS          10U
+
+/* Place une variable dans la section conservée */
+#define RETAIN                  __attribute__((section(".retain")))
+
+/**
+ * @brief  En-tête de chaque bloc conservé, suivi de son contenu
+ */
+typedef struct {
+	uint32_t magic;         /*!< RETAIN_MAGIC */
+	uint32_t size;          /*!< Taille du bloc, en-tête compris */
+	uint32_t sum;           /*!< Empreinte FNV-1a du contenu */
+} Retain_Header_t;
+
+/**
+ * @brief  Vérifie un bloc conservé
+ * @param  block: bloc commençant par un Retain_Header_t, aligné sur 32 bits
+ * @param  size: taille attendue (multiple de 4)
+ * @retval 1 si le mot magique, la taille et l'empreinte sont bons
+ */
+uint8_t Retain_Valid(const void *block, uint32_t size);
+
+/**
+ * @brief  Complète l'en-tête d'un bloc conservé après modification
+ * @param  block: bloc commençant par un Retain_Header_t
+ * @param  size: taille du bloc (multiple de 4)
+ * @retval None
+ */
+void Retain_Seal(void *block, uint32_t size);
+
+/**
+ * @brief  Valide l'état conservé, relève la cause du reset et rétablit
+ *         aussitôt les sorties PWM (registres, sans la HAL)
+ * @note   A appeler juste après SystemClock_Config
+ * @retval None
+ */
+void Retain_Init(void);
+
+/**
+ * @brief  Rétablit les rapports cycliques écrasés par MX_TIM1_Init
+ * @note   A appeler à la fin de MX_TIM1_Init
+ * @retval None
+ */
+void Retain_RestorePwm(void);
+
+/**
+ * @brief  Rétablit les réglages conservés
+ * @note   A appeler juste après Settings_Init
+ * @retval None
+ */
+void Retain_RestoreSettings(void);
+
+/**
+ * @brief  Réinjecte la trame conservée dans la fusion (MERGE_SRC_SHOW)
+ * @note   A appeler une fois la fusion et la réception initialisées
+ * @retval None
+ */
+void Retain_RestoreFrame(void);
+
+/**
+ * @brief  Niveaux PWM conservés
+ * @param  rgb: reçoit les niveaux R, G, B 16 bits
+ * @retval 1 si les sorties PWM ont été rétablies
+ */
+uint8_t Retain_GetLevels(uint16_t *rgb);
+
+/**
+ * @brief  Indique si le démarrage a retrouvé un état valide
+ * @retval 1 après un redémarrage à chaud
+ */
+uint8_t Retain_IsWarm(void);
+
+/**
+ * @brief  Cause du dernier reset
+ * @retval RCC->CSR relevé au démarrage (drapeaux RCC_CSR_xxxRSTF)
+ */
+uint32_t Retain_GetCause(void);
+
+/**
+ * @brief  Nombre de redémarrages à chaud consécutifs
+ * @retval Compteur, remis à zéro à la mise sous tension
+ */
+uint32_t Retain_GetResets(void);
+
+/**
+ * @brief  Relève la trame fusionnée
+ * @param  slots: univers complet
+ * @note   Appelée par Fixture_Process à chaque univers fusionné
+ * @retval None
+ */
+void Retain_Frame(const uint8_t *slots);
+
+/**
+ * @brief  Relève périodiquement l'état
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Retain_Process(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RETAIN_H__ */
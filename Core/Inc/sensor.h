@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file    sensor.h
+  * @brief   Mesures internes : tension d'alimentation analogique (VREFINT)
+  *          et température de la puce, avec réduction thermique des sorties
+  *          PWM.
+  *
+  *          Les deux voies internes forment le groupe injecté d'ADC1,
+  *          déclenché par le débordement de TIM15 (TRGO, ~15 Hz) : elles
+  *          s'intercalent dans les conversions régulières (Vp, audio.h)
+  *          sans les reprogrammer. Les valeurs d'étalonnage d'usine sont utilisées :
+  *          VREFINT_CAL donne VDDA, qui ramène ensuite toute mesure (capteur
+  *          de température compris) à une tension indépendante de
+  *          l'alimentation ; TS_CAL1 et TS_CAL2 donnent la pente du capteur.
+  *
+  *          Au-delà de SENSOR_DERATE_START_DC, les rapports cycliques PWM
+  *          sont réduits selon une courbe linéaire par morceaux jusqu'à
+  *          SENSOR_DERATE_MIN à SENSOR_DERATE_END_DC et au-delà : un
+  *          projecteur enfermé reste allumé, moins fort, au lieu de
+  *          s'éteindre. Le ruban n'est pas concerné (LED alimentées à part).
+  ******************************************************************************
+  */
+#ifndef __SENSOR_H__
+#define __SENSOR_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Courbe de réduction (dixièmes de degré, facteur sur 65536) */
+#define SENSOR_DERATE_START_DC  600
+#define SENSOR_DERATE_MID_DC    750
+#define SENSOR_DERATE_END_DC    900
+#define SENSOR_DERATE_MID       32768U
+#define SENSOR_DERATE_MIN       13107U
+
+/* Ecart minimal avant d'appliquer un nouveau facteur */
+#define SENSOR_DERATE_STEP      256U
+
+/* Lissage de la température : 1/SENSOR_FILTER de chaque mesure */
+#define SENSOR_FILTER           8
+
+/* VDDA supposée avant la première mesure */
+#define SENSOR_VDDA_DEFAULT_MV  3300U
+
+/**
+ * @brief  Etalonne ADC1 et démarre les conversions injectées sur TIM15
+ * @note   MX_ADC1_Init et MX_TIM15_Init doivent avoir été appelées
+ * @retval None
+ */
+void Sensor_Init(void);
+
+/**
+ * @brief  Relève les dernières conversions et met à jour la réduction
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Sensor_Process(void);
+
+/**
+ * @brief  Température de la puce, lissée
+ * @retval Dixièmes de degré Celsius
+ */
+int16_t Sensor_GetTemperature(void);
+
+/**
+ * @brief  Tension d'alimentation analogique mesurée
+ * @retval VDDA en mV
+ */
+uint16_t Sensor_GetVdda(void);
+
+/**
+ * @brief  Convertit une mesure 12 bits d'ADC1 en tension
+ * @param  raw: valeur convertie
+ * @retval Tension en mV, rapportée à la VDDA mesurée
+ */
+uint16_t Sensor_ToMillivolts(uint16_t raw);
+
+/**
+ * @brief  Facteur appliqué aux sorties PWM
+ * @retval 0..65536, 65536 sans réduction
+ */
+uint32_t Sensor_GetDerate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SENSOR_H__ */
@@ -0,0 +1,142 @@
+/**
+  ******************************************************************************
+  * @file    settings.h
+  * @brief   Réglages de la carte : adresse DMX, personnalité, politique de
+  *          perte de signal et contraste de l'afficheur.
+  *
+  *          Les réglages sont enregistrés champ par champ dans le journal
+  *          de config.h : seuls les champs modifiés usent la flash.
+  ******************************************************************************
+  */
+#ifndef __SETTINGS_H__
+#define __SETTINGS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+#define DMX_UNIVERSE_SIZE       512U
+
+/**
+ * @brief  Personnalités DMX (disposition des canaux à partir de l'adresse)
+ */
+typedef enum {
+	PERSONALITY_RGB8 = 0,   /*!< R, G, B sur 8 bits (3 canaux) */
+	PERSONALITY_RGB16,      /*!< R, G, B sur 16 bits MSB/LSB (6 canaux) */
+	PERSONALITY_DIM_RGB,    /*!< Gradateur général puis R, G, B (4 canaux) */
+	PERSONALITY_COUNT
+} Settings_Personality_t;
+
+/**
+ * @brief  Comportement en cas de perte du signal DMX
+ */
+typedef enum {
+	LOSS_HOLD = 0,          /*!< Maintien de la dernière trame */
+	LOSS_BLACKOUT,          /*!< Extinction immédiate */
+	LOSS_FADE,              /*!< Extinction progressive */
+	LOSS_STANDALONE,        /*!< Bascule sur les effets autonomes */
+	LOSS_PLAYBACK,          /*!< Rejeu en boucle de l'enregistrement (record.h) */
+	LOSS_COUNT
+} Settings_LossPolicy_t;
+
+/**
+ * @brief  Effets autonomes synchronisés sur le tempo
+ */
+typedef enum {
+	EFFECT_NONE = 0,        /*!< Sorties éteintes */
+	EFFECT_PULSE,           /*!< Flash blanc décroissant à chaque temps */
+	EFFECT_CHASE,           /*!< Rouge, vert, bleu : une couleur par temps */
+	EFFECT_STROBE,          /*!< Eclair blanc bref en début de temps */
+	EFFECT_RAINBOW,         /*!< Tour de roue chromatique en 4 temps */
+	EFFECT_AUDIO,           /*!< Son sur Vp : graves, médiums, aigus en R, G, B (audio.h) */
+	EFFECT_COUNT
+} Settings_Effect_t;
+
+/**
+ * @brief  Fonction de PA3 (RX2)
+ */
+typedef enum {
+	RX2_SYNC = 0,           /*!< Entrée / sortie de synchronisation (TIM15) */
+	RX2_DMX,                /*!< Seconde ligne DMX (USART2) */
+	RX2_COUNT
+} Settings_Rx2_t;
+
+/**
+ * @brief  Fusion des deux lignes DMX
+ */
+typedef enum {
+	MERGE_HTP = 0,          /*!< Valeur la plus haute */
+	MERGE_LTP,              /*!< Dernière valeur modifiée */
+	MERGE_FAILOVER,         /*!< Ligne A, ligne B en secours */
+	MERGE_COUNT
+} Settings_Merge_t;
+
+/**
+ * @brief  Usage de TIM1
+ */
+typedef enum {
+	OUTPUT_MODE_PWM = 0,    /*!< Trois voies PWM R, G, B */
+	OUTPUT_MODE_STAGGER,    /*!< Trois voies PWM décalées dans la période */
+	OUTPUT_MODE_STRIP,      /*!< Ruban WS2812 / SK6812 sur PA8, un pixel par triplet DMX */
+	OUTPUT_MODE_COUNT
+} Settings_OutputMode_t;
+
+typedef struct {
+	uint16_t dmx_address;   /*!< 1 .. 513 - empreinte */
+	uint8_t personality;    /*!< Valeur de @ref Settings_Personality_t */
+	uint8_t loss_policy;    /*!< Valeur de @ref Settings_LossPolicy_t */
+	uint8_t contrast;       /*!< Contraste SSD1306 */
+	uint8_t effect;         /*!< Valeur de @ref Settings_Effect_t */
+	uint8_t sync_mode;      /*!< Valeur de @ref Sync_Mode_t */
+	uint8_t rx2_mode;       /*!< Valeur de @ref Settings_Rx2_t */
+	uint8_t merge_mode;     /*!< Valeur de @ref Settings_Merge_t */
+	uint8_t output_mode;    /*!< Valeur de @ref Settings_OutputMode_t */
+} Settings_t;
+
+extern Settings_t Settings;
+
+/**
+ * @brief  Charge les réglages par défaut, puis ceux enregistrés
+ * @note   Config_Init doit avoir été appelée
+ * @retval None
+ */
+void Settings_Init(void);
+
+/**
+ * @brief  Enregistre les réglages modifiés depuis le dernier enregistrement
+ * @note   A appeler hors interruption : programme la flash
+ * @retval None
+ */
+void Settings_Save(void);
+
+/**
+ * @brief  Nombre de canaux occupés par une personnalité
+ * @param  personality: valeur de @ref Settings_Personality_t
+ * @retval Empreinte en canaux DMX
+ */
+uint8_t Settings_Footprint(uint8_t personality);
+
+/**
+ * @brief  Adresse DMX maximale pour la personnalité courante
+ * @retval Adresse de départ la plus haute possible
+ */
+uint16_t Settings_MaxAddress(void);
+
+/**
+ * @brief  Libellés courts pour l'afficheur
+ */
+const char *Settings_PersonalityName(uint8_t personality);
+const char *Settings_LossName(uint8_t policy);
+const char *Settings_EffectName(uint8_t effect);
+const char *Settings_SyncName(uint8_t mode);
+const char *Settings_Rx2Name(uint8_t mode);
+const char *Settings_MergeName(uint8_t mode);
+const char *Settings_OutputName(uint8_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SETTINGS_H__ */
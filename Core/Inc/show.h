@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file    show.h
+  * @brief   Emplacement du spectacle en flash (4 pages, avant les réglages).
+  *
+  *          Le spectacle est un fichier unique précédé d'un en-tête de 8
+  *          octets. L'en-tête est programmé en dernier : tant qu'une écriture
+  *          n'est pas terminée, l'emplacement est vu vide.
+  ******************************************************************************
+  */
+#ifndef __SHOW_H__
+#define __SHOW_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Réservé dans STM32L412K8TX_FLASH.ld (région SHOW) */
+#define SHOW_BASE               0x0800D000UL
+#define SHOW_SIZE               0x2000UL
+
+/* "SHW1" */
+#define SHOW_MAGIC              0x31574853UL
+
+/* Résultats de Show_Write */
+#define SHOW_WRITE_PENDING      0U
+#define SHOW_WRITE_DONE         1U
+#define SHOW_WRITE_ERROR        2U
+
+/**
+ * @brief  En-tête du spectacle, un double-mot
+ */
+typedef struct {
+	uint32_t magic;         /*!< SHOW_MAGIC */
+	uint32_t length;        /*!< Taille totale en octets, en-tête compris */
+} Show_Header_t;
+
+/**
+ * @brief  Spectacle enregistré
+ * @retval En-tête en flash, NULL si l'emplacement est vide
+ */
+const Show_Header_t *Show_Get(void);
+
+/**
+ * @brief  Indique si un en-tête est celui d'un spectacle valide
+ * @param  h: en-tête à vérifier
+ * @retval 1 si valide
+ */
+uint8_t Show_IsValid(const Show_Header_t *h);
+
+/**
+ * @brief  Commence l'écriture d'un nouveau spectacle
+ * @param  length: taille totale annoncée par l'en-tête
+ * @note   L'ancien spectacle disparaît au premier Show_Write
+ * @retval None
+ */
+void Show_WriteBegin(uint32_t length);
+
+/**
+ * @brief  Ecrit la suite du spectacle, les pages étant effacées au passage
+ * @param  offset: position dans le fichier ; les données déjà écrites sont
+ *         ignorées, au-delà de la partie écrite l'écriture est refusée
+ * @param  data: données
+ * @param  len: nombre d'octets, multiple de 8
+ * @note   Un trou ou un échec d'effacement ou de programmation (HAL_BUSY
+ *         compris) abandonne l'écriture : elle est à reprendre par
+ *         Show_WriteBegin
+ * @retval SHOW_WRITE_DONE quand la taille annoncée est atteinte (en-tête
+ *         programmé), SHOW_WRITE_ERROR sur trou ou échec de la flash,
+ *         SHOW_WRITE_PENDING sinon
+ */
+uint8_t Show_Write(uint32_t offset, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief  Efface d'avance toutes les pages de l'écriture en cours
+ * @note   Bloque environ 22 ms par page ; les Show_Write suivants ne font
+ *         plus que programmer. Une page en échec est reprise par
+ *         Show_Write, qui signale l'erreur
+ * @retval None
+ */
+void Show_Erase(void);
+
+/**
+ * @brief  Termine une écriture dont la taille n'était pas connue au départ
+ * @param  length: taille réelle, en-tête compris, au plus celle déjà écrite
+ * @note   Ouvrir l'écriture avec Show_WriteBegin(SHOW_SIZE) ; le champ
+ *         length de l'en-tête écrit est remplacé
+ * @retval 1 si l'en-tête a été programmé
+ */
+uint8_t Show_WriteEnd(uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SHOW_H__ */
@@ -97,6 +97,25 @@ uint8_t SSD1306_Init(void);
  */
 void SSD1306_UpdateScreen(void);
 
+/**
+ * @brief  Updates only a rectangular area from internal RAM to LCD
+ * @note   Only the pages (8 pixel rows) and columns covering the area are transferred,
+ *         page addressing commands are sent in a single transfer without delays
+ * @param  x: Top left X start point. Valid input is 0 to SSD1306_WIDTH - 1
+ * @param  y: Top left Y start point. Valid input is 0 to SSD1306_HEIGHT - 1
+ * @param  w: Area width in units of pixels
+ * @param  h: Area height in units of pixels
+ * @retval None
+ */
+void SSD1306_UpdateArea(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+/**
+ * @brief  Sets display contrast
+ * @param  value: Contrast value, 0 (lowest) to 255 (highest)
+ * @retval None
+ */
+void SSD1306_SetContrast(uint8_t value);
+
 /**
  * @brief  Toggles pixels invertion inside internal RAM
  * @note   @ref SSD1306_UpdateScreen() must be called after that in order to see updated LCD screen
@@ -33,6 +33,20 @@
 /* Exported types ------------------------------------------------------------*/
 /* USER CODE BEGIN ET */
 
+/**
+ * @brief  Points de mesure de Isr_Cycles (ISR_PROFILE)
+ */
+typedef enum {
+	ISR_PROF_TIM1 = 0,      /*!< Mise à jour TIM1 -> tempo et effets */
+	ISR_PROF_TIM2,          /*!< TIM2 CH1 -> moteur de boutons */
+	ISR_PROF_DMX_BREAK,     /*!< BREAK USART -> fin de trame DMX */
+	ISR_PROF_DMX_HALF,      /*!< Demi-transfert DMA -> comparaison DMX */
+	ISR_PROF_STRIP,         /*!< Demi-tampon DMA ruban -> encodage */
+	ISR_PROF_CUE,           /*!< TIM2 CH2 -> cue de la conduite */
+	ISR_PROF_AUDIO,         /*!< Demi-tampon DMA ADC -> bloc audio prêt */
+	ISR_PROF_COUNT
+} Isr_Profile_t;
+
 /* USER CODE END ET */
 
 /* Exported constants --------------------------------------------------------*/
@@ -55,12 +69,26 @@ void SVC_Handler(void);
 void DebugMon_Handler(void);
 void PendSV_Handler(void);
 void SysTick_Handler(void);
+void EXTI0_IRQHandler(void);
+void EXTI1_IRQHandler(void);
+void EXTI3_IRQHandler(void);
+void DMA1_Channel1_IRQHandler(void);
+void DMA1_Channel2_IRQHandler(void);
+void DMA1_Channel5_IRQHandler(void);
+void TIM1_BRK_TIM15_IRQHandler(void);
+void TIM1_UP_TIM16_IRQHandler(void);
 void TIM2_IRQHandler(void);
 void USART1_IRQHandler(void);
 void USB_IRQHandler(void);
 void I2C3_EV_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void USART2_IRQHandler(void);
+void DMA1_Channel6_IRQHandler(void);
 
+#if ISR_PROFILE
+/* Cycles entre l'entrée du gestionnaire et le traitement utile */
+extern volatile uint32_t Isr_Cycles[ISR_PROF_COUNT];
+#endif
 /* USER CODE END EFP */
 
 #ifdef __cplusplus
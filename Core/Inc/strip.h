@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file    strip.h
+  * @brief   Ruban de LED adressables (WS2812 / SK6812) sur PA8 (PWMB).
+  *
+  *          TIM1 passe à 800 kHz et le DMA (DMA1 canal 2, requête CC1)
+  *          recharge CCR1 à chaque bit. Le tampon DMA circulaire est coupé
+  *          en deux moitiés de STRIP_CHUNK_PIXELS pixels, encodées tour à
+  *          tour sur les interruptions de demi-transfert et de fin de
+  *          transfert.
+  ******************************************************************************
+  */
+#ifndef __STRIP_H__
+#define __STRIP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Pixels RGB d'un univers complet */
+#define STRIP_PIXELS            170U
+
+/* Pixels encodés par moitié de tampon DMA (24 bits chacun) */
+#define STRIP_CHUNK_PIXELS      8U
+#define STRIP_CHUNK_BITS        (STRIP_CHUNK_PIXELS * 24U)
+
+/* Période d'un bit : 64 MHz / 80 = 800 kHz (1,25 us) */
+#define STRIP_BIT_PERIOD        80U
+
+/* Durées à l'état haut (ticks TIM1) : 0 -> 0,34 us, 1 -> 0,70 us */
+#define STRIP_T0H               22U
+#define STRIP_T1H               45U
+
+/* Moitiés à zéro après les données : 480 us de verrouillage (> 280 us) */
+#define STRIP_RESET_CHUNKS      2U
+
+/**
+ * @brief  Prépare la table d'encodage, ruban éteint
+ * @retval None
+ */
+void Strip_Init(void);
+
+/**
+ * @brief  Passe TIM1 en sortie ruban : 800 kHz, CCR1 par DMA, voies R et V
+ *         éteintes ; le tempo est alors cadencé par le DMA
+ * @retval None
+ */
+void Strip_Start(void);
+
+/**
+ * @brief  Rend TIM1 aux trois voies PWM et au tempo
+ * @retval None
+ */
+void Strip_Stop(void);
+
+/**
+ * @brief  Indique si le ruban est actif
+ * @retval 1 si TIM1 pilote le ruban
+ */
+uint8_t Strip_IsActive(void);
+
+/**
+ * @brief  Fournit une image complète
+ * @param  rgb: pixels R, G, B (canaux DMX consécutifs)
+ * @param  count: nombre de pixels (les suivants sont éteints)
+ * @retval 0 si l'image précédente n'a pas encore été prise en compte
+ */
+uint8_t Strip_SetPixels(const uint8_t *rgb, uint16_t count);
+
+/**
+ * @brief  Allume tout le ruban d'une même couleur
+ * @param  r, g, b: niveaux 0..255
+ * @note   Utilisable sous interruption (effets)
+ * @retval None
+ */
+void Strip_Fill(uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief  Atténuation des images fournies par Strip_SetPixels, appliquée à
+ *         l'encodage ; l'image courante est renvoyée
+ * @param  k: facteur 0..65536
+ * @retval None
+ */
+void Strip_SetScale(uint32_t k);
+
+/**
+ * @brief  A appeler sur le demi-transfert et la fin de transfert du DMA
+ * @param  half: moitié du tampon que le DMA vient de terminer (0 ou 1)
+ * @retval None
+ */
+void Strip_DMA_Callback(uint8_t half);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STRIP_H__ */
@@ -0,0 +1,106 @@
+/**
+  ******************************************************************************
+  * @file    sync.h
+  * @brief   Synchronisation multi-cartes sur PA3 (RX2).
+  *
+  *          Esclave : chaque front montant de PA3 marque le début d'un temps.
+  *          Les fronts sont capturés par TIM15 CH2 et une PLL logicielle
+  *          asservit la période et la phase du tempo local.
+  *          Maître  : PA3 émet une impulsion au début de chaque temps local.
+  ******************************************************************************
+  */
+#ifndef __SYNC_H__
+#define __SYNC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Durée de l'impulsion émise en mode maître (périodes PWM) */
+#define SYNC_PULSE_PERIODS      4U
+
+/* Gain proportionnel de la boucle de phase (1/N de l'erreur par temps) */
+#define SYNC_KP_DIV             4U
+
+/* Lissage de la période mesurée (1/2^N par front) */
+#define SYNC_FLL_SHIFT          3U
+
+/* Erreur de phase au-delà de laquelle la phase est recalée d'un coup (Q32) */
+#define SYNC_RELOCK_PHASE       0x20000000L
+
+/* Verrouillage : SYNC_LOCK_COUNT fronts consécutifs à moins de SYNC_LOCK_US */
+#define SYNC_LOCK_US            1000U
+#define SYNC_LOCK_COUNT         4U
+
+/**
+ * @brief  Modes de synchronisation
+ */
+typedef enum {
+	SYNC_OFF = 0,           /*!< Tempo local uniquement */
+	SYNC_SLAVE,             /*!< Asservi aux impulsions reçues sur PA3 */
+	SYNC_MASTER,            /*!< Emet une impulsion par temps sur PA3 */
+	SYNC_MODE_COUNT
+} Sync_Mode_t;
+
+/**
+ * @brief  Etat de la boucle en mode esclave
+ */
+typedef enum {
+	SYNC_STATE_SEARCH = 0,  /*!< Aucune impulsion valide */
+	SYNC_STATE_ACQUIRE,     /*!< Impulsions reçues, phase en convergence */
+	SYNC_STATE_LOCKED       /*!< Phase verrouillée */
+} Sync_State_t;
+
+/**
+ * @brief  Applique le mode de synchronisation (configure PA3 et TIM15)
+ * @param  mode: valeur de @ref Sync_Mode_t
+ * @retval None
+ */
+void Sync_SetMode(uint8_t mode);
+
+/**
+ * @brief  Surveille l'absence d'impulsions
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Sync_Process(void);
+
+/**
+ * @brief  Etat de la boucle
+ * @retval Valeur de @ref Sync_State_t
+ */
+uint8_t Sync_GetState(void);
+
+/**
+ * @brief  Dernière erreur de phase mesurée
+ * @retval Erreur en us, > 0 si le tempo local est en avance
+ */
+int32_t Sync_GetErrorUs(void);
+
+/**
+ * @brief  Dérive de la période du maître depuis l'accrochage (premier
+ *         intervalle valide), indépendante du tempo local
+ * @retval Ecart en ppm, > 0 si le maître ralentit
+ */
+int32_t Sync_GetDriftPpm(void);
+
+/**
+ * @brief  A appeler sur la capture TIM15 CH2
+ * @retval None
+ */
+void Sync_Capture_Callback(void);
+
+/**
+ * @brief  A appeler sur la mise à jour de TIM1, après le tempo
+ * @param  beats: compteur de temps courant
+ * @retval None
+ */
+void Sync_Update_Callback(uint32_t beats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SYNC_H__ */
@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file    tempo.h
+  * @brief   Tempo : tap tempo horodaté par TIM2 et accumulateur de phase
+  *          en virgule fixe avancé à chaque période PWM (mise à jour TIM1).
+  *
+  *          La phase est un Q32 : 2^32 = un temps. Son débordement
+  *          incrémente le compteur de temps, ce qui forme un compteur
+  *          64 bits sans dérive cumulée.
+  ******************************************************************************
+  */
+#ifndef __TEMPO_H__
+#define __TEMPO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "tim.h"
+
+/* Plage de tempo (BPM) */
+#define TEMPO_MIN_BPM           30U
+#define TEMPO_MAX_BPM           300U
+#define TEMPO_DEFAULT_BPM       120U
+
+/* Bornes de la période d'un temps en ticks TIM2 */
+#define TEMPO_TICKS_PER_MIN     (60000U * TIMEBASE_TICKS_PER_MS)
+#define TEMPO_MIN_PERIOD        (TEMPO_TICKS_PER_MIN / TEMPO_MAX_BPM)
+#define TEMPO_MAX_PERIOD        (TEMPO_TICKS_PER_MIN / TEMPO_MIN_BPM)
+
+/* Nombre de frappes retenues pour la moyenne (glissante) */
+#define TEMPO_TAP_COUNT         8U
+
+/* Ecart toléré entre un intervalle et la moyenne courante (1/4 = 25 %) */
+#define TEMPO_TAP_TOLERANCE_DIV 4U
+
+/**
+ * @brief  Charge le tempo par défaut et active l'interruption de mise à
+ *         jour de TIM1
+ * @note   Les voies PWM doivent être démarrées (Output_Init) avant l'appel
+ * @retval None
+ */
+void Tempo_Init(void);
+
+/**
+ * @brief  Enregistre une frappe : met à jour la période et recale la phase
+ *         sur l'instant de la frappe
+ * @param  time: horodatage TIM2 de la frappe (premier front du bouton)
+ * @retval None
+ */
+void Tempo_Tap(uint32_t time);
+
+/**
+ * @brief  Recale la phase pour qu'un temps commence à l'instant donné
+ * @param  time: horodatage TIM2 (passé) du début de temps
+ * @retval None
+ */
+void Tempo_Align(uint32_t time);
+
+/**
+ * @brief  Phase à un instant passé, interpolée dans la période PWM
+ * @param  time: horodatage TIM2
+ * @retval Phase Q32 ; interprétée signée, > 0 si le temps local avait
+ *         déjà commencé
+ */
+uint32_t Tempo_PhaseAt(uint32_t time);
+
+/**
+ * @brief  Impose la période d'un temps
+ * @param  ticks: durée d'un temps en ticks TIM2, bornée à la plage BPM
+ * @retval None
+ */
+void Tempo_SetPeriod(uint32_t ticks);
+
+/**
+ * @brief  Durée d'un temps en ticks TIM2
+ * @retval Période courante
+ */
+uint32_t Tempo_GetPeriod(void);
+
+/**
+ * @brief  Tempo courant en dixièmes de BPM
+ * @retval BPM x 10
+ */
+uint32_t Tempo_GetBPMx10(void);
+
+/**
+ * @brief  Recalcule l'incrément de phase
+ * @note   A rappeler si la période PWM de TIM1 change
+ * @retval None
+ */
+void Tempo_Recompute(void);
+
+/**
+ * @brief  Nombre de périodes PWM entre deux appels de Tempo_Update_Callback
+ * @param  periods: 1 quand la mise à jour de TIM1 cadence le tempo, plus
+ *         quand une autre interruption prend le relais (ruban de LED)
+ * @note   Au-delà de 1, la phase n'est plus interpolée dans l'intervalle
+ * @retval None
+ */
+void Tempo_SetTickPeriods(uint32_t periods);
+
+/**
+ * @brief  Phase dans le temps courant (Q32)
+ * @retval 0 .. 2^32-1
+ */
+uint32_t Tempo_GetPhase(void);
+
+/**
+ * @brief  Nombre de temps écoulés
+ * @retval Compteur de temps
+ */
+uint32_t Tempo_GetBeats(void);
+
+/**
+ * @brief  A appeler sur la mise à jour de TIM1 (fin de période PWM), ou
+ *         toutes les Tempo_SetTickPeriods() périodes
+ * @retval None
+ */
+void Tempo_Update_Callback(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TEMPO_H__ */
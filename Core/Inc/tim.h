@@ -36,14 +36,22 @@ extern TIM_HandleTypeDef htim1;
 
 extern TIM_HandleTypeDef htim2;
 
+extern TIM_HandleTypeDef htim6;
+
 extern TIM_HandleTypeDef htim15;
 
 /* USER CODE BEGIN Private defines */
 
+/* Base de temps 32 bits : TIM2 en comptage libre à 16 MHz (62,5 ns / tick) */
+#define TIMEBASE_TICKS_PER_US   16U
+#define TIMEBASE_TICKS_PER_MS   16000U
+#define TIMEBASE_NOW()          (TIM2->CNT)
+
 /* USER CODE END Private defines */
 
 void MX_TIM1_Init(void);
 void MX_TIM2_Init(void);
+void MX_TIM6_Init(void);
 void MX_TIM15_Init(void);
 
 void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
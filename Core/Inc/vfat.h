@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file    vfat.h
+  * @brief   Volume FAT12 virtuel présenté par le stockage de masse USB.
+  *
+  *          Aucun secteur n'est stocké : secteur d'amorçage, FAT et
+  *          répertoire racine sont calculés à chaque lecture, les données de
+  *          SHOW.BIN sont lues directement dans la flash.
+  *
+  *          - SHOW.BIN    le spectacle (clusters 2 à 17, 8 Ko au plus)
+  *          - CONFIG.TXT  les réglages courants, en lecture seule
+  *
+  *          Copier un spectacle sur le volume le programme : un secteur de
+  *          données commençant par SHOW_MAGIC ouvre l'écriture, les secteurs
+  *          suivants sont programmés jusqu'à la taille de l'en-tête. Les
+  *          écritures de FAT et de répertoire sont ignorées : le système
+  *          hôte ne voit le nouveau fichier sous son vrai nom qu'après
+  *          réinsertion du volume.
+  ******************************************************************************
+  */
+#ifndef __VFAT_H__
+#define __VFAT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "usbd_storage.h"
+
+/* Géométrie : 1 Mo, un secteur par cluster */
+#define VFAT_SECTOR_SIZE        STORAGE_BLOCK_SIZE
+#define VFAT_SECTORS            2048U
+#define VFAT_FAT_SECTORS        6U
+#define VFAT_ROOT_ENTRIES       16U
+
+extern USBD_Storage_ItfTypeDef Vfat_fops;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VFAT_H__ */
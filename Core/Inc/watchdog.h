@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file    watchdog.h
+  * @brief   Chien de garde indépendant (IWDG) et supervision des tâches.
+  *
+  *          Chaque tâche signale son passage (Watchdog_Checkin) ; l'IWDG
+  *          n'est rechargé que si toutes les tâches armées sont passées
+  *          dans leur délai. Une tâche en retard, ou une boucle principale
+  *          bloquée, laisse expirer l'IWDG : la carte redémarre en moins de
+  *          WATCHDOG_TIMEOUT_MS après le dépassement et reprend son état
+  *          depuis la SRAM2 (retain.h).
+  *
+  *          Tâches surveillées :
+  *          - WATCHDOG_TASK_DMX : traitement des univers reçus
+  *            (Fixture_Process) ;
+  *          - WATCHDOG_TASK_PWM : mise à jour des sorties à chaque période
+  *            de TIM1 (interruption) ;
+  *          - WATCHDOG_TASK_DISPLAY : écran et menu (Menu_Process, transferts
+  *            I2C bloquants) ;
+  *          - WATCHDOG_TASK_USB : SOF tant que le bus n'est pas suspendu.
+  *
+  *          Une tâche n'est surveillée qu'après son premier passage et
+  *          jusqu'à sa mise en pause (USB suspendu). Les délais se comptent
+  *          en HAL_GetTick : ils sont gelés en Stop comme les tâches.
+  *
+  *          Le plus long intervalle entre deux passages de chaque tâche est
+  *          relevé en permanence. Dès qu'une tâche dépasse son délai, les
+  *          retards sont inscrits en SRAM2 conservée, et mis à jour jusqu'au
+  *          reset ; le démarrage suivant les rend par Watchdog_GetLast.
+  ******************************************************************************
+  */
+#ifndef __WATCHDOG_H__
+#define __WATCHDOG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+/* Expiration de l'IWDG (LSI 32 kHz / 32, 1 ms par pas) */
+#define WATCHDOG_TIMEOUT_MS     500U
+
+/* Délais entre deux passages de chaque tâche */
+#define WATCHDOG_DMX_MS         100U
+#define WATCHDOG_PWM_MS         20U
+#define WATCHDOG_DISPLAY_MS     250U
+#define WATCHDOG_USB_MS         100U
+
+/**
+ * @brief  Tâches surveillées
+ */
+typedef enum {
+	WATCHDOG_TASK_DMX = 0,
+	WATCHDOG_TASK_PWM,
+	WATCHDOG_TASK_DISPLAY,
+	WATCHDOG_TASK_USB,
+	WATCHDOG_TASK_COUNT
+} Watchdog_Task_t;
+
+/**
+ * @brief  Etat de la supervision, courant ou relevé avant le dernier reset
+ */
+typedef struct {
+	uint32_t late;          /*!< Bit n : tâche n en retard ; 0 : aucune */
+	uint32_t uptime_ms;     /*!< HAL_GetTick() au relevé */
+	uint16_t lateness_ms[WATCHDOG_TASK_COUNT];  /*!< Dépassement de délai, pire relevé */
+	uint16_t worst_ms[WATCHDOG_TASK_COUNT];     /*!< Plus long intervalle entre deux passages */
+} Watchdog_Report_t;
+
+/**
+ * @brief  Démarre l'IWDG et reprend le relevé laissé par un reset IWDG
+ * @note   A appeler en fin d'initialisation, juste avant la boucle
+ *         principale : l'IWDG ne peut plus être arrêté
+ * @retval None
+ */
+void Watchdog_Init(void);
+
+/**
+ * @brief  Signale le passage d'une tâche et l'arme si besoin
+ * @param  task: valeur de @ref Watchdog_Task_t
+ * @note   Utilisable en interruption
+ * @retval None
+ */
+void Watchdog_Checkin(uint8_t task);
+
+/**
+ * @brief  Suspend la surveillance d'une tâche jusqu'à son prochain passage
+ * @param  task: valeur de @ref Watchdog_Task_t
+ * @retval None
+ */
+void Watchdog_Pause(uint8_t task);
+
+/**
+ * @brief  Passage de la tâche PWM et relevé des retards
+ * @note   A appeler à chaque période PWM : les retards d'une boucle
+ *         principale bloquée sont ainsi relevés avant le reset
+ * @retval None
+ */
+void Watchdog_Tick(void);
+
+/**
+ * @brief  Vérifie les délais et recharge l'IWDG si aucune tâche n'est en
+ *         retard
+ * @note   A appeler dans la boucle principale
+ * @retval None
+ */
+void Watchdog_Process(void);
+
+/**
+ * @brief  Recharge l'IWDG si le dernier contrôle n'a trouvé aucun retard
+ * @note   Pour les réveils périodiques en Stop (power.c), les tâches
+ *         étant gelées
+ * @retval None
+ */
+void Watchdog_Kick(void);
+
+/**
+ * @brief  Etat courant de la supervision
+ * @retval Relevé, mis à jour à l'appel
+ */
+const Watchdog_Report_t *Watchdog_GetReport(void);
+
+/**
+ * @brief  Retards relevés avant le dernier reset IWDG
+ * @retval Relevé, NULL si le dernier reset n'est pas dû à l'IWDG ou si
+ *         aucun retard n'a pu être relevé (boucle et interruptions bloquées)
+ */
+const Watchdog_Report_t *Watchdog_GetLast(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WATCHDOG_H__ */
@@ -0,0 +1,233 @@
+/**
+  ******************************************************************************
+  * @file    audio.c
+  * @brief   Echantillonnage audio par TIM6 et DMA, analyse de Goertzel.
+  *
+  *          Chaque moitié a son propre drapeau (un octet écrit par
+  *          l'interruption, effacé par la boucle) : aucun masquage n'est
+  *          nécessaire. Une moitié encore signalée quand le DMA la termine
+  *          à nouveau est comptée comme perdue.
+  *
+  *          La valeur moyenne (polarisation de l'entrée) est celle du bloc
+  *          précédent, retirée avant l'analyse.
+  ******************************************************************************
+  */
+#include "audio.h"
+#include <string.h>
+#include "adc.h"
+#include "tim.h"
+#include "settings.h"
+#include "output.h"
+
+/* 2 cos(2 pi k / AUDIO_BLOCK) en Q14 pour k = 2, 4, 16, 32, 64, 96 :
+   62,5 et 125 Hz, 500 Hz et 1 kHz, 2 et 3 kHz */
+static const int32_t Audio_Coeff[AUDIO_BINS] = {
+	32729, 32610, 30274, 23170, 0, -23170
+};
+
+static uint16_t Audio_Samples[2U * AUDIO_BLOCK];
+static volatile uint8_t Audio_Ready[2];
+static uint8_t Audio_Running;
+
+static int32_t Audio_Dc;
+static uint32_t Audio_Peak[AUDIO_BANDS];
+static int32_t Audio_BassAvg;
+static uint32_t Audio_LastBeat;
+static Audio_Stats_t Audio_Stats;
+
+/* Cibles calculées par bloc, niveaux lissés sous interruption */
+static volatile uint16_t Audio_Target[AUDIO_BANDS];
+static volatile uint16_t Audio_Flash;
+static uint16_t Audio_Level[AUDIO_BANDS];
+
+/* Racine carrée entière, bit par bit */
+static uint32_t Audio_Sqrt(uint64_t v)
+{
+	uint64_t bit = 1ULL << 62;
+	uint64_t r = 0;
+
+	while (bit > v) {
+		bit >>= 2;
+	}
+	while (bit != 0U) {
+		if (v >= r + bit) {
+			v -= r + bit;
+			r = (r >> 1) + bit;
+		} else {
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t)r;
+}
+
+/* Un échantillon dans chaque filtre : s0 = x + c.s1 - s2 */
+static inline void Audio_Goertzel(int32_t *s1, int32_t *s2, int32_t x)
+{
+	int32_t s0;
+	uint8_t i;
+
+	for (i = 0; i < AUDIO_BINS; i++) {
+		s0 = x + (int32_t)(((int64_t)Audio_Coeff[i] * s1[i]) >> 14) - s2[i];
+		s2[i] = s1[i];
+		s1[i] = s0;
+	}
+}
+
+static void Audio_Analyse(const uint16_t *x)
+{
+	int32_t s1[AUDIO_BINS] = {0};
+	int32_t s2[AUDIO_BINS] = {0};
+	uint32_t amp[AUDIO_BINS];
+	uint32_t band, level, energy = 0, sum = 0;
+	uint32_t now = HAL_GetTick();
+	int32_t a, b;
+	uint32_t pair;
+	int64_t p;
+	uint16_t i;
+	uint8_t gate;
+
+	for (i = 0; i < AUDIO_BLOCK; i += 2U) {
+		sum += (uint32_t)x[i] + x[i + 1U];
+		a = (int32_t)x[i] - Audio_Dc;
+		b = (int32_t)x[i + 1U] - Audio_Dc;
+		/* a.a + b.b en une instruction ; autour de la polarisation |a| <= 2048,
+		   au plus 2^30 par bloc */
+		pair = __PKHBT(a, b, 16);
+		energy = __SMLAD(pair, pair, energy);
+		Audio_Goertzel(s1, s2, a);
+		Audio_Goertzel(s1, s2, b);
+	}
+	Audio_Dc = (int32_t)(sum / AUDIO_BLOCK);
+
+	/* Amplitude : racine de s1^2 + s2^2 - c.s1.s2 */
+	for (i = 0; i < AUDIO_BINS; i++) {
+		p = (int64_t)s1[i] * s1[i] + (int64_t)s2[i] * s2[i]
+				- (((int64_t)Audio_Coeff[i] * s1[i]) >> 14) * s2[i];
+		amp[i] = Audio_Sqrt((p > 0) ? (uint64_t)p : 0U);
+	}
+
+	gate = (energy >= AUDIO_GATE_RMS * AUDIO_GATE_RMS * AUDIO_BLOCK);
+	for (i = 0; i < AUDIO_BANDS; i++) {
+		band = amp[2U * i] + amp[2U * i + 1U];
+		Audio_Peak[i] -= Audio_Peak[i] / AUDIO_AGC_DECAY;
+		if (Audio_Peak[i] < band) {
+			Audio_Peak[i] = band;
+		}
+		if (Audio_Peak[i] < AUDIO_AGC_FLOOR) {
+			Audio_Peak[i] = AUDIO_AGC_FLOOR;
+		}
+		/* Carré du niveau relatif : écarts accentués */
+		level = (uint32_t)(((uint64_t)band * 0xFFFFU) / Audio_Peak[i]);
+		Audio_Target[i] = gate ? (uint16_t)((level * level) >> 16) : 0U;
+	}
+
+	/* Temps sur les graves, comparés à leur moyenne glissante */
+	band = amp[0] + amp[1];
+	if (gate && band * 16U > (uint32_t)Audio_BassAvg * AUDIO_BEAT_RATIO_Q4
+			&& now - Audio_LastBeat >= AUDIO_BEAT_HOLD_MS) {
+		Audio_LastBeat = now;
+		Audio_Flash = 0xFFFFU;
+		Audio_Stats.beats++;
+	}
+	Audio_BassAvg += ((int32_t)band - Audio_BassAvg) / AUDIO_BEAT_AVG;
+}
+
+static void Audio_Start(void)
+{
+	memset((void *)Audio_Ready, 0, sizeof(Audio_Ready));
+	memset(Audio_Peak, 0, sizeof(Audio_Peak));
+	Audio_Dc = 2048;
+	Audio_BassAvg = 0;
+	Audio_LastBeat = HAL_GetTick();
+	if (HAL_ADC_Start_DMA(&hadc1, (uint32_t *)Audio_Samples, 2U * AUDIO_BLOCK) != HAL_OK) {
+		return;
+	}
+	HAL_TIM_Base_Start(&htim6);
+	Audio_Running = 1;
+}
+
+static void Audio_Stop(void)
+{
+	HAL_TIM_Base_Stop(&htim6);
+	/* Groupe régulier seul : les mesures injectées (sensor.h) continuent */
+	HAL_ADCEx_RegularStop_DMA(&hadc1);
+	memset((void *)Audio_Target, 0, sizeof(Audio_Target));
+	Audio_Flash = 0;
+	Audio_Running = 0;
+}
+
+void Audio_Process(void)
+{
+	uint8_t want = (Settings.effect == EFFECT_AUDIO && Output_GetSource() == OUTPUT_SRC_EFFECT);
+	uint32_t start, us;
+	uint8_t h;
+
+	if (want && !Audio_Running) {
+		Audio_Start();
+	} else if (!want && Audio_Running) {
+		Audio_Stop();
+	}
+	if (!Audio_Running) {
+		return;
+	}
+
+	for (h = 0; h < 2U; h++) {
+		if (!Audio_Ready[h]) {
+			continue;
+		}
+		start = TIMEBASE_NOW();
+		Audio_Analyse(&Audio_Samples[h * AUDIO_BLOCK]);
+		Audio_Ready[h] = 0;
+		us = (TIMEBASE_NOW() - start) / TIMEBASE_TICKS_PER_US;
+		Audio_Stats.busy_us = (us > 0xFFFFU) ? 0xFFFFU : (uint16_t)us;
+		if (Audio_Stats.busy_us > Audio_Stats.busy_max_us) {
+			Audio_Stats.busy_max_us = Audio_Stats.busy_us;
+		}
+		Audio_Stats.blocks++;
+	}
+}
+
+void Audio_DMA_Callback(uint8_t half)
+{
+	if (Audio_Ready[half]) {
+		Audio_Stats.overruns++;
+	}
+	Audio_Ready[half] = 1;
+}
+
+void Audio_Render(uint16_t *r, uint16_t *g, uint16_t *b)
+{
+	uint32_t out[AUDIO_BANDS];
+	uint16_t t;
+	uint8_t i;
+
+	for (i = 0; i < AUDIO_BANDS; i++) {
+		/* Attaque en ~4 périodes PWM, retombée en ~64 */
+		t = Audio_Target[i];
+		if (t > Audio_Level[i]) {
+			Audio_Level[i] += (t - Audio_Level[i] + 3U) / 4U;
+		} else {
+			Audio_Level[i] -= (Audio_Level[i] - t + 63U) / 64U;
+		}
+		out[i] = (uint32_t)Audio_Level[i] + Audio_Flash;
+		if (out[i] > 0xFFFFU) {
+			out[i] = 0xFFFFU;
+		}
+	}
+	Audio_Flash -= (Audio_Flash + 31U) / 32U;
+
+	*r = (uint16_t)out[0];
+	*g = (uint16_t)out[1];
+	*b = (uint16_t)out[2];
+}
+
+uint8_t Audio_IsRunning(void)
+{
+	return Audio_Running;
+}
+
+const Audio_Stats_t *Audio_GetStats(void)
+{
+	return &Audio_Stats;
+}
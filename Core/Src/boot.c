@@ -0,0 +1,870 @@
+/**
+  ******************************************************************************
+  * @file    boot.c
+  * @brief   Chargeur résident et demande de mise à jour.
+  *
+  *          Le chargeur ne dépend ni de la HAL ni du reste du programme :
+  *          tout ce qu'il exécute est dans les sections .boot_* (région BOOT
+  *          de STM32L412K8TX_FLASH.ld), l'application pouvant être effacée
+  *          sous lui. Ses variables sont sur la pile (Boot_Ctx_t), aucune
+  *          initialisation de .data ou .bss n'est nécessaire.
+  *
+  *          - .boot_vector, .boot_text, .boot_rodata : en flash, démarrage
+  *            et descripteurs USB ;
+  *          - .boot_ram : copié en SRAM2 et exécuté de là pendant la mise à
+  *            jour. Aucun appel hors de cette section (pas de memcpy, pas
+  *            de chaînes littérales, boucles de copie sur pointeurs
+  *            volatiles pour que le compilateur ne les remplace pas).
+  *
+  *          L'USB est servi par scrutation, directement sur les registres
+  *          (EP0 contrôle, EP1 bulk 0x01 / 0x81, EP2 interruption 0x82
+  *          jamais utilisé), à 16 MHz sur HSI16 et HSI48 recalé par le CRS.
+  *
+  *          La flash est pilotée par une machine d'états non bloquante :
+  *          deux tampons de page, l'un se remplit pendant que l'autre est
+  *          effacé puis programmé. Le premier double-mot de l'application
+  *          (pile et vecteur de reset) n'est programmé qu'une fois l'image
+  *          vérifiée : une mise à jour interrompue laisse le chargeur actif.
+  ******************************************************************************
+  */
+#include "boot.h"
+
+#define BOOT_TEXT               __attribute__((section(".boot_text")))
+#define BOOT_CONST              __attribute__((section(".boot_rodata")))
+#define BOOT_RAM                __attribute__((section(".boot_ram"), noinline))
+
+/* Identifiants de l'application (usbd_desc.c) */
+#define BOOT_VID                0x0483U
+#define BOOT_PID                0x5740U
+
+#define BOOT_EPR(ep)            (*(__IO uint16_t *)(USB_BASE + (ep) * 4U))
+#define BOOT_PMA(off)           (*(__IO uint16_t *)(USB_PMAADDR + (off)))
+#define BOOT_TX_ADDR(ep)        BOOT_PMA((ep) * 8U)
+#define BOOT_TX_COUNT(ep)       BOOT_PMA((ep) * 8U + 2U)
+#define BOOT_RX_ADDR(ep)        BOOT_PMA((ep) * 8U + 4U)
+#define BOOT_RX_COUNT(ep)       BOOT_PMA((ep) * 8U + 6U)
+
+/* Réception de 64 octets : blocs de 32 (BL_SIZE), NUM_BLOCK = 1 */
+#define BOOT_RX_64              0x8400U
+#define BOOT_PACKET             64U
+
+#define BOOT_PAGE_WORDS         (FLASH_PAGE_SIZE / 4U)
+#define BOOT_PAGE_DWORDS        (FLASH_PAGE_SIZE / 8U)
+#define BOOT_NONE               0xFFU
+
+#define BOOT_FLASH_ERRORS       (FLASH_SR_OPERR | FLASH_SR_PROGERR | FLASH_SR_WRPERR | FLASH_SR_PGAERR \
+		| FLASH_SR_SIZERR | FLASH_SR_PGSERR | FLASH_SR_MISERR | FLASH_SR_FASTERR | FLASH_SR_RDERR \
+		| FLASH_SR_OPTVERR)
+
+#define BOOT_FRAME_BUF          (BOOT_FRAME_HEADER + BOOT_FRAME_MAX + 4U + BOOT_PACKET)
+
+typedef enum {
+	BOOT_PAGE_FREE = 0,
+	BOOT_PAGE_FILLING,      /* Reçoit les trames, effacée dès que possible */
+	BOOT_PAGE_READY         /* Complète, à programmer */
+} Boot_PageState_t;
+
+typedef struct {
+	uint32_t data[BOOT_PAGE_WORDS];
+	uint32_t base;
+	uint16_t index;         /* Prochain double-mot à programmer */
+	uint8_t state;
+	uint8_t erased;
+} Boot_Page_t;
+
+typedef struct {
+	/* USB */
+	uint8_t setup[8];
+	uint8_t line_coding[8];
+	const uint8_t *ep0_data;
+	uint16_t ep0_left;
+	uint8_t ep0_zlp;
+	uint8_t address;        /* Appliquée après l'étape de statut */
+	uint8_t configured;
+	uint8_t line_pending;   /* Données de SET_LINE_CODING attendues */
+	uint8_t rx_ready;       /* Paquet en attente dans la PMA (EP 0x01) */
+	uint8_t tx_busy;
+	/* Trames */
+	uint32_t frame[BOOT_FRAME_BUF / 4U];
+	uint32_t frame_len;
+	/* Image */
+	uint8_t started;
+	uint8_t error;
+	uint32_t length;
+	uint32_t crc;
+	uint32_t first[2];      /* Premier double-mot, programmé en dernier */
+	uint32_t next;          /* Adresse minimale de la trame suivante */
+	/* Flash */
+	Boot_Page_t page[2];
+	uint8_t fill;           /* Page en remplissage ou BOOT_NONE */
+	uint8_t flash_op;
+	uint32_t flash_addr;
+} Boot_Ctx_t;
+
+extern uint32_t _estack;
+extern uint32_t _sboot_ram;
+extern uint32_t _eboot_ram;
+extern uint32_t _siboot_ram;
+
+void Boot_Reset(void) BOOT_TEXT;
+static void Boot_Fault(void) BOOT_TEXT;
+static void Boot_Main(void) BOOT_RAM __attribute__((long_call, noreturn));
+
+__attribute__((section(".boot_vector"), used))
+static void (*const Boot_Vector[])(void) = {
+	(void (*)(void))&_estack,
+	Boot_Reset,
+	Boot_Fault,             /* NMI */
+	Boot_Fault,             /* HardFault */
+	Boot_Fault,             /* MemManage */
+	Boot_Fault,             /* BusFault */
+	Boot_Fault              /* UsageFault */
+};
+
+BOOT_CONST static const uint8_t Boot_DeviceDesc[18] = {
+	18, 0x01, 0x00, 0x02,
+	0x02, 0x00, 0x00,                       /* CDC */
+	BOOT_PACKET,
+	(uint8_t)BOOT_VID, (uint8_t)(BOOT_VID >> 8),
+	(uint8_t)BOOT_PID, (uint8_t)(BOOT_PID >> 8),
+	(uint8_t)BOOT_BCD_DEVICE, (uint8_t)(BOOT_BCD_DEVICE >> 8),
+	0, 2, 0,                                /* Produit seul */
+	1
+};
+
+BOOT_CONST static const uint8_t Boot_ConfigDesc[67] = {
+	9, 0x02, 67, 0, 2, 1, 0, 0x80, 50,
+	/* Interface 0 : communication */
+	9, 0x04, 0, 0, 1, 0x02, 0x02, 0x01, 0,
+	5, 0x24, 0x00, 0x10, 0x01,              /* En-tête */
+	5, 0x24, 0x01, 0x00, 0x01,              /* Gestion d'appel */
+	4, 0x24, 0x02, 0x02,                    /* ACM */
+	5, 0x24, 0x06, 0, 1,                    /* Union */
+	7, 0x05, 0x82, 0x03, 8, 0, 16,
+	/* Interface 1 : données */
+	9, 0x04, 1, 0, 2, 0x0A, 0x00, 0x00, 0,
+	7, 0x05, 0x01, 0x02, BOOT_PACKET, 0, 0,
+	7, 0x05, 0x81, 0x02, BOOT_PACKET, 0, 0
+};
+
+BOOT_CONST static const uint8_t Boot_LangDesc[4] = { 4, 0x03, 0x09, 0x04 };
+
+BOOT_CONST static const uint8_t Boot_ProductDesc[26] = {
+	26, 0x03, 'A', 0, 'n', 0, 'i', 0, 'm', 0, 'L', 0, 'E', 0, 'D', 0,
+	' ', 0, 'b', 0, 'o', 0, 'o', 0, 't', 0
+};
+
+BOOT_CONST static const uint8_t Boot_Zero[2] = { 0, 0 };
+
+/* ---------------------------------------------------------------------------
+ * Démarrage (flash)
+ * ------------------------------------------------------------------------- */
+
+static void Boot_Fault(void)
+{
+	for (;;) {
+	}
+}
+
+void Boot_Reset(void)
+{
+	const uint32_t *app = (const uint32_t *)BOOT_APP_BASE;
+	const volatile uint32_t *src = &_siboot_ram;
+	volatile uint32_t *dst = &_sboot_ram;
+
+	if (BOOT_REQUEST != BOOT_REQUEST_MAGIC
+			&& app[0] > SRAM1_BASE && app[0] <= SRAM1_BASE + SRAM1_SIZE_MAX
+			&& app[1] > BOOT_APP_BASE && app[1] < BOOT_APP_BASE + BOOT_APP_SIZE) {
+		SCB->VTOR = BOOT_APP_BASE;
+		__asm volatile ("msr msp, %0\n\tbx %1" : : "r" (app[0]), "r" (app[1]));
+	}
+	BOOT_REQUEST = 0;
+
+	while (dst < &_eboot_ram) {
+		*dst++ = *src++;
+	}
+	Boot_Main();
+}
+
+/* ---------------------------------------------------------------------------
+ * USB (SRAM2)
+ * ------------------------------------------------------------------------- */
+
+BOOT_RAM static void Boot_EpStat(uint8_t ep, uint16_t mask, uint16_t stat)
+{
+	uint16_t v = BOOT_EPR(ep);
+
+	/* Bits de statut à bascule : écrire 1 là où ils diffèrent */
+	BOOT_EPR(ep) = (uint16_t)(((v & (USB_EPREG_MASK | mask)) ^ stat) | USB_EP_CTR_RX | USB_EP_CTR_TX);
+}
+
+BOOT_RAM static void Boot_EpClear(uint8_t ep, uint16_t ctr)
+{
+	BOOT_EPR(ep) = (uint16_t)(((BOOT_EPR(ep) & USB_EPREG_MASK) | USB_EP_CTR_RX | USB_EP_CTR_TX) & ~ctr);
+}
+
+BOOT_RAM static void Boot_EpSend(uint8_t ep, const uint8_t *buf, uint16_t len)
+{
+	volatile uint16_t *pma = &BOOT_PMA(BOOT_TX_ADDR(ep));
+	uint16_t i;
+	uint16_t w;
+
+	for (i = 0; i < len; i += 2U) {
+		w = buf[i];
+		if (i + 1U < len) {
+			w |= (uint16_t)buf[i + 1U] << 8;
+		}
+		*pma++ = w;
+	}
+	BOOT_TX_COUNT(ep) = len;
+	Boot_EpStat(ep, USB_EPTX_STAT, USB_EP_TX_VALID);
+}
+
+BOOT_RAM static uint16_t Boot_EpRead(uint8_t ep, volatile uint8_t *buf, uint16_t max)
+{
+	volatile uint16_t *pma = &BOOT_PMA(BOOT_RX_ADDR(ep));
+	uint16_t len = BOOT_RX_COUNT(ep) & 0x3FFU;
+	uint16_t i;
+	uint16_t w;
+
+	if (len > max) {
+		len = max;
+	}
+	for (i = 0; i < len; i += 2U) {
+		w = *pma++;
+		buf[i] = (uint8_t)w;
+		if (i + 1U < len) {
+			buf[i + 1U] = (uint8_t)(w >> 8);
+		}
+	}
+	return len;
+}
+
+BOOT_RAM static void Boot_UsbInit(void)
+{
+	volatile uint32_t delay;
+
+	RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN | RCC_APB1ENR1_CRSEN | RCC_APB1ENR1_USBFSEN;
+	RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+	RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
+	PWR->CR2 |= PWR_CR2_USV;
+
+	/* HSI16 en horloge système (0 état d'attente), HSI48 pour l'USB */
+	RCC->CR |= RCC_CR_HSION;
+	while ((RCC->CR & RCC_CR_HSIRDY) == 0U) {
+	}
+	RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_HSI;
+	while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI) {
+	}
+	RCC->CRRCR |= RCC_CRRCR_HSI48ON;
+	while ((RCC->CRRCR & RCC_CRRCR_HSI48RDY) == 0U) {
+	}
+	RCC->CCIPR &= ~RCC_CCIPR_CLK48SEL;
+	CRS->CR |= CRS_CR_AUTOTRIMEN | CRS_CR_CEN;
+
+	/* PA11 / PA12 en AF10 */
+	GPIOA->OSPEEDR |= (3UL << (11U * 2U)) | (3UL << (12U * 2U));
+	GPIOA->AFR[1] = (GPIOA->AFR[1] & ~((0xFUL << 12) | (0xFUL << 16))) | (10UL << 12) | (10UL << 16);
+	GPIOA->MODER = (GPIOA->MODER & ~((3UL << (11U * 2U)) | (3UL << (12U * 2U))))
+			| (2UL << (11U * 2U)) | (2UL << (12U * 2U));
+
+	USB->CNTR = USB_CNTR_FRES;
+	for (delay = 0; delay < 100U; delay++) {
+	}
+	USB->CNTR = 0;
+	USB->ISTR = 0;
+	USB->BTABLE = 0;
+	USB->BCDR |= USB_BCDR_DPPU;
+}
+
+BOOT_RAM static void Boot_UsbReset(Boot_Ctx_t *c)
+{
+	c->configured = 0;
+	c->address = 0;
+	c->ep0_left = 0;
+	c->ep0_zlp = 0;
+	c->line_pending = 0;
+	c->rx_ready = 0;
+	c->tx_busy = 0;
+
+	/* Table des tampons en 0x00, tampons de 0x40 à 0x147 */
+	BOOT_TX_ADDR(0) = 0x40;
+	BOOT_TX_COUNT(0) = 0;
+	BOOT_RX_ADDR(0) = 0x80;
+	BOOT_RX_COUNT(0) = BOOT_RX_64;
+	BOOT_TX_ADDR(1) = 0xC0;
+	BOOT_TX_COUNT(1) = 0;
+	BOOT_RX_ADDR(1) = 0x100;
+	BOOT_RX_COUNT(1) = BOOT_RX_64;
+	BOOT_TX_ADDR(2) = 0x140;
+	BOOT_TX_COUNT(2) = 0;
+
+	BOOT_EPR(0) = USB_EP_CONTROL;
+	Boot_EpStat(0, USB_EPRX_STAT, USB_EP_RX_VALID);
+	Boot_EpStat(0, USB_EPTX_STAT, USB_EP_TX_NAK);
+	USB->DADDR = USB_DADDR_EF;
+}
+
+BOOT_RAM static void Boot_Configure(void)
+{
+	uint16_t v;
+
+	/* Bascules de données remises à DATA0 */
+	v = BOOT_EPR(1);
+	BOOT_EPR(1) = (uint16_t)(USB_EP_BULK | 1U | (v & (USB_EP_DTOG_RX | USB_EP_DTOG_TX))
+			| USB_EP_CTR_RX | USB_EP_CTR_TX);
+	Boot_EpStat(1, USB_EPRX_STAT, USB_EP_RX_VALID);
+	Boot_EpStat(1, USB_EPTX_STAT, USB_EP_TX_NAK);
+	v = BOOT_EPR(2);
+	BOOT_EPR(2) = (uint16_t)(USB_EP_INTERRUPT | 2U | (v & USB_EP_DTOG_TX) | USB_EP_CTR_RX | USB_EP_CTR_TX);
+	Boot_EpStat(2, USB_EPTX_STAT, USB_EP_TX_NAK);
+}
+
+BOOT_RAM static void Boot_Ep0Next(Boot_Ctx_t *c)
+{
+	uint16_t n = (c->ep0_left > BOOT_PACKET) ? BOOT_PACKET : c->ep0_left;
+
+	Boot_EpSend(0, c->ep0_data, n);
+	c->ep0_data += n;
+	c->ep0_left -= n;
+}
+
+BOOT_RAM static void Boot_Setup(Boot_Ctx_t *c)
+{
+	const uint8_t *s = c->setup;
+	uint16_t value = s[2] | ((uint16_t)s[3] << 8);
+	uint16_t length = s[6] | ((uint16_t)s[7] << 8);
+	const uint8_t *data = 0;
+	uint16_t n = 0;
+
+	c->ep0_left = 0;
+	c->ep0_zlp = 0;
+	c->line_pending = 0;
+
+	switch (((uint16_t)s[0] << 8) | s[1]) {
+	case 0x8006:            /* GET_DESCRIPTOR */
+		if ((value >> 8) == 1U) {
+			data = Boot_DeviceDesc;
+			n = sizeof(Boot_DeviceDesc);
+		} else if ((value >> 8) == 2U) {
+			data = Boot_ConfigDesc;
+			n = sizeof(Boot_ConfigDesc);
+		} else if (value == 0x0300U) {
+			data = Boot_LangDesc;
+			n = sizeof(Boot_LangDesc);
+		} else if (value == 0x0302U) {
+			data = Boot_ProductDesc;
+			n = sizeof(Boot_ProductDesc);
+		}
+		break;
+
+	case 0x8008:            /* GET_CONFIGURATION */
+		data = &c->configured;
+		n = 1;
+		break;
+
+	case 0x8000:            /* GET_STATUS */
+	case 0x8100:
+	case 0x8200:
+		data = Boot_Zero;
+		n = 2;
+		break;
+
+	case 0xA121:            /* GET_LINE_CODING */
+		data = c->line_coding;
+		n = 7;
+		break;
+
+	case 0x0005:            /* SET_ADDRESS */
+		c->address = (uint8_t)(value & 0x7FU);
+		Boot_EpSend(0, 0, 0);
+		return;
+
+	case 0x0009:            /* SET_CONFIGURATION */
+		if (value != 0U) {
+			Boot_Configure();
+		}
+		c->configured = (uint8_t)value;
+		Boot_EpSend(0, 0, 0);
+		return;
+
+	case 0x0201:            /* CLEAR_FEATURE (point de terminaison) */
+	case 0x2122:            /* SET_CONTROL_LINE_STATE */
+		Boot_EpSend(0, 0, 0);
+		return;
+
+	case 0x2120:            /* SET_LINE_CODING : données sur EP0 OUT */
+		c->line_pending = 1;
+		return;
+
+	default:
+		break;
+	}
+
+	if (data == 0) {
+		Boot_EpStat(0, USB_EPTX_STAT, USB_EP_TX_STALL);
+		Boot_EpStat(0, USB_EPRX_STAT, USB_EP_RX_STALL);
+		return;
+	}
+	c->ep0_data = data;
+	c->ep0_left = (length < n) ? length : n;
+	c->ep0_zlp = (c->ep0_left < length) && (c->ep0_left % BOOT_PACKET) == 0U;
+	Boot_Ep0Next(c);
+}
+
+BOOT_RAM static void Boot_UsbPoll(Boot_Ctx_t *c)
+{
+	uint16_t istr = USB->ISTR;
+	uint16_t v;
+	uint8_t ep;
+
+	if (istr & USB_ISTR_RESET) {
+		USB->ISTR = (uint16_t)~USB_ISTR_RESET;
+		Boot_UsbReset(c);
+		return;
+	}
+	/* Suspension, reprise, SOF, erreurs : sans effet ici */
+	USB->ISTR = USB_ISTR_CTR | USB_ISTR_RESET;
+
+	while ((istr = USB->ISTR) & USB_ISTR_CTR) {
+		ep = istr & USB_ISTR_EP_ID;
+		v = BOOT_EPR(ep);
+		if (ep == 0U) {
+			if (v & USB_EP_CTR_TX) {
+				Boot_EpClear(0, USB_EP_CTR_TX);
+				if (c->address != 0U && (USB->DADDR & 0x7FU) == 0U) {
+					USB->DADDR = USB_DADDR_EF | c->address;
+				} else if (c->ep0_left > 0U) {
+					Boot_Ep0Next(c);
+				} else if (c->ep0_zlp) {
+					c->ep0_zlp = 0;
+					Boot_EpSend(0, 0, 0);
+				}
+			}
+			if (v & USB_EP_CTR_RX) {
+				Boot_EpClear(0, USB_EP_CTR_RX);
+				if (v & USB_EP_SETUP) {
+					Boot_EpRead(0, c->setup, sizeof(c->setup));
+					Boot_EpStat(0, USB_EPRX_STAT, USB_EP_RX_VALID);
+					Boot_Setup(c);
+				} else {
+					if (c->line_pending) {
+						Boot_EpRead(0, c->line_coding, sizeof(c->line_coding));
+						c->line_pending = 0;
+						Boot_EpSend(0, 0, 0);
+					}
+					Boot_EpStat(0, USB_EPRX_STAT, USB_EP_RX_VALID);
+				}
+			}
+		} else if (ep == 1U) {
+			if (v & USB_EP_CTR_RX) {
+				/* L'EP reste en NAK jusqu'à la lecture du paquet */
+				Boot_EpClear(1, USB_EP_CTR_RX);
+				c->rx_ready = 1;
+			}
+			if (v & USB_EP_CTR_TX) {
+				Boot_EpClear(1, USB_EP_CTR_TX);
+				c->tx_busy = 0;
+			}
+		} else {
+			Boot_EpClear(ep, USB_EP_CTR_RX | USB_EP_CTR_TX);
+		}
+	}
+}
+
+BOOT_RAM static void Boot_Reply(Boot_Ctx_t *c, uint8_t type, uint8_t status, uint32_t arg)
+{
+	uint8_t r[8];
+
+	if (!c->configured || c->tx_busy) {
+		/* Réponse précédente non lue : celle-ci est perdue */
+		return;
+	}
+	r[0] = BOOT_FRAME_SYNC;
+	r[1] = type;
+	r[2] = status;
+	r[3] = 0;
+	r[4] = (uint8_t)arg;
+	r[5] = (uint8_t)(arg >> 8);
+	r[6] = (uint8_t)(arg >> 16);
+	r[7] = (uint8_t)(arg >> 24);
+	c->tx_busy = 1;
+	Boot_EpSend(1, r, sizeof(r));
+}
+
+/* ---------------------------------------------------------------------------
+ * CRC-32 (unité CRC : entrée et sortie inversées, identique à zlib)
+ * ------------------------------------------------------------------------- */
+
+BOOT_RAM static void Boot_CrcStart(void)
+{
+	CRC->INIT = 0xFFFFFFFFU;
+	CRC->CR = CRC_CR_REV_IN | CRC_CR_REV_OUT | CRC_CR_RESET;
+}
+
+BOOT_RAM static void Boot_CrcFeed(const volatile uint32_t *p, uint32_t words)
+{
+	while (words-- > 0U) {
+		CRC->DR = *p++;
+	}
+}
+
+BOOT_RAM static uint32_t Boot_CrcResult(void)
+{
+	return ~CRC->DR;
+}
+
+/* ---------------------------------------------------------------------------
+ * Flash
+ * ------------------------------------------------------------------------- */
+
+BOOT_RAM static void Boot_Fail(Boot_Ctx_t *c, uint8_t type, uint8_t status, uint32_t arg)
+{
+	if (c->error == BOOT_OK) {
+		c->error = status;
+		Boot_Reply(c, type, status, arg);
+	}
+}
+
+/* Page la plus basse à programmer, sinon page en remplissage non effacée */
+BOOT_RAM static Boot_Page_t *Boot_NextPage(Boot_Ctx_t *c)
+{
+	Boot_Page_t *p = 0;
+	uint8_t i;
+
+	for (i = 0; i < 2U; i++) {
+		if (c->page[i].state == BOOT_PAGE_READY && (p == 0 || c->page[i].base < p->base)) {
+			p = &c->page[i];
+		}
+	}
+	if (p == 0 && c->fill != BOOT_NONE && !c->page[c->fill].erased) {
+		p = &c->page[c->fill];
+	}
+	return p;
+}
+
+BOOT_RAM static void Boot_FlashPoll(Boot_Ctx_t *c)
+{
+	Boot_Page_t *p;
+	uint32_t addr;
+	uint32_t i;
+
+	if (FLASH->SR & FLASH_SR_BSY) {
+		return;
+	}
+	if (c->flash_op) {
+		c->flash_op = 0;
+		FLASH->CR &= ~(FLASH_CR_PER | FLASH_CR_PG);
+		if (FLASH->SR & BOOT_FLASH_ERRORS) {
+			FLASH->SR = BOOT_FLASH_ERRORS;
+			Boot_Fail(c, BOOT_FRAME_DATA, BOOT_ERR_FLASH, c->flash_addr);
+		}
+		FLASH->SR = FLASH_SR_EOP;
+	}
+	if (c->error != BOOT_OK || (p = Boot_NextPage(c)) == 0) {
+		return;
+	}
+
+	if (!p->erased) {
+		p->erased = 1;
+		c->flash_op = 1;
+		c->flash_addr = p->base;
+		FLASH->CR = (FLASH->CR & ~(FLASH_CR_PNB | FLASH_CR_PG))
+				| FLASH_CR_PER | (((p->base - FLASH_BASE) / FLASH_PAGE_SIZE) << FLASH_CR_PNB_Pos);
+		FLASH->CR |= FLASH_CR_STRT;
+		return;
+	}
+	if (p->state != BOOT_PAGE_READY) {
+		return;
+	}
+
+	/* Double-mots effacés sautés ; celui des vecteurs attend la fin */
+	for (i = p->index; i < BOOT_PAGE_DWORDS; i++) {
+		if ((p->data[2U * i] & p->data[2U * i + 1U]) != 0xFFFFFFFFU
+				&& !(p->base == BOOT_APP_BASE && i == 0U)) {
+			break;
+		}
+	}
+	if (i == BOOT_PAGE_DWORDS) {
+		p->state = BOOT_PAGE_FREE;
+		return;
+	}
+	addr = p->base + i * 8U;
+	p->index = (uint16_t)(i + 1U);
+	c->flash_op = 1;
+	c->flash_addr = addr;
+	FLASH->CR |= FLASH_CR_PG;
+	*(__IO uint32_t *)addr = p->data[2U * i];
+	__ISB();
+	*(__IO uint32_t *)(addr + 4U) = p->data[2U * i + 1U];
+}
+
+BOOT_RAM static uint8_t Boot_FlashIdle(Boot_Ctx_t *c)
+{
+	return !c->flash_op && c->page[0].state == BOOT_PAGE_FREE && c->page[1].state == BOOT_PAGE_FREE;
+}
+
+/* ---------------------------------------------------------------------------
+ * Trames
+ * ------------------------------------------------------------------------- */
+
+BOOT_RAM static void Boot_Start(Boot_Ctx_t *c, uint32_t length, const uint32_t *payload, uint16_t len)
+{
+	c->started = 0;
+	c->error = BOOT_OK;
+	c->page[0].state = BOOT_PAGE_FREE;
+	c->page[1].state = BOOT_PAGE_FREE;
+	c->fill = BOOT_NONE;
+
+	if (len < 4U || length < 8U || length > BOOT_APP_SIZE || (length % 8U) != 0U) {
+		Boot_Fail(c, BOOT_FRAME_START, BOOT_ERR_ADDR, length);
+		return;
+	}
+	c->started = 1;
+	c->length = length;
+	c->crc = payload[0];
+	c->first[0] = 0xFFFFFFFFU;
+	c->first[1] = 0xFFFFFFFFU;
+	c->next = BOOT_APP_BASE;
+	Boot_Reply(c, BOOT_FRAME_START, BOOT_OK, length);
+}
+
+/* Retourne 0 tant qu'aucun tampon de page n'est libre */
+BOOT_RAM static uint8_t Boot_Data(Boot_Ctx_t *c, uint32_t addr, const uint32_t *payload, uint16_t len)
+{
+	uint32_t base = addr & ~(FLASH_PAGE_SIZE - 1U);
+	volatile uint32_t *dst;
+	Boot_Page_t *p;
+	uint32_t i;
+
+	if (c->error != BOOT_OK) {
+		return 1;
+	}
+	if (!c->started) {
+		Boot_Fail(c, BOOT_FRAME_DATA, BOOT_ERR_SEQ, addr);
+		return 1;
+	}
+	if ((addr % 8U) != 0U || (len % 8U) != 0U || addr < c->next
+			|| addr + len > BOOT_APP_BASE + c->length
+			|| ((addr + len - 1U) & ~(FLASH_PAGE_SIZE - 1U)) != base) {
+		Boot_Fail(c, BOOT_FRAME_DATA, BOOT_ERR_ADDR, addr);
+		return 1;
+	}
+
+	if (c->fill != BOOT_NONE && c->page[c->fill].base != base) {
+		c->page[c->fill].state = BOOT_PAGE_READY;
+		c->fill = BOOT_NONE;
+	}
+	if (c->fill == BOOT_NONE) {
+		if (c->page[0].state == BOOT_PAGE_FREE) {
+			c->fill = 0;
+		} else if (c->page[1].state == BOOT_PAGE_FREE) {
+			c->fill = 1;
+		} else {
+			return 0;
+		}
+		p = &c->page[c->fill];
+		p->base = base;
+		p->index = 0;
+		p->erased = 0;
+		p->state = BOOT_PAGE_FILLING;
+		dst = p->data;
+		for (i = 0; i < BOOT_PAGE_WORDS; i++) {
+			dst[i] = 0xFFFFFFFFU;
+		}
+	}
+
+	dst = &c->page[c->fill].data[(addr - base) / 4U];
+	for (i = 0; i < len / 4U; i++) {
+		dst[i] = payload[i];
+	}
+	if (addr == BOOT_APP_BASE) {
+		c->first[0] = payload[0];
+		c->first[1] = payload[1];
+	}
+	c->next = addr + len;
+	return 1;
+}
+
+BOOT_RAM static void Boot_Launch(Boot_Ctx_t *c)
+{
+	uint32_t i;
+
+	/* Le vecteur de reset rend l'application visible au chargeur */
+	FLASH->CR |= FLASH_CR_PG;
+	*(__IO uint32_t *)BOOT_APP_BASE = c->first[0];
+	__ISB();
+	*(__IO uint32_t *)(BOOT_APP_BASE + 4U) = c->first[1];
+	while (FLASH->SR & FLASH_SR_BSY) {
+	}
+	FLASH->CR &= ~FLASH_CR_PG;
+	FLASH->CR |= FLASH_CR_LOCK;
+
+	Boot_Reply(c, BOOT_FRAME_END, BOOT_OK, c->length);
+	for (i = 0; i < 1000000U && c->tx_busy; i++) {
+		Boot_UsbPoll(c);
+	}
+	/* Détachement, puis redémarrage sur l'application */
+	USB->BCDR &= ~USB_BCDR_DPPU;
+	for (i = 0; i < 100000U; i++) {
+		__NOP();
+	}
+	/* NVIC_SystemReset n'est pas forcément en ligne : il serait en flash */
+	__DSB();
+	SCB->AIRCR = (0x5FAUL << SCB_AIRCR_VECTKEY_Pos) | (SCB->AIRCR & SCB_AIRCR_PRIGROUP_Msk)
+			| SCB_AIRCR_SYSRESETREQ_Msk;
+	__DSB();
+	for (;;) {
+	}
+}
+
+/* Retourne 0 tant que la flash n'a pas fini */
+BOOT_RAM static uint8_t Boot_End(Boot_Ctx_t *c)
+{
+	uint32_t crc;
+
+	if (c->error != BOOT_OK) {
+		/* L'hôte attend une réponse à la fin : l'erreur est répétée */
+		Boot_Reply(c, BOOT_FRAME_END, c->error, 0);
+		return 1;
+	}
+	if (!c->started) {
+		Boot_Fail(c, BOOT_FRAME_END, BOOT_ERR_SEQ, 0);
+		return 1;
+	}
+	if (c->fill != BOOT_NONE) {
+		c->page[c->fill].state = BOOT_PAGE_READY;
+		c->fill = BOOT_NONE;
+	}
+	if (!Boot_FlashIdle(c)) {
+		return 0;
+	}
+
+	/* Relecture : caches vidés, vecteurs pris dans la RAM */
+	FLASH->ACR &= ~(FLASH_ACR_DCEN | FLASH_ACR_ICEN);
+	FLASH->ACR |= FLASH_ACR_DCRST | FLASH_ACR_ICRST;
+	FLASH->ACR &= ~(FLASH_ACR_DCRST | FLASH_ACR_ICRST);
+	FLASH->ACR |= FLASH_ACR_DCEN | FLASH_ACR_ICEN;
+	Boot_CrcStart();
+	Boot_CrcFeed(c->first, 2U);
+	Boot_CrcFeed((const volatile uint32_t *)(BOOT_APP_BASE + 8U), (c->length - 8U) / 4U);
+	crc = Boot_CrcResult();
+	if (crc != c->crc) {
+		Boot_Fail(c, BOOT_FRAME_END, BOOT_ERR_IMAGE, crc);
+		return 1;
+	}
+	Boot_Launch(c);
+	return 1;
+}
+
+BOOT_RAM static void Boot_Drop(Boot_Ctx_t *c, uint32_t n)
+{
+	volatile uint8_t *b = (volatile uint8_t *)c->frame;
+	uint32_t i;
+
+	for (i = n; i < c->frame_len; i++) {
+		b[i - n] = b[i];
+	}
+	c->frame_len -= n;
+}
+
+BOOT_RAM static void Boot_Parse(Boot_Ctx_t *c)
+{
+	const uint8_t *b = (const uint8_t *)c->frame;
+	uint16_t len;
+	uint32_t total;
+	uint32_t arg;
+	uint32_t crc;
+	uint8_t done = 1;
+
+	if (c->frame_len < BOOT_FRAME_HEADER) {
+		return;
+	}
+	len = b[2] | ((uint16_t)b[3] << 8);
+	if (b[0] != BOOT_FRAME_SYNC || len > BOOT_FRAME_MAX || (len % 4U) != 0U) {
+		/* Resynchronisation octet par octet */
+		Boot_Drop(c, 1);
+		return;
+	}
+	total = BOOT_FRAME_HEADER + len + 4U;
+	if (c->frame_len < total) {
+		return;
+	}
+
+	arg = c->frame[1];
+	Boot_CrcStart();
+	Boot_CrcFeed(c->frame, (BOOT_FRAME_HEADER + len) / 4U);
+	crc = Boot_CrcResult();
+	if (crc != c->frame[(BOOT_FRAME_HEADER + len) / 4U]) {
+		Boot_Fail(c, b[1], BOOT_ERR_CRC, arg);
+	} else if (b[1] == BOOT_FRAME_START) {
+		Boot_Start(c, arg, &c->frame[2], len);
+	} else if (b[1] == BOOT_FRAME_DATA) {
+		done = Boot_Data(c, arg, &c->frame[2], len);
+	} else if (b[1] == BOOT_FRAME_END) {
+		done = Boot_End(c);
+	}
+	if (done) {
+		Boot_Drop(c, total);
+	}
+}
+
+BOOT_RAM static void Boot_Receive(Boot_Ctx_t *c)
+{
+	if (!c->rx_ready || c->frame_len + BOOT_PACKET > sizeof(c->frame)) {
+		/* Tampon plein : l'hôte attend sur NAK */
+		return;
+	}
+	c->frame_len += Boot_EpRead(1, (volatile uint8_t *)c->frame + c->frame_len, BOOT_PACKET);
+	c->rx_ready = 0;
+	Boot_EpStat(1, USB_EPRX_STAT, USB_EP_RX_VALID);
+}
+
+static void Boot_Main(void)
+{
+	Boot_Ctx_t ctx;
+	Boot_Ctx_t *c = &ctx;
+
+	c->line_coding[0] = 0x00;       /* 115200 8N1 */
+	c->line_coding[1] = 0xC2;
+	c->line_coding[2] = 0x01;
+	c->line_coding[3] = 0x00;
+	c->line_coding[4] = 0;
+	c->line_coding[5] = 0;
+	c->line_coding[6] = 8;
+	c->frame_len = 0;
+	c->started = 0;
+	c->error = BOOT_OK;
+	c->page[0].state = BOOT_PAGE_FREE;
+	c->page[1].state = BOOT_PAGE_FREE;
+	c->fill = BOOT_NONE;
+	c->flash_op = 0;
+
+	if (FLASH->CR & FLASH_CR_LOCK) {
+		FLASH->KEYR = 0x45670123U;
+		FLASH->KEYR = 0xCDEF89ABU;
+	}
+	FLASH->SR = BOOT_FLASH_ERRORS | FLASH_SR_EOP;
+
+	Boot_UsbInit();
+	Boot_UsbReset(c);
+	for (;;) {
+		/* IWDG laissé par l'application (option matérielle) : rechargé,
+		   sans effet s'il n'est pas démarré */
+		IWDG->KR = 0xAAAAU;
+		Boot_UsbPoll(c);
+		Boot_Receive(c);
+		Boot_Parse(c);
+		Boot_FlashPoll(c);
+	}
+}
+
+/* ---------------------------------------------------------------------------
+ * Application
+ * ------------------------------------------------------------------------- */
+
+void Boot_Request(void)
+{
+	BOOT_REQUEST = BOOT_REQUEST_MAGIC;
+	NVIC_SystemReset();
+}
@@ -0,0 +1,235 @@
+/**
+  ******************************************************************************
+  * @file    bulk.c
+  * @brief   Commandes de l'interface vendeur USB.
+  *
+  *          L'interruption USB ne fait que signaler le transfert reçu : la
+  *          commande est exécutée dans la boucle principale (Merge_Submit
+  *          n'est pas réentrant) et la réception n'est réarmée qu'ensuite.
+  ******************************************************************************
+  */
+#include "bulk.h"
+#include <string.h>
+#include "usb_device.h"
+#include "output.h"
+#include "dmx.h"
+#include "merge.h"
+#include "sync.h"
+#include "tempo.h"
+#include "sensor.h"
+#include "audio.h"
+#include "show.h"
+#include "record.h"
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+static int8_t Bulk_Init(void);
+static int8_t Bulk_DeInit(void);
+static int8_t Bulk_Receive(uint8_t *buf, uint32_t len);
+static int8_t Bulk_TransmitCplt(void);
+
+USBD_Vendor_ItfTypeDef Bulk_fops = {
+	Bulk_Init,
+	Bulk_DeInit,
+	Bulk_Receive,
+	Bulk_TransmitCplt
+};
+
+static uint8_t Bulk_Rx[BULK_RX_SIZE] __attribute__((aligned(4)));
+static volatile uint32_t Bulk_RxLen;
+static volatile uint8_t Bulk_RxReady;
+static volatile uint8_t Bulk_Configured;
+static Bulk_Telemetry_t Bulk_Telemetry;
+static Bulk_Clock_t Bulk_Clock;
+static Bulk_Watchdog_t Bulk_Watchdog;
+static Bulk_Latency_t Bulk_Latency;
+static Bulk_Show_t Bulk_Show;
+static uint8_t Bulk_ShowOpen;      /* Ecriture ouverte par le morceau 0 */
+
+/* Réception suivante (IRQ masquées : appelée aussi hors interruption) */
+static void Bulk_Arm(void)
+{
+	__disable_irq();
+	Bulk_RxReady = 0;
+	if (Bulk_Configured) {
+		USBD_Composite_VendorReceive(&hUsbDeviceFS, Bulk_Rx, sizeof(Bulk_Rx));
+	}
+	__enable_irq();
+}
+
+static int8_t Bulk_Init(void)
+{
+	Bulk_Configured = 1;
+	Bulk_Arm();
+	return USBD_OK;
+}
+
+static int8_t Bulk_DeInit(void)
+{
+	Bulk_Configured = 0;
+	Bulk_RxReady = 0;
+	return USBD_OK;
+}
+
+static int8_t Bulk_Receive(uint8_t *buf, uint32_t len)
+{
+	UNUSED(buf);
+	Bulk_RxLen = len;
+	Bulk_RxReady = 1;
+	return USBD_OK;
+}
+
+static int8_t Bulk_TransmitCplt(void)
+{
+	return USBD_OK;
+}
+
+static void Bulk_SendTelemetry(void)
+{
+	Bulk_Telemetry_t *t = &Bulk_Telemetry;
+
+	t->type = BULK_PKT_TELEMETRY;
+	t->source = Output_GetSource();
+	t->dmx = (Dmx_IsPresent(DMX_LINE_A) ? 0x01U : 0U) | (Dmx_IsPresent(DMX_LINE_B) ? 0x02U : 0U);
+	t->sync = Sync_GetState();
+	t->uptime_ms = HAL_GetTick();
+	t->bpm_x10 = Tempo_GetBPMx10();
+	t->merge_hash = Merge_GetHash();
+	memcpy(&t->host, Host_GetStats(), sizeof(t->host));
+	t->temperature = Sensor_GetTemperature();
+	t->vdda_mv = Sensor_GetVdda();
+	t->derate = Sensor_GetDerate();
+	t->audio_us = Audio_GetStats()->busy_us;
+	t->audio_lost = (uint16_t)Audio_GetStats()->overruns;
+	t->record = (Record_IsRecording() ? 0x01U : 0U) | (Record_IsPlaying() ? 0x02U : 0U)
+			| (Record_HasFailed() ? 0x04U : 0U);
+	/* Réponse précédente encore en cours : celle-ci est perdue */
+	USBD_Composite_VendorTransmit(&hUsbDeviceFS, (uint8_t *)t, sizeof(*t));
+}
+
+static void Bulk_SendClock(void)
+{
+	Bulk_Clock_t *c = &Bulk_Clock;
+
+	c->type = BULK_PKT_CLOCK;
+	c->profile = Clock_GetProfile();
+	memcpy(&c->clock, Clock_GetStats(), sizeof(c->clock));
+	USBD_Composite_VendorTransmit(&hUsbDeviceFS, (uint8_t *)c, sizeof(*c));
+}
+
+static void Bulk_SendWatchdog(void)
+{
+	Bulk_Watchdog_t *w = &Bulk_Watchdog;
+	const Watchdog_Report_t *last = Watchdog_GetLast();
+
+	w->type = BULK_PKT_WATCHDOG;
+	w->last_valid = (last != NULL);
+	memcpy(&w->now, Watchdog_GetReport(), sizeof(w->now));
+	if (last != NULL) {
+		memcpy(&w->last, last, sizeof(w->last));
+	} else {
+		memset(&w->last, 0, sizeof(w->last));
+	}
+	USBD_Composite_VendorTransmit(&hUsbDeviceFS, (uint8_t *)w, sizeof(*w));
+}
+
+static void Bulk_SendLatency(void)
+{
+	Bulk_Latency_t *l = &Bulk_Latency;
+
+	l->type = BULK_PKT_LATENCY;
+	l->mode = Latency_GetMode();
+	memcpy(&l->latency, Latency_GetStats(), sizeof(l->latency));
+	USBD_Composite_VendorTransmit(&hUsbDeviceFS, (uint8_t *)l, sizeof(*l));
+}
+
+/* Morceau de spectacle : même écriture en flux que le volume USB (vfat.c) */
+static void Bulk_ReceiveShow(const uint8_t *buf, uint32_t len)
+{
+	Bulk_Show_t *r = &Bulk_Show;
+	const Show_Header_t *h = (const Show_Header_t *)&buf[BULK_SHOW_HEADER];
+	uint32_t offset = buf[2] | ((uint32_t)buf[3] << 8);
+	uint32_t n = len - BULK_SHOW_HEADER;
+
+	r->type = BULK_PKT_SHOW;
+	r->status = BULK_SHOW_REJECTED;
+	r->next = offset;
+	if (Record_IsRecording() || Record_IsPlaying()) {
+		/* L'enregistreur lit ou écrit le même emplacement : envoi à reprendre */
+		Bulk_ShowOpen = 0;
+	} else if (len > BULK_SHOW_HEADER && (n % 8U) == 0U) {
+		if (offset == 0U && Show_IsValid(h)) {
+			Show_WriteBegin(h->length);
+			Bulk_ShowOpen = 1;
+		}
+		if (Bulk_ShowOpen) {
+			switch (Show_Write(offset, &buf[BULK_SHOW_HEADER], n)) {
+			case SHOW_WRITE_DONE:
+				r->status = BULK_SHOW_DONE;
+				r->next = offset + n;
+				Bulk_ShowOpen = 0;
+				break;
+			case SHOW_WRITE_ERROR:
+				/* Trou, flash occupée ou en défaut : envoi à reprendre depuis 0 */
+				Bulk_ShowOpen = 0;
+				break;
+			default:
+				r->status = BULK_SHOW_OK;
+				r->next = offset + n;
+				break;
+			}
+		}
+	}
+	USBD_Composite_VendorTransmit(&hUsbDeviceFS, (uint8_t *)r, sizeof(*r));
+}
+
+void Bulk_Process(void)
+{
+	uint32_t len = Bulk_RxLen;
+	uint16_t n;
+
+	if (!Bulk_RxReady) {
+		return;
+	}
+	if (len > 0U) {
+		switch (Bulk_Rx[0]) {
+		case BULK_PKT_UNIVERSE:
+			if (len < BULK_UNIVERSE_HEADER) {
+				break;
+			}
+			n = Bulk_Rx[2] | ((uint16_t)Bulk_Rx[3] << 8);
+			if (n > len - BULK_UNIVERSE_HEADER) {
+				n = (uint16_t)(len - BULK_UNIVERSE_HEADER);
+			}
+			Merge_Submit(MERGE_SRC_HOST, &Bulk_Rx[BULK_UNIVERSE_HEADER], n);
+			break;
+
+		case BULK_PKT_TELEMETRY:
+			Bulk_SendTelemetry();
+			break;
+
+		case BULK_PKT_CLOCK:
+			Bulk_SendClock();
+			break;
+
+		case BULK_PKT_WATCHDOG:
+			Bulk_SendWatchdog();
+			break;
+
+		case BULK_PKT_LATENCY:
+			if (len > 1U) {
+				Latency_SetMode(Bulk_Rx[1]);
+			}
+			Bulk_SendLatency();
+			break;
+
+		case BULK_PKT_SHOW:
+			Bulk_ReceiveShow(Bulk_Rx, len);
+			break;
+
+		default:
+			break;
+		}
+	}
+	Bulk_Arm();
+}
@@ -0,0 +1,243 @@
+/**
+  ******************************************************************************
+  * @file    buttons.c
+  * @brief   Moteur de boutons SW1..SW3.
+  *
+  *          Chaque front détecté par EXTI (re)lance une échéance
+  *          d'anti-rebond ; à son expiration le niveau de la broche est relu
+  *          et la transition validée. Toutes les échéances (anti-rebond,
+  *          appui long, répétition) partagent l'unique comparateur TIM2 CH1,
+  *          programmé sur la plus proche. Sans bouton actif, l'interruption
+  *          CC1 est coupée : aucun cycle CPU n'est consommé au repos.
+  ******************************************************************************
+  */
+#include "buttons.h"
+#include "tim.h"
+
+typedef struct {
+	GPIO_TypeDef *port;
+	uint16_t pin;
+} Button_Pin_t;
+
+typedef struct {
+	uint8_t stable;          /* Etat validé : 1 = enfoncé */
+	uint8_t debouncing;      /* Echéance d'anti-rebond en cours */
+	uint8_t holding;         /* Echéance d'appui long / répétition en cours */
+	uint8_t chorded;         /* Bouton engagé dans un accord */
+	uint8_t repeat;
+	uint32_t db_deadline;
+	uint32_t hold_deadline;
+	uint32_t edge_time;      /* Premier front de la transition en cours */
+} Button_t;
+
+static const Button_Pin_t Button_Pins[BUTTON_COUNT] = {
+	{ SW1_GPIO_Port, SW1_Pin },
+	{ SW2_GPIO_Port, SW2_Pin },
+	{ SW3_GPIO_Port, SW3_Pin },
+};
+
+static Button_t Buttons[BUTTON_COUNT];
+static uint32_t Buttons_LastPress;
+
+static Button_Event_t Buttons_Queue[BUTTON_QUEUE_SIZE];
+static volatile uint8_t Buttons_Head;
+static volatile uint8_t Buttons_Tail;
+
+static uint8_t Buttons_Read(uint8_t id)
+{
+	return HAL_GPIO_ReadPin(Button_Pins[id].port, Button_Pins[id].pin) == BUTTON_ACTIVE_STATE;
+}
+
+static uint8_t Buttons_Mask(void)
+{
+	uint8_t mask = 0;
+	uint8_t i;
+
+	for (i = 0; i < BUTTON_COUNT; i++) {
+		if (Buttons[i].stable) {
+			mask |= BUTTON_MASK(i);
+		}
+	}
+	return mask;
+}
+
+static void Buttons_Push(uint8_t type, uint8_t id, uint8_t repeat, uint32_t time)
+{
+	uint8_t next = (Buttons_Head + 1U) & (BUTTON_QUEUE_SIZE - 1U);
+
+	if (next == Buttons_Tail) {
+		/* File pleine : l'événement est perdu */
+		return;
+	}
+	Buttons_Queue[Buttons_Head].type = type;
+	Buttons_Queue[Buttons_Head].button = id;
+	Buttons_Queue[Buttons_Head].mask = Buttons_Mask();
+	Buttons_Queue[Buttons_Head].repeat = repeat;
+	Buttons_Queue[Buttons_Head].time = time;
+	Buttons_Head = next;
+}
+
+/* Programme TIM2 CH1 sur l'échéance la plus proche, ou le coupe */
+static void Buttons_Schedule(void)
+{
+	uint32_t now = TIMEBASE_NOW();
+	uint32_t target = 0;
+	int32_t best = INT32_MAX;
+	int32_t d;
+	uint8_t i;
+
+	for (i = 0; i < BUTTON_COUNT; i++) {
+		if (Buttons[i].debouncing) {
+			d = (int32_t)(Buttons[i].db_deadline - now);
+		} else if (Buttons[i].holding) {
+			d = (int32_t)(Buttons[i].hold_deadline - now);
+		} else {
+			continue;
+		}
+		if (d < best) {
+			best = d;
+		}
+	}
+
+	if (best == INT32_MAX) {
+		__HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC1);
+		return;
+	}
+
+	target = now + (uint32_t)((best > 0) ? best : 1);
+	__HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_CC1);
+	__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_1, target);
+	__HAL_TIM_ENABLE_IT(&htim2, TIM_IT_CC1);
+
+	/* Echéance déjà dépassée pendant la programmation : forcer l'événement */
+	if ((int32_t)(target - TIMEBASE_NOW()) <= 0) {
+		htim2.Instance->EGR = TIM_EGR_CC1G;
+	}
+}
+
+static void Buttons_Commit(uint8_t id, uint32_t now)
+{
+	Button_t *b = &Buttons[id];
+	uint8_t others;
+	uint8_t i;
+
+	if (!b->stable) {
+		others = Buttons_Mask();
+		b->stable = 1;
+		b->repeat = 0;
+
+		if (others != 0 && (now - Buttons_LastPress) <= BUTTON_CHORD_MS * TIMEBASE_TICKS_PER_MS) {
+			/* Accord : plus d'appui long ni de répétition sur ses membres */
+			for (i = 0; i < BUTTON_COUNT; i++) {
+				if (Buttons[i].stable) {
+					Buttons[i].chorded = 1;
+					Buttons[i].holding = 0;
+				}
+			}
+			Buttons_Push(BUTTON_EVT_CHORD, id, 0, b->edge_time);
+		} else {
+			b->chorded = 0;
+			b->holding = 1;
+			b->hold_deadline = now + BUTTON_LONG_MS * TIMEBASE_TICKS_PER_MS;
+			Buttons_Push(BUTTON_EVT_PRESS, id, 0, b->edge_time);
+		}
+		Buttons_LastPress = now;
+	} else {
+		b->stable = 0;
+		b->holding = 0;
+		b->chorded = 0;
+		Buttons_Push(BUTTON_EVT_RELEASE, id, b->repeat, b->edge_time);
+	}
+}
+
+void Buttons_Init(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < BUTTON_COUNT; i++) {
+		Buttons[i].stable = Buttons_Read(i);
+		Buttons[i].debouncing = 0;
+		Buttons[i].holding = 0;
+		Buttons[i].chorded = 0;
+		Buttons[i].repeat = 0;
+		__HAL_GPIO_EXTI_CLEAR_IT(Button_Pins[i].pin);
+	}
+	Buttons_Head = 0;
+	Buttons_Tail = 0;
+	__HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC1);
+}
+
+uint8_t Buttons_GetEvent(Button_Event_t *evt)
+{
+	uint8_t tail = Buttons_Tail;
+
+	if (tail == Buttons_Head) {
+		return 0;
+	}
+	*evt = Buttons_Queue[tail];
+	Buttons_Tail = (tail + 1U) & (BUTTON_QUEUE_SIZE - 1U);
+	return 1;
+}
+
+uint8_t Buttons_Pending(void)
+{
+	return Buttons_Tail != Buttons_Head;
+}
+
+uint8_t Buttons_GetState(void)
+{
+	return Buttons_Mask();
+}
+
+void Buttons_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	uint32_t now = TIMEBASE_NOW();
+	uint8_t i;
+
+	for (i = 0; i < BUTTON_COUNT; i++) {
+		if (Button_Pins[i].pin == GPIO_Pin) {
+			if (!Buttons[i].debouncing) {
+				/* Horodatage précis du geste, avant anti-rebond */
+				Buttons[i].edge_time = now;
+			}
+			/* Chaque rebond repousse l'échéance de validation */
+			Buttons[i].debouncing = 1;
+			Buttons[i].db_deadline = now + BUTTON_DEBOUNCE_MS * TIMEBASE_TICKS_PER_MS;
+			Buttons_Schedule();
+			return;
+		}
+	}
+}
+
+void Buttons_Timer_Callback(void)
+{
+	uint32_t now = TIMEBASE_NOW();
+	Button_t *b;
+	uint8_t i;
+
+	for (i = 0; i < BUTTON_COUNT; i++) {
+		b = &Buttons[i];
+
+		if (b->debouncing) {
+			if ((int32_t)(b->db_deadline - now) > 0) {
+				continue;
+			}
+			b->debouncing = 0;
+			if (Buttons_Read(i) != b->stable) {
+				Buttons_Commit(i, now);
+			}
+		} else if (b->holding && (int32_t)(b->hold_deadline - now) <= 0) {
+			Buttons_Push((b->repeat == 0) ? BUTTON_EVT_LONG : BUTTON_EVT_REPEAT, i, b->repeat, now);
+			if (b->repeat < 255U) {
+				b->repeat++;
+			}
+			/* Cadence conservée sans rattrapage en rafale */
+			b->hold_deadline += BUTTON_REPEAT_MS * TIMEBASE_TICKS_PER_MS;
+			if ((int32_t)(b->hold_deadline - now) <= 0) {
+				b->hold_deadline = now + BUTTON_REPEAT_MS * TIMEBASE_TICKS_PER_MS;
+			}
+		}
+	}
+
+	Buttons_Schedule();
+}
@@ -0,0 +1,195 @@
+/**
+  ******************************************************************************
+  * @file    clock.c
+  * @brief   Changement de profil d'horloge à chaud.
+  *
+  *          Le basculement de SYSCLK et le recalcul des timers se font
+  *          interruptions masquées, en quelques cycles : TIM2 ne perd que
+  *          les ticks de cette fenêtre. Plage de tension, états d'attente
+  *          et PLL sont changés hors de cette fenêtre, dans l'ordre imposé
+  *          (montée : tension, attente, PLL, puis SYSCLK ; descente :
+  *          l'inverse).
+  ******************************************************************************
+  */
+#include "clock.h"
+#include "tim.h"
+#include "usb_device.h"
+#include "settings.h"
+#include "output.h"
+#include "tempo.h"
+#include "menu.h"
+#include "strip.h"
+#include "sync.h"
+#include "record.h"
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+extern void SystemClock_Config(void);
+
+static const uint32_t Clock_Hz[CLOCK_PROFILE_COUNT] = { CLOCK_FULL_HZ, CLOCK_ECO_HZ };
+static const uint16_t Clock_Ua[CLOCK_PROFILE_COUNT] = { CLOCK_FULL_UA, CLOCK_ECO_UA };
+
+/* Réglages à pleine vitesse, relevés par Clock_Init */
+static uint32_t Clock_Tim1Period;
+static uint32_t Clock_Tim2Psc;
+static uint32_t Clock_Tim6Psc;
+static uint32_t Clock_Tim15Psc;
+
+static uint8_t Clock_Profile;
+static uint32_t Clock_Since;        /* HAL_GetTick() du dernier changement */
+static uint32_t Clock_BusyTick;     /* Dernière demande de pleine vitesse */
+static Clock_Stats_t Clock_Stats;
+
+/* Diviseurs et périodes pour le profil (IRQ masquées, SYSCLK déjà changé) */
+static void Clock_ScaleTimers(uint8_t profile)
+{
+	uint32_t div = CLOCK_FULL_HZ / Clock_Hz[profile];
+	uint32_t cnt, urs;
+
+	/* TIM2 : le nouveau diviseur est chargé par UG, compteur reporté */
+	cnt = TIM2->CNT;
+	htim2.Init.Prescaler = (Clock_Tim2Psc + 1U) / div - 1U;
+	TIM2->PSC = htim2.Init.Prescaler;
+	urs = TIM2->CR1 & TIM_CR1_URS;
+	TIM2->CR1 |= TIM_CR1_URS;
+	TIM2->EGR = TIM_EGR_UG;
+	TIM2->CNT += cnt;
+	TIM2->CR1 = (TIM2->CR1 & ~TIM_CR1_URS) | urs;
+
+	/* TIM6 : cadence d'échantillonnage audio, chargé au prochain débordement */
+	htim6.Init.Prescaler = (Clock_Tim6Psc + 1U) / div - 1U;
+	TIM6->PSC = htim6.Init.Prescaler;
+
+	/* TIM15 : chargé au prochain débordement, la synchronisation est arrêtée */
+	htim15.Init.Prescaler = (Clock_Tim15Psc + 1U) / div - 1U;
+	TIM15->PSC = htim15.Init.Prescaler;
+
+	/* TIM1 : même fréquence PWM, période réduite d'autant ; une période
+	   calée sur le SOF ou le ruban ne sont pas touchés */
+	if (__HAL_TIM_GET_AUTORELOAD(&htim1) == htim1.Init.Period) {
+		htim1.Init.Period = (Clock_Tim1Period + 1U) / div - 1U;
+		__HAL_TIM_SET_AUTORELOAD(&htim1, htim1.Init.Period);
+		Output_Refresh();
+		htim1.Instance->CR1 |= TIM_CR1_URS;
+		__HAL_TIM_SET_COUNTER(&htim1, 0);
+		htim1.Instance->EGR = TIM_EGR_UG;
+		htim1.Instance->CR1 &= ~TIM_CR1_URS;
+	} else {
+		htim1.Init.Period = (Clock_Tim1Period + 1U) / div - 1U;
+	}
+	Tempo_Recompute();
+}
+
+static void Clock_Switch(uint32_t source, uint32_t status, uint8_t profile)
+{
+	__disable_irq();
+	__HAL_RCC_SYSCLK_CONFIG(source);
+	while (__HAL_RCC_GET_SYSCLK_SOURCE() != status) {
+	}
+	Clock_ScaleTimers(profile);
+	__enable_irq();
+	SystemCoreClock = Clock_Hz[profile];
+	HAL_InitTick(uwTickPrio);
+}
+
+static void Clock_Account(void)
+{
+	uint32_t now = HAL_GetTick();
+
+	Clock_Stats.time_ms[Clock_Profile] += now - Clock_Since;
+	Clock_Since = now;
+}
+
+void Clock_Init(void)
+{
+	Clock_Tim1Period = htim1.Init.Period;
+	Clock_Tim2Psc = htim2.Init.Prescaler;
+	Clock_Tim6Psc = htim6.Init.Prescaler;
+	Clock_Tim15Psc = htim15.Init.Prescaler;
+	Clock_Profile = CLOCK_PROFILE_FULL;
+	Clock_Since = HAL_GetTick();
+	Clock_BusyTick = Clock_Since;
+}
+
+void Clock_SetProfile(uint8_t profile)
+{
+	uint32_t start, us;
+
+	if (profile >= CLOCK_PROFILE_COUNT || profile == Clock_Profile) {
+		return;
+	}
+	start = TIMEBASE_NOW();
+	if (profile == CLOCK_PROFILE_ECO) {
+		Clock_Switch(RCC_SYSCLKSOURCE_HSI, RCC_SYSCLKSOURCE_STATUS_HSI, profile);
+		/* Plage 2 : 12 MHz au plus avec 1 état d'attente, 2 pour 16 MHz */
+		__HAL_FLASH_SET_LATENCY(FLASH_LATENCY_2);
+		while (__HAL_FLASH_GET_LATENCY() != FLASH_LATENCY_2) {
+		}
+		__HAL_RCC_PLL_DISABLE();
+		if (HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE2) != HAL_OK) {
+			Error_Handler();
+		}
+	} else {
+		if (HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1) != HAL_OK) {
+			Error_Handler();
+		}
+		__HAL_FLASH_SET_LATENCY(FLASH_LATENCY_3);
+		while (__HAL_FLASH_GET_LATENCY() != FLASH_LATENCY_3) {
+		}
+		__HAL_RCC_PLL_ENABLE();
+		while (__HAL_RCC_GET_FLAG(RCC_FLAG_PLLRDY) == RESET) {
+		}
+		Clock_Switch(RCC_SYSCLKSOURCE_PLLCLK, RCC_SYSCLKSOURCE_STATUS_PLLCLK, profile);
+	}
+
+	Clock_Account();
+	Clock_Profile = profile;
+	Clock_Stats.switches++;
+	us = (TIMEBASE_NOW() - start) / TIMEBASE_TICKS_PER_US;
+	Clock_Stats.latency_us[profile] = (us > 0xFFFFU) ? 0xFFFFU : (uint16_t)us;
+	if (Clock_Stats.latency_us[profile] > Clock_Stats.latency_max_us[profile]) {
+		Clock_Stats.latency_max_us[profile] = Clock_Stats.latency_us[profile];
+	}
+}
+
+uint8_t Clock_GetProfile(void)
+{
+	return Clock_Profile;
+}
+
+void Clock_Process(void)
+{
+	uint32_t now = HAL_GetTick();
+
+	if (hUsbDeviceFS.dev_state != USBD_STATE_SUSPENDED || Menu_IsActive() || Strip_IsActive()
+			|| Record_IsRecording()
+			|| (Settings.rx2_mode == RX2_SYNC && Settings.sync_mode != SYNC_OFF)) {
+		Clock_BusyTick = now;
+		Clock_SetProfile(CLOCK_PROFILE_FULL);
+	} else if (now - Clock_BusyTick >= CLOCK_ECO_DELAY_MS) {
+		Clock_SetProfile(CLOCK_PROFILE_ECO);
+	}
+}
+
+void Clock_Restore(void)
+{
+	if (Clock_Profile == CLOCK_PROFILE_FULL) {
+		SystemClock_Config();
+		return;
+	}
+	/* Déjà sur HSI16 en plage 2 : seul HSI48 (USB) est à relancer */
+	__HAL_RCC_HSI48_ENABLE();
+	while (__HAL_RCC_GET_FLAG(RCC_FLAG_HSI48RDY) == RESET) {
+	}
+}
+
+const Clock_Stats_t *Clock_GetStats(void)
+{
+	uint8_t i;
+
+	Clock_Account();
+	for (i = 0; i < CLOCK_PROFILE_COUNT; i++) {
+		Clock_Stats.energy_mj[i] = (uint32_t)(((uint64_t)Clock_Stats.time_ms[i] * Clock_Ua[i]
+				* CLOCK_SUPPLY_MV) / 1000000000ULL);
+	}
+	return &Clock_Stats;
+}
@@ -0,0 +1,212 @@
+/**
+  ******************************************************************************
+  * @file    config.c
+  * @brief   Journal de clés et valeurs sur deux pages de flash.
+  *
+  *          L'index en RAM donne, pour chaque clé, la position de sa
+  *          dernière valeur dans la page active (0 : absente, l'en-tête
+  *          occupant le premier double-mot). Un enregistrement dont la
+  *          longueur est incohérente termine le parcours : la page est
+  *          alors vue pleine et la prochaine écriture la recopie.
+  ******************************************************************************
+  */
+#include "config.h"
+#include <string.h>
+#include "flash.h"
+#include "dmx.h"
+
+/* Taille d'un enregistrement : en-tête de 4 octets et valeur, par double-mots */
+#define CONFIG_SIZE(len)        ((4U + (len) + FLASH_DWORD_SIZE - 1U) & ~(FLASH_DWORD_SIZE - 1U))
+
+/**
+ * @brief  En-tête de page, un double-mot
+ */
+typedef struct {
+	uint32_t magic;         /*!< CONFIG_MAGIC */
+	uint32_t seq;           /*!< Génération, la plus haute est active */
+} Config_Page_t;
+
+/**
+ * @brief  Début d'un enregistrement
+ */
+typedef struct {
+	uint8_t key;
+	uint8_t len;
+	uint16_t sum;
+	uint8_t data[];
+} Config_Record_t;
+
+static uint16_t Config_Index[CONFIG_KEY_COUNT];
+static uint32_t Config_Page;            /* Adresse de la page active */
+static uint32_t Config_Seq;
+static uint32_t Config_Free;            /* Premier octet libre de la page active */
+static uint8_t Config_Buffer[CONFIG_SIZE(CONFIG_VALUE_MAX)] __attribute__((aligned(8)));
+
+/* Empreinte FNV-1a par octets (constantes de dmx.h), repliée sur 16 bits */
+static uint16_t Config_Sum(uint8_t key, uint8_t len, const uint8_t *data)
+{
+	uint32_t hash = DMX_HASH_SEED;
+	uint8_t i;
+
+	hash = (hash ^ key) * DMX_HASH_PRIME;
+	hash = (hash ^ len) * DMX_HASH_PRIME;
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * DMX_HASH_PRIME;
+	}
+	return (uint16_t)(hash ^ (hash >> 16));
+}
+
+static const Config_Record_t *Config_At(uint32_t offset)
+{
+	return (const Config_Record_t *)(Config_Page + offset);
+}
+
+/* Parcours unique de la page active */
+static void Config_Scan(void)
+{
+	const Config_Record_t *r;
+	const uint32_t *w;
+	uint32_t off = sizeof(Config_Page_t);
+
+	memset(Config_Index, 0, sizeof(Config_Index));
+	while (off + FLASH_DWORD_SIZE <= FLASH_PAGE_SIZE) {
+		w = (const uint32_t *)(Config_Page + off);
+		if (w[0] == 0xFFFFFFFFU && w[1] == 0xFFFFFFFFU) {
+			break;
+		}
+		r = Config_At(off);
+		if (r->len > CONFIG_VALUE_MAX || off + CONFIG_SIZE(r->len) > FLASH_PAGE_SIZE) {
+			/* Longueur illisible : la suite n'est plus alignée */
+			off = FLASH_PAGE_SIZE;
+			break;
+		}
+		if (r->key < CONFIG_KEY_COUNT && r->sum == Config_Sum(r->key, r->len, r->data)) {
+			Config_Index[r->key] = (uint16_t)off;
+		}
+		off += CONFIG_SIZE(r->len);
+	}
+	Config_Free = off;
+}
+
+/* Recopie la dernière valeur de chaque clé dans l'autre page */
+static HAL_StatusTypeDef Config_Swap(void)
+{
+	uint32_t page = (Config_Page == CONFIG_BASE) ? CONFIG_BASE + FLASH_PAGE_SIZE : CONFIG_BASE;
+	uint16_t index[CONFIG_KEY_COUNT];
+	uint32_t off = sizeof(Config_Page_t);
+	uint32_t size;
+	Config_Page_t h;
+	const Config_Record_t *r;
+	HAL_StatusTypeDef ret;
+	uint8_t k;
+
+	ret = Flash_ErasePage(page);
+	for (k = 0; k < CONFIG_KEY_COUNT && ret == HAL_OK; k++) {
+		index[k] = 0;
+		if (Config_Index[k] == 0U) {
+			continue;
+		}
+		r = Config_At(Config_Index[k]);
+		size = CONFIG_SIZE(r->len);
+		ret = Flash_Program(page + off, r, size);
+		index[k] = (uint16_t)off;
+		off += size;
+	}
+	if (ret != HAL_OK) {
+		/* L'ancienne page reste active */
+		return ret;
+	}
+
+	/* En-tête en dernier : la nouvelle page ne devient valide qu'ici */
+	h.magic = CONFIG_MAGIC;
+	h.seq = Config_Seq + 1U;
+	ret = Flash_Program(page, &h, sizeof(h));
+	if (ret != HAL_OK) {
+		return ret;
+	}
+	memcpy(Config_Index, index, sizeof(Config_Index));
+	Config_Page = page;
+	Config_Seq = h.seq;
+	Config_Free = off;
+	return HAL_OK;
+}
+
+void Config_Init(void)
+{
+	const Config_Page_t *a = (const Config_Page_t *)CONFIG_BASE;
+	const Config_Page_t *b = (const Config_Page_t *)(CONFIG_BASE + FLASH_PAGE_SIZE);
+	Config_Page_t h;
+
+	if (a->magic == CONFIG_MAGIC && (b->magic != CONFIG_MAGIC || (int32_t)(a->seq - b->seq) > 0)) {
+		Config_Page = CONFIG_BASE;
+		Config_Seq = a->seq;
+	} else if (b->magic == CONFIG_MAGIC) {
+		Config_Page = CONFIG_BASE + FLASH_PAGE_SIZE;
+		Config_Seq = b->seq;
+	} else {
+		/* Aucune page valide : première génération dans la page A */
+		Config_Page = CONFIG_BASE;
+		Config_Seq = 1;
+		h.magic = CONFIG_MAGIC;
+		h.seq = Config_Seq;
+		Flash_ErasePage(Config_Page);
+		Flash_Program(Config_Page, &h, sizeof(h));
+	}
+	Config_Scan();
+}
+
+const uint8_t *Config_Get(uint8_t key, uint8_t *len)
+{
+	const Config_Record_t *r;
+
+	if (key >= CONFIG_KEY_COUNT || Config_Index[key] == 0U) {
+		return NULL;
+	}
+	r = Config_At(Config_Index[key]);
+	*len = r->len;
+	return r->data;
+}
+
+HAL_StatusTypeDef Config_Set(uint8_t key, const void *data, uint8_t len)
+{
+	Config_Record_t *r = (Config_Record_t *)Config_Buffer;
+	const uint8_t *old;
+	uint32_t size = CONFIG_SIZE(len);
+	uint32_t off;
+	HAL_StatusTypeDef ret;
+	uint8_t old_len;
+
+	if (key >= CONFIG_KEY_COUNT || len > CONFIG_VALUE_MAX) {
+		return HAL_ERROR;
+	}
+	old = Config_Get(key, &old_len);
+	if (old != NULL && old_len == len && memcmp(old, data, len) == 0) {
+		/* Valeur inchangée : pas d'usure */
+		return HAL_OK;
+	}
+
+	if (Config_Free + size > FLASH_PAGE_SIZE) {
+		ret = Config_Swap();
+		if (ret != HAL_OK) {
+			return ret;
+		}
+		if (Config_Free + size > FLASH_PAGE_SIZE) {
+			return HAL_ERROR;
+		}
+	}
+
+	memset(Config_Buffer, 0xFF, size);
+	r->key = key;
+	r->len = len;
+	r->sum = Config_Sum(key, len, data);
+	memcpy(r->data, data, len);
+
+	off = Config_Free;
+	/* Place consommée même en cas d'échec : le double-mot est peut-être programmé */
+	Config_Free += size;
+	ret = Flash_Program(Config_Page + off, Config_Buffer, size);
+	if (ret == HAL_OK && Config_At(off)->sum == r->sum) {
+		Config_Index[key] = (uint16_t)off;
+	}
+	return ret;
+}
@@ -0,0 +1,259 @@
+/**
+  ******************************************************************************
+  * @file    cue.c
+  * @brief   Conduite : cues déclenchés par TIM2 CH2.
+  *
+  *          L'échéance du prochain cue est tenue en ticks TIM2 (Cue_Target)
+  *          et en us depuis le début (Cue_BaseUs + Cue_Wait). Au-delà de
+  *          CUE_MAX_WAIT_US, l'attente est découpée : la comparaison 32
+  *          bits reste sans ambiguïté et la date des cues n'est limitée que
+  *          par leur champ 32 bits (71 minutes).
+  *
+  *          Les cues de même date sont exécutés dans la même interruption.
+  *          Un fondu démarre à l'échéance de son cue et se termine à celle
+  *          du suivant ; ses étapes sont calculées à chaque période PWM
+  *          (Cue_Update, depuis la mise à jour de TIM1), les niveaux étant
+  *          interpolés en linéaire 16 bits.
+  ******************************************************************************
+  */
+#include "cue.h"
+#include "tim.h"
+#include "show.h"
+#include "settings.h"
+#include "output.h"
+#include "tempo.h"
+
+/* Fondu le plus long : l'écart en ticks TIM2 doit tenir sur 32 bits */
+#define CUE_MAX_FADE_US         (2U * CUE_MAX_WAIT_US)
+
+typedef struct {
+	Show_Header_t show;
+	uint32_t tag;           /*!< CUE_TAG */
+	uint32_t count;         /*!< Nombre de cues */
+} Cue_Header_t;
+
+static const Cue_t *Cue_List;
+static uint32_t Cue_Count;
+static volatile uint32_t Cue_Index;     /* Prochain cue */
+static uint32_t Cue_BaseUs;             /* Date (us) de la dernière échéance */
+static uint32_t Cue_BaseTick;           /* Et son instant TIM2 */
+static uint32_t Cue_Wait;               /* Attente programmée (us) */
+static uint32_t Cue_Target;
+static volatile uint8_t Cue_Running;
+
+static volatile uint8_t Cue_Effect;     /* Sorties rendues aux effets */
+static uint8_t Cue_SavedEffect;
+
+static uint16_t Cue_Level[3];           /* R, G, B linéaires 16 bits */
+static uint16_t Cue_From[3];
+static uint16_t Cue_To[3];
+static uint32_t Cue_FadeStart;
+static uint32_t Cue_FadeTicks;
+static volatile uint8_t Cue_Fading;
+
+/* Liste valide en flash : triée, boucles après le début */
+static const Cue_Header_t *Cue_Get(void)
+{
+	const Cue_Header_t *h = (const Cue_Header_t *)Show_Get();
+	const Cue_t *c;
+	uint32_t i;
+
+	if (h == NULL || h->show.length < sizeof(Cue_Header_t) || h->tag != CUE_TAG
+			|| h->count > (h->show.length - sizeof(Cue_Header_t)) / sizeof(Cue_t)) {
+		return NULL;
+	}
+	c = (const Cue_t *)(h + 1);
+	for (i = 0; i < h->count; i++) {
+		if (c[i].type >= CUE_TYPE_COUNT || (i > 0U && c[i].time < c[i - 1U].time)
+				|| (c[i].type == CUE_LOOP && c[i].time == 0U)) {
+			return NULL;
+		}
+	}
+	return h;
+}
+
+/* Programme TIM2 CH2 sur l'échéance du prochain cue, ou le coupe */
+static void Cue_Schedule(void)
+{
+	if (Cue_Index >= Cue_Count) {
+		/* Fin de liste : le dernier état est maintenu */
+		__HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC2);
+		return;
+	}
+	Cue_Wait = Cue_List[Cue_Index].time - Cue_BaseUs;
+	if (Cue_Wait > CUE_MAX_WAIT_US) {
+		Cue_Wait = CUE_MAX_WAIT_US;
+	}
+	Cue_Target = Cue_BaseTick + Cue_Wait * TIMEBASE_TICKS_PER_US;
+	__HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_CC2);
+	__HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_2, Cue_Target);
+	__HAL_TIM_ENABLE_IT(&htim2, TIM_IT_CC2);
+
+	/* Echéance déjà dépassée : forcer l'événement */
+	if ((int32_t)(Cue_Target - TIMEBASE_NOW()) <= 0) {
+		htim2.Instance->EGR = TIM_EGR_CC2G;
+	}
+}
+
+static void Cue_SetLevel(const uint8_t *rgb)
+{
+	uint8_t i;
+
+	for (i = 0; i < 3U; i++) {
+		Cue_Level[i] = Output_Gamma8(rgb[i]);
+	}
+	Output_Write(OUTPUT_SRC_CUE, Cue_Level[0], Cue_Level[1], Cue_Level[2]);
+}
+
+static void Cue_Execute(const Cue_t *c)
+{
+	uint32_t d;
+	uint16_t bpm;
+	uint8_t i;
+
+	switch (c->type) {
+	case CUE_SCENE:
+		Cue_Fading = 0;
+		Cue_Effect = 0;
+		Cue_SetLevel(c->arg);
+		break;
+
+	case CUE_FADE:
+		Cue_Effect = 0;
+		d = (Cue_Index + 1U < Cue_Count) ? Cue_List[Cue_Index + 1U].time - c->time : 0U;
+		if (d == 0U) {
+			Cue_Fading = 0;
+			Cue_SetLevel(c->arg);
+			break;
+		}
+		for (i = 0; i < 3U; i++) {
+			Cue_From[i] = Cue_Level[i];
+			Cue_To[i] = Output_Gamma8(c->arg[i]);
+		}
+		Cue_FadeStart = Cue_BaseTick;
+		Cue_FadeTicks = ((d > CUE_MAX_FADE_US) ? CUE_MAX_FADE_US : d) * TIMEBASE_TICKS_PER_US;
+		Cue_Fading = 1;
+		break;
+
+	case CUE_EFFECT:
+		Cue_Fading = 0;
+		Cue_Effect = 1;
+		Settings.effect = (c->arg[0] < EFFECT_COUNT) ? c->arg[0] : EFFECT_NONE;
+		bpm = (uint16_t)(c->arg[1] | (c->arg[2] << 8));
+		if (bpm != 0U) {
+			Tempo_SetPeriod((uint32_t)(((uint64_t)TEMPO_TICKS_PER_MIN * 10U) / bpm));
+		}
+		/* Premier temps de l'effet à l'échéance exacte du cue */
+		Tempo_Align(Cue_BaseTick);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void Cue_Init(void)
+{
+	__HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC2);
+	Cue_Running = 0;
+	Cue_Fading = 0;
+	Cue_Effect = 0;
+}
+
+uint8_t Cue_Play(void)
+{
+	const Cue_Header_t *h;
+
+	if (Cue_Running) {
+		/* Spectacle remplacé entre-temps (stockage de masse, enregistrement) */
+		h = (const Cue_Header_t *)Show_Get();
+		if (h != NULL && h->tag == CUE_TAG) {
+			return 1;
+		}
+		Cue_Stop();
+		return 0;
+	}
+
+	h = Cue_Get();
+	if (h == NULL) {
+		return 0;
+	}
+	Cue_List = (const Cue_t *)(h + 1);
+	Cue_Count = h->count;
+	Cue_Index = 0;
+	Cue_BaseUs = 0;
+	Cue_BaseTick = TIMEBASE_NOW();
+	Cue_Level[0] = Cue_Level[1] = Cue_Level[2] = 0;
+	Cue_Fading = 0;
+	Cue_Effect = 0;
+	Cue_SavedEffect = Settings.effect;
+	Cue_Running = 1;
+	Cue_Schedule();
+	return 1;
+}
+
+void Cue_Stop(void)
+{
+	if (!Cue_Running) {
+		return;
+	}
+	__HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC2);
+	Cue_Running = 0;
+	Cue_Fading = 0;
+	Cue_Effect = 0;
+	Settings.effect = Cue_SavedEffect;
+}
+
+uint8_t Cue_GetSource(void)
+{
+	return Cue_Effect ? OUTPUT_SRC_EFFECT : OUTPUT_SRC_CUE;
+}
+
+void Cue_Timer_Callback(void)
+{
+	const Cue_t *c;
+
+	if (!Cue_Running) {
+		return;
+	}
+	/* Datation sur l'échéance, pas sur l'instant de traitement */
+	Cue_BaseTick = Cue_Target;
+	Cue_BaseUs += Cue_Wait;
+	while (Cue_Index < Cue_Count && Cue_List[Cue_Index].time <= Cue_BaseUs) {
+		c = &Cue_List[Cue_Index];
+		if (c->type == CUE_LOOP) {
+			Cue_Index = 0;
+			Cue_BaseUs = 0;
+			continue;
+		}
+		Cue_Execute(c);
+		Cue_Index++;
+	}
+	Cue_Schedule();
+}
+
+void Cue_Update(void)
+{
+	uint32_t e, k;
+	uint8_t i;
+
+	if (!Cue_Running || Output_GetSource() != OUTPUT_SRC_CUE) {
+		return;
+	}
+	if (Cue_Fading) {
+		e = TIMEBASE_NOW() - Cue_FadeStart;
+		if (e >= Cue_FadeTicks) {
+			for (i = 0; i < 3U; i++) {
+				Cue_Level[i] = Cue_To[i];
+			}
+			Cue_Fading = 0;
+		} else {
+			k = (uint32_t)(((uint64_t)e << 16) / Cue_FadeTicks);
+			for (i = 0; i < 3U; i++) {
+				Cue_Level[i] = (uint16_t)(Cue_From[i]
+						+ (((int64_t)Cue_To[i] - Cue_From[i]) * (int64_t)k >> 16));
+			}
+		}
+	}
+	Output_Write(OUTPUT_SRC_CUE, Cue_Level[0], Cue_Level[1], Cue_Level[2]);
+}
@@ -0,0 +1,470 @@
+/**
+  ******************************************************************************
+  * @file    dmx.c
+  * @brief   Réception DMX512 par DMA sur deux lignes.
+  *
+  *          Le DMA remplit un tampon pendant toute la trame ; le BREAK
+  *          suivant produit une erreur de trame (FE) qui interrompt le DMA.
+  *          Le nombre d'octets reçus se lit alors dans le compteur DMA et
+  *          la réception repart aussitôt sur le second tampon : le CPU
+  *          n'intervient qu'une fois par trame.
+  *
+  *          Les tampons sont décalés de 3 octets pour que le canal 1 soit
+  *          aligné sur 32 bits.
+  *
+  *          Pendant la réception, la trame est comparée mot à mot au tampon
+  *          précédent (l'autre moitié du double tampon) : la première moitié
+  *          sur l'interruption de demi-transfert DMA, le reste au BREAK. La
+  *          trame est publiée avec sa carte de canaux modifiés et son
+  *          empreinte, ce qui permet aux traitements en aval de s'abstenir
+  *          quand rien n'a changé. La fin d'un univers court est remise à
+  *          zéro pour que les deux tampons restent comparables.
+  *
+  *          Avec ISR_FAST_PATH, les interruptions USART et DMA sont
+  *          décodées ici directement sur les registres et la réception est
+  *          relancée sans repasser par HAL_UART_Receive_DMA : seul le
+  *          premier démarrage d'une ligne passe par la HAL, qui configure
+  *          le canal DMA et les interruptions.
+  *
+  *          Repère de latence (ISR_FAST_PATH) : la réception est coupée en
+  *          deux transferts DMA, le premier s'arrêtant sur le canal repère.
+  *          Sa fin de transfert date le canal sur TIM2 et enchaîne aussitôt
+  *          le reste de la trame ; l'octet suivant attend dans RDR, il y a
+  *          donc près de deux temps de canal (88 us) pour relancer le DMA.
+  *          La comparaison de demi-transfert n'a lieu que sur le second
+  *          transfert, qui contient toujours la première moitié.
+  ******************************************************************************
+  */
+#include "dmx.h"
+#include <string.h>
+#include "usart.h"
+#include "sync.h"
+#include "tim.h"
+#include "latency.h"
+
+/* Code de départ + 512 canaux + octet du BREAK + 1 de marge */
+#define DMX_RX_LEN              (1U + DMX_UNIVERSE_SIZE + 2U)
+#define DMX_RX_OFFSET           3U
+#define DMX_BUF_SIZE            (DMX_RX_OFFSET + DMX_RX_LEN + 2U)
+#define DMX_WORDS               (DMX_UNIVERSE_SIZE / 4U)
+
+/* Mots complets à l'interruption de demi-transfert (code de départ exclu) */
+#define DMX_HALF_WORDS          (((DMX_RX_LEN / 2U) - 1U) / 4U)
+
+typedef struct {
+	UART_HandleTypeDef *huart;
+	uint8_t buf[2][DMX_BUF_SIZE] __attribute__((aligned(4)));
+	uint8_t rx;                 /* Tampon en cours de remplissage */
+	volatile uint8_t ready;     /* Dernier tampon complet */
+	volatile uint16_t length;   /* Canaux de la dernière trame */
+	volatile uint32_t seq;      /* Trames complètes reçues */
+	volatile uint32_t tick;
+	uint32_t changed[2][DMX_CHANGED_WORDS];
+	uint32_t hash[2];
+	uint16_t scanned;           /* Mots déjà comparés dans le tampon rx */
+	uint16_t marker;            /* Octets jusqu'au canal repère inclus, 0 sans repère */
+	uint16_t span;              /* Octets reçus à la fin du transfert DMA en cours */
+	uint32_t stamp[2];          /* TIMEBASE_NOW() au canal repère, par tampon */
+	uint8_t stamped[2];
+	uint32_t read_stamp;        /* Repère de la dernière trame recopiée */
+	uint8_t read_stamped;
+	uint8_t running;            /* Canal DMA configuré par la HAL */
+	uint32_t read_seq;
+	uint8_t enabled;
+} Dmx_Line_t;
+
+UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_rx;
+
+static Dmx_Line_t Dmx_Lines[DMX_LINE_COUNT];
+
+static Dmx_Line_t *Dmx_Find(UART_HandleTypeDef *huart)
+{
+	uint8_t i;
+
+	for (i = 0; i < DMX_LINE_COUNT; i++) {
+		if (Dmx_Lines[i].enabled && Dmx_Lines[i].huart == huart) {
+			return &Dmx_Lines[i];
+		}
+	}
+	return NULL;
+}
+
+static uint32_t *Dmx_Slots(Dmx_Line_t *l, uint8_t idx)
+{
+	return (uint32_t *)&l->buf[idx][DMX_RX_OFFSET + 1U];
+}
+
+/* Compare la trame en cours à la précédente jusqu'au mot last */
+static void Dmx_Scan(Dmx_Line_t *l, uint16_t last)
+{
+	if (last > l->scanned) {
+		l->hash[l->rx] = Dmx_Compare(Dmx_Slots(l, l->rx), Dmx_Slots(l, l->ready),
+				l->changed[l->rx], l->scanned, last, l->hash[l->rx]);
+		l->scanned = last;
+	}
+}
+
+static void Dmx_Start(Dmx_Line_t *l)
+{
+#if ISR_FAST_PATH
+	DMA_HandleTypeDef *hdma = l->huart->hdmarx;
+#endif
+
+	memset(l->changed[l->rx], 0, sizeof(l->changed[0]));
+	l->hash[l->rx] = DMX_HASH_SEED;
+	l->scanned = 0;
+	l->stamped[l->rx] = 0;
+	l->span = DMX_RX_LEN;
+#if ISR_FAST_PATH
+	if (l->running) {
+		/* Relance directe : même canal, même périphérique, autre tampon */
+		if (l->marker != 0U) {
+			l->span = l->marker;
+		}
+		hdma->Instance->CCR &= ~DMA_CCR_EN;
+		hdma->DmaBaseAddress->IFCR = DMA_IFCR_CGIF1 << (hdma->ChannelIndex & 0x1CU);
+		hdma->Instance->CNDTR = l->span;
+		hdma->Instance->CMAR = (uint32_t)&l->buf[l->rx][DMX_RX_OFFSET];
+		l->huart->Instance->RQR = USART_RQR_RXFRQ;
+		l->huart->Instance->ICR = USART_ICR_FECF | USART_ICR_NECF | USART_ICR_ORECF;
+		hdma->Instance->CCR |= DMA_CCR_EN;
+		return;
+	}
+	l->running = 1;
+#endif
+	__HAL_UART_SEND_REQ(l->huart, UART_RXDATA_FLUSH_REQUEST);
+	HAL_UART_Receive_DMA(l->huart, &l->buf[l->rx][DMX_RX_OFFSET], DMX_RX_LEN);
+}
+
+static void Dmx_LineInit(uint8_t line, UART_HandleTypeDef *huart)
+{
+	Dmx_Line_t *l = &Dmx_Lines[line];
+
+	l->huart = huart;
+	l->rx = 0;
+	l->ready = 1;
+	l->length = 0;
+	l->seq = 0;
+	l->read_seq = 0;
+	l->running = 0;
+	l->enabled = 1;
+	Dmx_Start(l);
+}
+
+/* Configuration bas niveau de USART2, hors CubeMX car PA3 est partagé */
+static void Dmx_USART2_Init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
+	UART_WakeUpTypeDef wake = {0};
+
+	PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_USART2;
+	/* HSI16 : horloge indépendante de la PLL, conservée en Stop (réveil) */
+	PeriphClkInit.Usart2ClockSelection = RCC_USART2CLKSOURCE_HSI;
+	if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK) {
+		Error_Handler();
+	}
+	__HAL_RCC_USART2_CLK_ENABLE();
+
+	/* PA3 ------> USART2_RX */
+	GPIO_InitStruct.Pin = RX2_Pin;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF7_USART2;
+	HAL_GPIO_Init(RX2_GPIO_Port, &GPIO_InitStruct);
+
+	hdma_usart2_rx.Instance = DMA1_Channel6;
+	hdma_usart2_rx.Init.Request = DMA_REQUEST_2;
+	hdma_usart2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_usart2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_usart2_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_usart2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_usart2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_usart2_rx.Init.Mode = DMA_NORMAL;
+	hdma_usart2_rx.Init.Priority = DMA_PRIORITY_HIGH;
+	if (HAL_DMA_Init(&hdma_usart2_rx) != HAL_OK) {
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&huart2, hdmarx, hdma_usart2_rx);
+
+	HAL_NVIC_SetPriority(DMA1_Channel6_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+	HAL_NVIC_SetPriority(USART2_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(USART2_IRQn);
+
+	/* Même format que la ligne A : 250 kbit/s, 8N2 */
+	huart2.Instance = USART2;
+	huart2.Init = huart1.Init;
+	huart2.Init.Mode = UART_MODE_RX;
+	huart2.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+	if (HAL_UART_Init(&huart2) != HAL_OK) {
+		Error_Handler();
+	}
+	wake.WakeUpEvent = UART_WAKEUP_ON_STARTBIT;
+	if (HAL_UARTEx_StopModeWakeUpSourceConfig(&huart2, wake) != HAL_OK) {
+		Error_Handler();
+	}
+}
+
+static void Dmx_USART2_DeInit(void)
+{
+	HAL_UART_AbortReceive(&huart2);
+	HAL_UART_DeInit(&huart2);
+	HAL_NVIC_DisableIRQ(USART2_IRQn);
+	HAL_NVIC_DisableIRQ(DMA1_Channel6_IRQn);
+	HAL_DMA_DeInit(&hdma_usart2_rx);
+	__HAL_RCC_USART2_CLK_DISABLE();
+}
+
+/* Fin de trame (sous interruption) : publication puis relance */
+static void Dmx_FrameEnd(Dmx_Line_t *l, uint16_t count)
+{
+	if (count >= 1U && l->buf[l->rx][DMX_RX_OFFSET] == DMX_START_CODE) {
+		if (count > 1U + DMX_UNIVERSE_SIZE) {
+			count = 1U + DMX_UNIVERSE_SIZE;
+		}
+		/* Univers court : canaux absents à zéro, puis fin de la comparaison */
+		memset((uint8_t *)Dmx_Slots(l, l->rx) + (count - 1U), 0, DMX_UNIVERSE_SIZE + 1U - count);
+		Dmx_Scan(l, DMX_WORDS);
+		l->ready = l->rx;
+		l->length = count - 1U;
+		l->tick = HAL_GetTick();
+		l->seq++;
+		l->rx ^= 1U;
+	}
+	Dmx_Start(l);
+}
+
+uint32_t Dmx_Compare(const uint32_t *cur, const uint32_t *prev, uint32_t *changed,
+		uint16_t first, uint16_t last, uint32_t hash)
+{
+	uint32_t w, d;
+	uint16_t i;
+
+	for (i = first; i < last; i++) {
+		w = cur[i];
+		hash = (hash ^ w) * DMX_HASH_PRIME;
+		d = w ^ prev[i];
+		if (d == 0U) {
+			continue;
+		}
+		/* Un bit par octet non nul, regroupés en quartet */
+		d |= d >> 4;
+		d |= d >> 2;
+		d |= d >> 1;
+		changed[i >> 3] |= (((d & 0x01010101UL) * 0x10204080UL) >> 28) << ((i & 7U) * 4U);
+	}
+	return hash;
+}
+
+uint8_t Dmx_RangeChanged(const uint32_t *changed, uint16_t first, uint16_t count)
+{
+	uint16_t end = first + count;
+	uint32_t mask;
+	uint16_t w;
+
+	while (first < end) {
+		w = first >> 5;
+		mask = 0xFFFFFFFFUL << (first & 31U);
+		if ((end - (w << 5)) < 32U) {
+			mask &= 0xFFFFFFFFUL >> (32U - (end - (w << 5)));
+		}
+		if (changed[w] & mask) {
+			return 1;
+		}
+		first = (w + 1U) << 5;
+	}
+	return 0;
+}
+
+void Dmx_Init(void)
+{
+	memset(Dmx_Lines, 0, sizeof(Dmx_Lines));
+	Dmx_LineInit(DMX_LINE_A, &huart1);
+}
+
+void Dmx_SetLineB(uint8_t enable)
+{
+	Dmx_Line_t *l = &Dmx_Lines[DMX_LINE_B];
+
+	if (enable) {
+		if (!l->enabled) {
+			/* TIM15 relâche PA3 avant sa reconfiguration en USART2_RX */
+			Sync_SetMode(SYNC_OFF);
+			Dmx_USART2_Init();
+			Dmx_LineInit(DMX_LINE_B, &huart2);
+		}
+	} else {
+		if (l->enabled) {
+			l->enabled = 0;
+			Dmx_USART2_DeInit();
+		}
+		Sync_SetMode(Settings.sync_mode);
+	}
+}
+
+uint8_t Dmx_Poll(uint8_t line, Dmx_Universe_t *u)
+{
+	Dmx_Line_t *l = &Dmx_Lines[line];
+	uint32_t seq;
+	uint16_t len;
+
+	if (!l->enabled || l->seq == l->read_seq) {
+		return 0;
+	}
+	/* Une trame achevée pendant la copie réutilise le tampon : recommencer */
+	do {
+		seq = l->seq;
+		len = l->length;
+		memcpy(u->slots, Dmx_Slots(l, l->ready), DMX_UNIVERSE_SIZE);
+		memcpy(u->changed, l->changed[l->ready], sizeof(u->changed));
+		u->hash = l->hash[l->ready];
+		u->tick = l->tick;
+		l->read_stamp = l->stamp[l->ready];
+		l->read_stamped = l->stamped[l->ready];
+	} while (seq != l->seq);
+
+	if (seq - l->read_seq > 1U || l->read_seq == 0U) {
+		/* Trames manquées ou ligne relancée : modifications inconnues */
+		memset(u->changed, 0xFF, sizeof(u->changed));
+	}
+	u->length = len;
+	l->read_seq = seq;
+	return 1;
+}
+
+void Dmx_SetMarker(uint16_t slot)
+{
+	/* Pris en compte à la prochaine relance de la réception */
+	Dmx_Lines[DMX_LINE_A].marker = (slot != 0U && slot <= DMX_UNIVERSE_SIZE) ? 1U + slot : 0U;
+}
+
+uint8_t Dmx_GetStamp(uint8_t line, uint32_t *stamp)
+{
+	Dmx_Line_t *l = &Dmx_Lines[line];
+
+	if (!l->read_stamped) {
+		return 0;
+	}
+	l->read_stamped = 0;
+	*stamp = l->read_stamp;
+	return 1;
+}
+
+uint32_t Dmx_GetAge(uint8_t line)
+{
+	Dmx_Line_t *l = &Dmx_Lines[line];
+
+	if (!l->enabled || l->seq == 0) {
+		return 0xFFFFFFFFU;
+	}
+	return HAL_GetTick() - l->tick;
+}
+
+uint8_t Dmx_IsPresent(uint8_t line)
+{
+	return Dmx_GetAge(line) < DMX_LOSS_TIMEOUT_MS;
+}
+
+void Dmx_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	Dmx_Line_t *l = Dmx_Find(huart);
+	uint16_t count;
+
+	if (l == NULL) {
+		return;
+	}
+	if ((huart->ErrorCode & HAL_UART_ERROR_FE) == 0U) {
+		/* Bruit ou débordement : trame abandonnée */
+		Dmx_Start(l);
+		return;
+	}
+
+	/* BREAK : l'octet nul en erreur a été transféré si RXNE est retombé */
+	count = DMX_RX_LEN - __HAL_DMA_GET_COUNTER(huart->hdmarx);
+	if (count > 0U && __HAL_UART_GET_FLAG(huart, UART_FLAG_RXNE) == RESET) {
+		count--;
+	}
+	Dmx_FrameEnd(l, count);
+}
+
+void Dmx_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart)
+{
+	Dmx_Line_t *l = Dmx_Find(huart);
+
+	if (l != NULL) {
+		Dmx_Scan(l, DMX_HALF_WORDS);
+	}
+}
+
+void Dmx_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+	Dmx_Line_t *l = Dmx_Find(huart);
+
+	if (l != NULL) {
+		/* Tampon plein sans BREAK : flux invalide, on resynchronise */
+		Dmx_Start(l);
+	}
+}
+
+#if ISR_FAST_PATH
+void Dmx_UART_IRQHandler(uint8_t line)
+{
+	Dmx_Line_t *l = &Dmx_Lines[line];
+	USART_TypeDef *uart = l->huart->Instance;
+	uint32_t isr = uart->ISR;
+	uint16_t count;
+
+	if (!(isr & (USART_ISR_FE | USART_ISR_NE | USART_ISR_ORE))) {
+		return;
+	}
+	uart->ICR = USART_ICR_FECF | USART_ICR_NECF | USART_ICR_ORECF;
+	if (!l->enabled) {
+		return;
+	}
+	l->huart->hdmarx->Instance->CCR &= ~DMA_CCR_EN;
+	if (!(isr & USART_ISR_FE)) {
+		/* Bruit ou débordement : trame abandonnée */
+		Dmx_Start(l);
+		return;
+	}
+
+	/* BREAK : l'octet nul en erreur a été transféré si RXNE est retombé */
+	count = l->span - l->huart->hdmarx->Instance->CNDTR;
+	if (count > 0U && !(uart->ISR & USART_ISR_RXNE)) {
+		count--;
+	}
+	Dmx_FrameEnd(l, count);
+}
+
+void Dmx_DMA_IRQHandler(uint8_t line)
+{
+	Dmx_Line_t *l = &Dmx_Lines[line];
+	DMA_HandleTypeDef *hdma = l->huart->hdmarx;
+	uint32_t shift = hdma->ChannelIndex & 0x1CU;
+	uint32_t isr = hdma->DmaBaseAddress->ISR >> shift;
+
+	hdma->DmaBaseAddress->IFCR = DMA_IFCR_CGIF1 << shift;
+	if (!l->enabled) {
+		return;
+	}
+	if ((isr & (DMA_ISR_TCIF1 | DMA_ISR_TEIF1)) == DMA_ISR_TCIF1 && l->span < DMX_RX_LEN) {
+		/* Canal repère reçu : datation, puis suite de la trame */
+		l->stamp[l->rx] = TIMEBASE_NOW();
+		l->stamped[l->rx] = 1;
+		hdma->Instance->CCR &= ~DMA_CCR_EN;
+		hdma->Instance->CNDTR = DMX_RX_LEN - l->span;
+		hdma->Instance->CMAR = (uint32_t)&l->buf[l->rx][DMX_RX_OFFSET + l->span];
+		hdma->Instance->CCR |= DMA_CCR_EN;
+		l->span = DMX_RX_LEN;
+		Latency_Slot_Callback();
+	} else if (isr & (DMA_ISR_TCIF1 | DMA_ISR_TEIF1)) {
+		/* Tampon plein sans BREAK ou erreur de bus : on resynchronise */
+		Dmx_Start(l);
+	} else if ((isr & DMA_ISR_HTIF1) && l->span == DMX_RX_LEN) {
+		Dmx_Scan(l, DMX_HALF_WORDS);
+	}
+}
+#endif
@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    effects.c
+  * @brief   Effets autonomes calés sur la phase du tempo.
+  *
+  *          Chaque effet est une fonction pure de (temps, phase) : il ne
+  *          garde aucun état et reste donc aligné sur le tempo, quel que soit
+  *          le moment où il est sélectionné ou recalé par une frappe.
+  *          Seul l'effet sonore suit le signal, son état vit dans audio.c.
+  ******************************************************************************
+  */
+#include "effects.h"
+#include "settings.h"
+#include "output.h"
+#include "audio.h"
+
+/* Roue chromatique : teinte 0..65535 vers R, G, B saturés */
+static void Effects_Hue(uint16_t hue, uint16_t *r, uint16_t *g, uint16_t *b)
+{
+	uint32_t h = (uint32_t)hue * 6U;
+	uint16_t up = (uint16_t)h;
+	uint16_t down = 0xFFFFU - up;
+
+	switch (h >> 16) {
+	case 0:  *r = 0xFFFF; *g = up;     *b = 0;      break;
+	case 1:  *r = down;   *g = 0xFFFF; *b = 0;      break;
+	case 2:  *r = 0;      *g = 0xFFFF; *b = up;     break;
+	case 3:  *r = 0;      *g = down;   *b = 0xFFFF; break;
+	case 4:  *r = up;     *g = 0;      *b = 0xFFFF; break;
+	default: *r = 0xFFFF; *g = 0;      *b = down;   break;
+	}
+}
+
+void Effects_Update(uint32_t phase, uint32_t beats)
+{
+	uint16_t r = 0, g = 0, b = 0;
+	uint32_t level;
+
+	if (Output_GetSource() != OUTPUT_SRC_EFFECT) {
+		return;
+	}
+
+	switch (Settings.effect) {
+	case EFFECT_PULSE:
+		/* Décroissance quadratique sur le temps : perçue linéaire */
+		level = (~phase) >> 16;
+		r = g = b = (uint16_t)((level * level) >> 16);
+		break;
+
+	case EFFECT_CHASE:
+		switch (beats % 3U) {
+		case 0:  r = 0xFFFF; break;
+		case 1:  g = 0xFFFF; break;
+		default: b = 0xFFFF; break;
+		}
+		break;
+
+	case EFFECT_STROBE:
+		if (phase < EFFECTS_STROBE_WIDTH) {
+			r = g = b = 0xFFFF;
+		}
+		break;
+
+	case EFFECT_RAINBOW:
+		/* Temps (modulo) en poids forts, phase en poids faibles */
+		Effects_Hue((uint16_t)((((beats % EFFECTS_RAINBOW_BEATS) << 16) | (phase >> 16))
+				/ EFFECTS_RAINBOW_BEATS), &r, &g, &b);
+		break;
+
+	case EFFECT_AUDIO:
+		Audio_Render(&r, &g, &b);
+		break;
+
+	case EFFECT_NONE:
+	default:
+		break;
+	}
+
+	Output_Write(OUTPUT_SRC_EFFECT, r, g, b);
+}
@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file    fault.c
+  * @brief   Relevé des défauts en SRAM2 conservée.
+  *
+  *          Fault_Capture s'exécute dans le gestionnaire de défaut, sur la
+  *          pile en cours : le cadre n'est lu que s'il est dans la SRAM1
+  *          (une pile débordée peut elle-même être la cause) et aucune
+  *          fonction de la HAL n'est appelée. La pile est parcourue depuis
+  *          le cadre : tout mot impair dans le code de l'application est
+  *          retenu comme adresse de retour probable.
+  ******************************************************************************
+  */
+#include "fault.h"
+#include <string.h>
+#include "boot.h"
+#include "retain.h"
+
+typedef struct {
+	Retain_Header_t header;
+	uint32_t reported;      /*!< Signalé au démarrage qui a suivi le défaut */
+	Fault_Info_t info;
+} Fault_Record_t;
+
+extern uint32_t _estack;
+extern uint32_t _etext;
+
+RETAIN static Fault_Record_t Fault_Record;
+
+static uint8_t Fault_Valid;
+static uint8_t Fault_Pending;
+
+/* Cadre de base (8 mots), plus le contexte FPU (18 mots) et l'alignement */
+static uint32_t Fault_StackBefore(const uint32_t *frame, uint32_t exc_return)
+{
+	uint32_t sp = (uint32_t)frame + 32U;
+
+	if (!(exc_return & 0x10U)) {
+		sp += 72U;
+	}
+	if (frame[7] & (1UL << 9)) {
+		sp += 4U;
+	}
+	return sp;
+}
+
+void Fault_Capture(uint32_t *frame, uint32_t exc_return)
+{
+	Fault_Info_t *f = &Fault_Record.info;
+	uint32_t top = (uint32_t)&_estack;
+	uint32_t count, w;
+	const uint32_t *p;
+	uint8_t n = 0;
+
+	count = Retain_Valid(&Fault_Record, sizeof(Fault_Record)) ? f->count : 0U;
+	memset(&Fault_Record, 0, sizeof(Fault_Record));
+	f->exception = __get_IPSR() & 0x1FFU;
+	f->exc_return = exc_return;
+	f->cfsr = SCB->CFSR;
+	f->hfsr = SCB->HFSR;
+	f->mmfar = SCB->MMFAR;
+	f->bfar = SCB->BFAR;
+	f->uptime_ms = uwTick;
+	f->count = count + 1U;
+
+	if ((uint32_t)frame >= SRAM1_BASE && (uint32_t)frame <= top - 32U) {
+		f->r0 = frame[0];
+		f->r1 = frame[1];
+		f->r2 = frame[2];
+		f->r3 = frame[3];
+		f->r12 = frame[4];
+		f->lr = frame[5];
+		f->pc = frame[6];
+		f->xpsr = frame[7];
+		f->sp = Fault_StackBefore(frame, exc_return);
+
+		for (p = (const uint32_t *)f->sp; (uint32_t)p < top && p < (const uint32_t *)f->sp + FAULT_SCAN_WORDS
+				&& n < FAULT_TRACE_DEPTH; p++) {
+			w = *p;
+			if ((w & 1U) && w > BOOT_APP_BASE && w < (uint32_t)&_etext) {
+				f->trace[n++] = w & ~1UL;
+			}
+		}
+	}
+	Retain_Seal(&Fault_Record, sizeof(Fault_Record));
+	NVIC_SystemReset();
+}
+
+void Fault_Init(void)
+{
+	/* Défauts distingués au lieu de tous remonter en HardFault */
+	SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk | SCB_SHCSR_USGFAULTENA_Msk;
+
+	Fault_Valid = !(Retain_GetCause() & RCC_CSR_BORRSTF)
+			&& Retain_Valid(&Fault_Record, sizeof(Fault_Record));
+	Fault_Pending = Fault_Valid && !Fault_Record.reported;
+	if (Fault_Pending) {
+		/* Signalé une seule fois, même si d'autres resets suivent */
+		Fault_Record.reported = 1;
+		Retain_Seal(&Fault_Record, sizeof(Fault_Record));
+	}
+}
+
+const Fault_Info_t *Fault_Get(void)
+{
+	return Fault_Valid ? &Fault_Record.info : NULL;
+}
+
+uint8_t Fault_IsPending(void)
+{
+	return Fault_Pending;
+}
+
+void Fault_Acknowledge(void)
+{
+	Fault_Pending = 0;
+}
+
+void Fault_Clear(void)
+{
+	Fault_Valid = 0;
+	Fault_Pending = 0;
+	memset(&Fault_Record, 0, sizeof(Fault_Record));
+}
@@ -0,0 +1,181 @@
+/**
+  ******************************************************************************
+  * @file    fixture.c
+  * @brief   Projecteur DMX : personnalités et politique de perte.
+  *
+  *          Les canaux ne sont relus que si leur plage a changé dans
+  *          l'univers fusionné, ou si l'adresse ou la personnalité ont été
+  *          modifiées ; les sorties ne sont réécrites que si les niveaux
+  *          ont changé.
+  *
+  *          En mode ruban, chaque triplet de canaux à partir de l'adresse
+  *          est un pixel R, G, B ; la perte du signal agit sur l'atténuation
+  *          globale du ruban.
+  ******************************************************************************
+  */
+#include "fixture.h"
+#include "settings.h"
+#include "output.h"
+#include "merge.h"
+#include "strip.h"
+#include "record.h"
+#include "retain.h"
+#include "watchdog.h"
+#include "latency.h"
+
+static uint16_t Fixture_Level[3];   /* R, G, B linéaires 16 bits */
+static uint8_t Fixture_Seen;
+static uint8_t Fixture_Lost;
+static uint32_t Fixture_LostTick;
+static uint16_t Fixture_Address;
+static uint8_t Fixture_Personality;
+static uint8_t Fixture_Mode;
+static uint8_t Fixture_Dirty;       /* Niveaux pas encore écrits sur les sorties */
+
+/* Lecture des canaux à partir de l'adresse selon la personnalité */
+static void Fixture_Map(const uint8_t *slots)
+{
+	const uint8_t *s = &slots[Settings.dmx_address - 1U];
+	uint32_t dim;
+	uint8_t i;
+
+	switch (Settings.personality) {
+	case PERSONALITY_RGB16:
+		/* 16 bits : valeurs déjà linéaires */
+		for (i = 0; i < 3U; i++) {
+			Fixture_Level[i] = (uint16_t)((s[2U * i] << 8) | s[2U * i + 1U]);
+		}
+		break;
+
+	case PERSONALITY_DIM_RGB:
+		/* Gamma 2 : gamma(dim x c) = gamma(dim) x gamma(c) */
+		dim = Output_Gamma8(s[0]);
+		for (i = 0; i < 3U; i++) {
+			Fixture_Level[i] = (uint16_t)((Output_Gamma8(s[1U + i]) * dim) >> 16);
+		}
+		break;
+
+	case PERSONALITY_RGB8:
+	default:
+		for (i = 0; i < 3U; i++) {
+			Fixture_Level[i] = Output_Gamma8(s[i]);
+		}
+		break;
+	}
+}
+
+/* Pixels du ruban disponibles à partir de l'adresse */
+static uint16_t Fixture_Pixels(void)
+{
+	uint16_t n = (DMX_UNIVERSE_SIZE + 1U - Settings.dmx_address) / 3U;
+
+	return (n > STRIP_PIXELS) ? STRIP_PIXELS : n;
+}
+
+/* Canaux lus à partir de l'adresse dans le mode de sortie courant */
+static uint16_t Fixture_Footprint(void)
+{
+	if (Settings.output_mode == OUTPUT_MODE_STRIP) {
+		return Fixture_Pixels() * 3U;
+	}
+	return Settings_Footprint(Settings.personality);
+}
+
+/* Ecriture des niveaux sur les sorties, atténués par k (0..65536) */
+static void Fixture_Write(uint32_t k)
+{
+	if (Output_GetSource() != OUTPUT_SRC_DMX) {
+		/* Sortie attribuée à une autre source : réécriture dès le retour */
+		Fixture_Dirty = 1;
+		return;
+	}
+	if (Strip_IsActive()) {
+		if (Fixture_Dirty && Strip_SetPixels(&Merge_GetUniverse()[Settings.dmx_address - 1U], Fixture_Pixels())) {
+			Fixture_Dirty = 0;
+		}
+		Strip_SetScale(k);
+		return;
+	}
+	Output_Write(OUTPUT_SRC_DMX, (uint16_t)((Fixture_Level[0] * k) >> 16),
+			(uint16_t)((Fixture_Level[1] * k) >> 16),
+			(uint16_t)((Fixture_Level[2] * k) >> 16));
+	Fixture_Dirty = 0;
+}
+
+void Fixture_Init(void)
+{
+	Fixture_Level[0] = Fixture_Level[1] = Fixture_Level[2] = 0;
+	Fixture_Seen = 0;
+	Fixture_Lost = 0;
+	Fixture_Address = 0;
+	Fixture_Dirty = 0;
+}
+
+void Fixture_Process(void)
+{
+	uint32_t elapsed, k;
+	uint8_t written;
+
+	Watchdog_Checkin(WATCHDOG_TASK_DMX);
+	if (Merge_Process()) {
+		if (!Fixture_Seen || Fixture_Lost || Settings.dmx_address != Fixture_Address
+				|| Settings.personality != Fixture_Personality
+				|| Settings.output_mode != Fixture_Mode
+				|| Merge_SlotsChanged(Settings.dmx_address - 1U, Fixture_Footprint())) {
+			Fixture_Map(Merge_GetUniverse());
+			Fixture_Address = Settings.dmx_address;
+			Fixture_Personality = Settings.personality;
+			Fixture_Mode = Settings.output_mode;
+			Fixture_Dirty = 1;
+		}
+		Fixture_Seen = 1;
+		Fixture_Lost = 0;
+		Record_Frame(&Merge_GetUniverse()[Settings.dmx_address - 1U], Fixture_Footprint());
+		Retain_Frame(Merge_GetUniverse());
+		written = Fixture_Dirty && Output_GetSource() == OUTPUT_SRC_DMX && !Strip_IsActive();
+		if (Fixture_Dirty || Output_GetSource() != OUTPUT_SRC_DMX) {
+			Fixture_Write(65536U);
+		}
+		Latency_Frame(written);
+		return;
+	}
+	if (!Fixture_Seen) {
+		return;
+	}
+	if (!Fixture_Lost && !Merge_IsPresent()) {
+		Fixture_Lost = 1;
+		Fixture_LostTick = HAL_GetTick();
+	}
+	if (!Fixture_Lost) {
+		return;
+	}
+
+	/* Signal perdu : réappliqué à chaque passage, la source ayant pu changer */
+	switch (Settings.loss_policy) {
+	case LOSS_BLACKOUT:
+		Fixture_Write(0);
+		break;
+
+	case LOSS_FADE:
+		elapsed = HAL_GetTick() - Fixture_LostTick;
+		k = (elapsed >= FIXTURE_FADE_MS) ? 0U : 65536U - (elapsed << 16) / FIXTURE_FADE_MS;
+		Fixture_Write(k);
+		break;
+
+	case LOSS_HOLD:
+	case LOSS_PLAYBACK:
+		/* Rejeu : maintien jusqu'à la première trame rejouée */
+		Fixture_Write(65536U);
+		break;
+
+	case LOSS_STANDALONE:
+	default:
+		/* Les effets reprennent la main (Fixture_IsActive) */
+		break;
+	}
+}
+
+uint8_t Fixture_IsActive(void)
+{
+	return Fixture_Seen && !(Fixture_Lost && Settings.loss_policy == LOSS_STANDALONE);
+}
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file    flash.c
+  * @brief   Accès en écriture à la flash interne.
+  ******************************************************************************
+  */
+#include "flash.h"
+#include <string.h>
+
+HAL_StatusTypeDef Flash_ErasePage(uint32_t addr)
+{
+	FLASH_EraseInitTypeDef erase = {0};
+	uint32_t error;
+	HAL_StatusTypeDef ret;
+
+	erase.TypeErase = FLASH_TYPEERASE_PAGES;
+	erase.Banks = FLASH_BANK_1;
+	erase.Page = (addr - FLASH_BASE) / FLASH_PAGE_SIZE;
+	erase.NbPages = 1;
+
+	HAL_FLASH_Unlock();
+	ret = HAL_FLASHEx_Erase(&erase, &error);
+	HAL_FLASH_Lock();
+	return ret;
+}
+
+HAL_StatusTypeDef Flash_Program(uint32_t addr, const void *data, uint32_t len)
+{
+	const uint8_t *src = data;
+	HAL_StatusTypeDef ret = HAL_OK;
+	uint64_t dw;
+
+	HAL_FLASH_Unlock();
+	for (; len >= FLASH_DWORD_SIZE && ret == HAL_OK; len -= FLASH_DWORD_SIZE) {
+		/* Source quelconque : copie pour l'alignement */
+		memcpy(&dw, src, sizeof(dw));
+		if (dw != UINT64_MAX) {
+			/* Double-mot effacé : rien à programmer */
+			ret = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, addr, dw);
+		}
+		addr += FLASH_DWORD_SIZE;
+		src += FLASH_DWORD_SIZE;
+	}
+	HAL_FLASH_Lock();
+	return ret;
+}
@@ -0,0 +1,267 @@
+/**
+  ******************************************************************************
+  * @file    host.c
+  * @brief   Flux d'images de l'hôte USB, appliquées au SOF.
+  *
+  *          La réception (interruption USB) ne fait que déposer la dernière
+  *          image ; le SOF suivant la présente. Pendant le flux, TIM1 compte
+  *          HOST_SOF_TICKS par période et chaque SOF le remet à zéro par une
+  *          mise à jour logicielle qui charge aussi les comparaisons : les
+  *          niveaux changent exactement au SOF, quelle que soit la phase de
+  *          la PWM.
+  *
+  *          L'horloge de TIM1 (HSI) et le SOF (quartz de l'hôte) dérivent :
+  *          - SOF en retard, TIM1 a déjà débordé (mise à jour normale) :
+  *            la remise à zéro se fait sans interruption (URS) pour ne pas
+  *            compter deux fois la période dans le tempo ;
+  *          - SOF en avance, la période est écourtée : la mise à jour
+  *            logicielle lève l'interruption de TIM1 qui cadence le tempo.
+  *          Le tempo avance ainsi d'une période par SOF.
+  *
+  *          L'intervalle entre SOF mesuré en ticks TIM1 donne la dérive
+  *          (moyenne) et la gigue (écart à la moyenne) de l'horloge USB vue
+  *          par la carte, latence d'interruption comprise.
+  ******************************************************************************
+  */
+#include "host.h"
+#include <string.h>
+#include "tim.h"
+#include "tempo.h"
+#include "output.h"
+#include "boot.h"
+#include "strip.h"
+#include "fault.h"
+#include "usbd_cdc_if.h"
+
+static volatile uint8_t Host_Streaming;
+static volatile uint32_t Host_LastRx;
+static uint8_t Host_Locked;
+static uint8_t Host_Measure;
+static uint16_t Host_Pending[3];
+static volatile uint8_t Host_HavePending;
+static uint16_t Host_Level[3];
+static uint8_t Host_Seq;
+static uint8_t Host_HaveSeq;
+static int32_t Host_OffsetQ8;       /* Ecart moyen à HOST_SOF_TICKS, 1/256 tick */
+static Host_Stats_t Host_Stats;
+static uint8_t Host_Tx[1U + sizeof(Host_Stats_t)];
+static uint8_t Host_FaultTx[1U + sizeof(Fault_Info_t)];
+
+/* Période de TIM1 calée sur le SOF, ou période PWM d'origine */
+static void Host_Lock(uint8_t on)
+{
+	__HAL_TIM_SET_AUTORELOAD(&htim1, on ? HOST_SOF_TICKS - 1U : htim1.Init.Period);
+	htim1.Instance->CR1 |= TIM_CR1_URS;
+	__HAL_TIM_SET_COUNTER(&htim1, 0);
+	htim1.Instance->EGR = TIM_EGR_UG;
+	if (!on) {
+		htim1.Instance->CR1 &= ~TIM_CR1_URS;
+	}
+	Tempo_Recompute();
+	Host_Locked = on;
+	Host_Measure = 0;
+}
+
+static void Host_Frame(uint8_t seq, const uint16_t *rgb)
+{
+	if (Host_HaveSeq && seq != (uint8_t)(Host_Seq + 1U)) {
+		Host_Stats.lost += (uint8_t)(seq - Host_Seq - 1U);
+	}
+	Host_Seq = seq;
+	Host_HaveSeq = 1;
+	if (Host_HavePending) {
+		Host_Stats.dropped++;
+	}
+	memcpy(Host_Pending, rgb, sizeof(Host_Pending));
+	Host_HavePending = 1;
+	Host_LastRx = HAL_GetTick();
+	Host_Streaming = 1;
+}
+
+static void Host_SendStats(uint8_t reset)
+{
+	Host_Tx[0] = HOST_PKT_STATS;
+	memcpy(&Host_Tx[1], &Host_Stats, sizeof(Host_Stats));
+	CDC_Transmit_FS(Host_Tx, sizeof(Host_Tx));
+	if (reset) {
+		memset(&Host_Stats, 0, sizeof(Host_Stats));
+		Host_Stats.drift_ppm = (Host_OffsetQ8 * 125) / 2048;
+	}
+}
+
+/* Dernier défaut relevé (fault.h), effacé sur demande une fois envoyé */
+static void Host_SendFault(uint8_t clear)
+{
+	const Fault_Info_t *f = Fault_Get();
+
+	Host_FaultTx[0] = HOST_PKT_FAULT;
+	if (f != NULL) {
+		memcpy(&Host_FaultTx[1], f, sizeof(*f));
+	} else {
+		memset(&Host_FaultTx[1], 0, sizeof(*f));
+	}
+	CDC_Transmit_FS(Host_FaultTx, sizeof(Host_FaultTx));
+	if (clear) {
+		Fault_Clear();
+	} else {
+		Fault_Acknowledge();
+	}
+}
+
+/* Dérive et gigue d'un intervalle entre deux SOF (ticks TIM1) */
+static void Host_Timing(uint32_t interval)
+{
+	int32_t dev = ((int32_t)interval - (int32_t)HOST_SOF_TICKS) * 256;
+	int32_t jitter = dev - Host_OffsetQ8;
+	uint32_t ns;
+
+	Host_OffsetQ8 += jitter / 16;
+	/* 1 tick = 1/64 us, 1/256 tick sur 64000 ticks = 125/2048 ppm */
+	Host_Stats.drift_ppm = (Host_OffsetQ8 * 125) / 2048;
+	ns = ((uint32_t)(jitter < 0 ? -jitter : jitter) * 125U) >> 11;
+	if (ns > Host_Stats.jitter_ns) {
+		Host_Stats.jitter_ns = ns;
+	}
+}
+
+void Host_Init(void)
+{
+	Host_Streaming = 0;
+	Host_Locked = 0;
+	Host_HavePending = 0;
+	Host_HaveSeq = 0;
+	Host_OffsetQ8 = 0;
+	memset(Host_Level, 0, sizeof(Host_Level));
+	memset(&Host_Stats, 0, sizeof(Host_Stats));
+}
+
+void Host_Process(void)
+{
+	if (!Host_Streaming || HAL_GetTick() - Host_LastRx < HOST_STREAM_TIMEOUT_MS) {
+		return;
+	}
+	__disable_irq();
+	Host_Streaming = 0;
+	Host_HavePending = 0;
+	Host_HaveSeq = 0;
+	if (Host_Locked && !Strip_IsActive()) {
+		Host_Lock(0);
+	}
+	Host_Locked = 0;
+	__enable_irq();
+}
+
+uint8_t Host_IsStreaming(void)
+{
+	return Host_Streaming;
+}
+
+const Host_Stats_t *Host_GetStats(void)
+{
+	return &Host_Stats;
+}
+
+void Host_Receive(const uint8_t *buf, uint32_t len)
+{
+	uint16_t rgb[3];
+	uint32_t i = 0;
+	uint8_t k;
+
+	while (i < len) {
+		switch (buf[i]) {
+		case HOST_PKT_RGB8:
+			if (len - i < 5U) {
+				return;
+			}
+			for (k = 0; k < 3U; k++) {
+				rgb[k] = Output_Gamma8(buf[i + 2U + k]);
+			}
+			Host_Frame(buf[i + 1U], rgb);
+			i += 5U;
+			break;
+
+		case HOST_PKT_RGB16:
+			if (len - i < 8U) {
+				return;
+			}
+			for (k = 0; k < 3U; k++) {
+				rgb[k] = buf[i + 2U + 2U * k] | ((uint16_t)buf[i + 3U + 2U * k] << 8);
+			}
+			Host_Frame(buf[i + 1U], rgb);
+			i += 8U;
+			break;
+
+		case HOST_PKT_STATS:
+			if (len - i < 2U) {
+				return;
+			}
+			Host_SendStats(buf[i + 1U]);
+			i += 2U;
+			break;
+
+		case HOST_PKT_FAULT:
+			if (len - i < 2U) {
+				return;
+			}
+			Host_SendFault(buf[i + 1U]);
+			i += 2U;
+			break;
+
+		case HOST_PKT_BOOT:
+			/* Clé pour qu'un octet parasite ne suffise pas */
+			if (len - i >= 5U && memcmp(&buf[i + 1U], "BOOT", 4) == 0) {
+				Boot_Request();
+			}
+			return;
+
+		default:
+			/* Paquet inconnu : la suite n'est plus alignée */
+			return;
+		}
+	}
+}
+
+void Host_SOF(void)
+{
+	uint32_t cnt = htim1.Instance->CNT;
+
+	if (!Host_Streaming) {
+		return;
+	}
+	if (Host_HavePending) {
+		memcpy(Host_Level, Host_Pending, sizeof(Host_Level));
+		Host_HavePending = 0;
+		Host_Stats.frames++;
+	} else {
+		Host_Stats.late++;
+	}
+
+	if (Strip_IsActive()) {
+		/* Ruban : TIM1 appartient au DMA, couleur unie à la prochaine image */
+		if (Host_Locked) {
+			htim1.Instance->CR1 &= ~TIM_CR1_URS;
+			Host_Locked = 0;
+		}
+		Output_Write(OUTPUT_SRC_HOST, Host_Level[0], Host_Level[1], Host_Level[2]);
+		return;
+	}
+	if (!Host_Locked) {
+		Host_Lock(1);
+		Output_Write(OUTPUT_SRC_HOST, Host_Level[0], Host_Level[1], Host_Level[2]);
+		return;
+	}
+
+	if (Host_Measure) {
+		Host_Timing(cnt < HOST_SOF_GUARD ? HOST_SOF_TICKS + cnt : cnt);
+	}
+	Host_Measure = 1;
+
+	/* Comparaisons préchargées, transférées par la mise à jour logicielle */
+	Output_Write(OUTPUT_SRC_HOST, Host_Level[0], Host_Level[1], Host_Level[2]);
+	if (cnt < HOST_SOF_GUARD) {
+		htim1.Instance->CR1 |= TIM_CR1_URS;
+	} else {
+		htim1.Instance->CR1 &= ~TIM_CR1_URS;
+	}
+	htim1.Instance->EGR = TIM_EGR_UG;
+}
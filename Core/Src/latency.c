@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file    latency.c
+  * @brief   Mesure de la latence DMX vers lumière.
+  *
+  *          La boucle principale arme la mesure (Latency_Frame) ;
+  *          l'interruption de TIM1 la termine (Latency_Tick). Les dates
+  *          passent de l'une à l'autre par des variables écrites avant le
+  *          drapeau Latency_Armed, lui-même effacé par l'interruption.
+  *
+  *          Une classe saturée divise tout l'histogramme par deux : les
+  *          proportions, donc les centiles, sont conservées.
+  ******************************************************************************
+  */
+#include "latency.h"
+#include <string.h>
+#include "tim.h"
+#include "dmx.h"
+#include "settings.h"
+
+static uint8_t Latency_Mode;
+static uint16_t Latency_Slot;
+static uint16_t Latency_Hist[LATENCY_BINS];
+static Latency_Stats_t Latency_Stats;
+
+static volatile uint8_t Latency_Armed;
+static uint32_t Latency_SlotStamp;
+static uint32_t Latency_WriteStamp;
+
+/* Dernier canal de l'empreinte PWM, repère de la ligne A */
+static void Latency_UpdateSlot(void)
+{
+	uint16_t slot = 0;
+
+	if (Latency_Mode != LATENCY_OFF) {
+		slot = Settings.dmx_address + Settings_Footprint(Settings.personality) - 1U;
+	}
+	if (slot != Latency_Slot) {
+		Latency_Slot = slot;
+		Dmx_SetMarker(slot);
+	}
+}
+
+static void Latency_Record(uint32_t us)
+{
+	uint32_t bin = us / LATENCY_BIN_US;
+	uint16_t i;
+
+	if (bin >= LATENCY_BINS) {
+		bin = LATENCY_BINS - 1U;
+	}
+	if (Latency_Hist[bin] == 0xFFFFU) {
+		for (i = 0; i < LATENCY_BINS; i++) {
+			Latency_Hist[i] >>= 1;
+		}
+	}
+	Latency_Hist[bin]++;
+	Latency_Stats.last_us = us;
+	if (us > Latency_Stats.max_us) {
+		Latency_Stats.max_us = us;
+	}
+	Latency_Stats.count++;
+}
+
+/* Borne haute de la classe contenant le centile pct, au plus le maximum */
+static uint32_t Latency_Percentile(uint32_t total, uint8_t pct)
+{
+	uint32_t rank = (total * pct + 99U) / 100U;
+	uint32_t sum = 0, us;
+	uint16_t i;
+
+	if (total == 0U) {
+		return 0;
+	}
+	for (i = 0; i < LATENCY_BINS - 1U; i++) {
+		sum += Latency_Hist[i];
+		if (sum >= rank) {
+			break;
+		}
+	}
+	us = (i + 1U) * LATENCY_BIN_US;
+	return (us > Latency_Stats.max_us) ? Latency_Stats.max_us : us;
+}
+
+void Latency_SetMode(uint8_t mode)
+{
+	if (mode >= LATENCY_MODE_COUNT) {
+		mode = LATENCY_OFF;
+	}
+	Latency_Mode = mode;
+	Latency_Armed = 0;
+	LED_GPIO_Port->BSRR = LED_Pin;
+	__disable_irq();
+	memset(Latency_Hist, 0, sizeof(Latency_Hist));
+	memset(&Latency_Stats, 0, sizeof(Latency_Stats));
+	__enable_irq();
+	Latency_UpdateSlot();
+}
+
+uint8_t Latency_GetMode(void)
+{
+	return Latency_Mode;
+}
+
+void Latency_Frame(uint8_t written)
+{
+	uint32_t stamp;
+	uint8_t stamped = Dmx_GetStamp(DMX_LINE_A, &stamp);
+
+	if (Latency_Mode == LATENCY_OFF) {
+		return;
+	}
+	Latency_UpdateSlot();
+	if (!written) {
+		return;
+	}
+	if (!stamped) {
+		Latency_Stats.missed++;
+		return;
+	}
+	/* Une mesure encore armée est remplacée : ses CCR ont été réécrits */
+	Latency_Armed = 0;
+	Latency_SlotStamp = stamp;
+	Latency_WriteStamp = TIMEBASE_NOW();
+	Latency_Armed = 1;
+}
+
+void Latency_Slot_Callback(void)
+{
+	if (Latency_Mode == LATENCY_MARKER) {
+		LED_GPIO_Port->BRR = LED_Pin;
+	}
+}
+
+void Latency_Tick(void)
+{
+	uint32_t now, uev;
+
+	if (!Latency_Armed) {
+		return;
+	}
+	/* Date de l'événement de mise à jour qui a ouvert la période en cours */
+	now = TIMEBASE_NOW();
+	uev = now - TIM1->CNT * TIMEBASE_TICKS_PER_US / (SystemCoreClock / 1000000U);
+	if ((int32_t)(uev - Latency_WriteStamp) < 0) {
+		/* CCR écrits pendant cette période : appliqués à la suivante */
+		return;
+	}
+	Latency_Armed = 0;
+	Latency_Record((uev - Latency_SlotStamp) / TIMEBASE_TICKS_PER_US);
+	LED_GPIO_Port->BSRR = LED_Pin;
+}
+
+const Latency_Stats_t *Latency_GetStats(void)
+{
+	uint32_t total = 0;
+	uint16_t i;
+
+	/* Sans masquage : une mesure ajoutée pendant le parcours ne décale les
+	   centiles que d'une classe, et la datation du canal reste à l'heure */
+	for (i = 0; i < LATENCY_BINS; i++) {
+		total += Latency_Hist[i];
+	}
+	Latency_Stats.p50_us = Latency_Percentile(total, 50U);
+	Latency_Stats.p99_us = Latency_Percentile(total, 99U);
+	return &Latency_Stats;
+}
@@ -22,6 +22,7 @@
 #include "i2c.h"
 #include "tim.h"
 #include "usart.h"
+#include "dma.h"
 #include "usb_device.h"
 #include "gpio.h"
 
@@ -30,6 +31,27 @@
 #include <stdio.h>
 #include "ssd1306.h"
 #include "fonts.h"
+#include "buttons.h"
+#include "settings.h"
+#include "output.h"
+#include "menu.h"
+#include "tempo.h"
+#include "sync.h"
+#include "dmx.h"
+#include "merge.h"
+#include "fixture.h"
+#include "host.h"
+#include "bulk.h"
+#include "record.h"
+#include "cue.h"
+#include "power.h"
+#include "clock.h"
+#include "retain.h"
+#include "fault.h"
+#include "watchdog.h"
+#include "config.h"
+#include "sensor.h"
+#include "audio.h"
 
 
 /* USER CODE END Includes */
@@ -64,6 +86,33 @@ void SystemClock_Config(void);
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
 
+/* Attribue les sorties : la mire de test prime, puis l'hôte, le DMX, la
+   conduite (qui repart du début à chaque reprise) et enfin les effets */
+static void App_SelectSource(void)
+{
+  if (Output_GetSource() == OUTPUT_SRC_TEST)
+  {
+    return;
+  }
+  if (Host_IsStreaming())
+  {
+    Cue_Stop();
+    Output_SetSource(OUTPUT_SRC_HOST);
+  }
+  else if (Fixture_IsActive())
+  {
+    Cue_Stop();
+    Output_SetSource(OUTPUT_SRC_DMX);
+  }
+  else if (Cue_Play())
+  {
+    Output_SetSource(Cue_GetSource());
+  }
+  else
+  {
+    Output_SetSource((Settings.effect != EFFECT_NONE) ? OUTPUT_SRC_EFFECT : OUTPUT_SRC_NONE);
+  }
+}
 
 /* USER CODE END 0 */
 
@@ -92,15 +141,21 @@ int main(void)
 
   /* USER CODE BEGIN SysInit */
 
+  /* Redémarrage à chaud : sorties PWM rétablies avant toute autre init */
+  Retain_Init();
+  Fault_Init();
+
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_ADC1_Init();
   MX_TIM2_Init();
   MX_I2C3_Init();
   MX_TIM1_Init();
   MX_TIM15_Init();
+  MX_TIM6_Init();
   MX_USART1_UART_Init();
   MX_USB_DEVICE_Init();
   /* USER CODE BEGIN 2 */
@@ -111,11 +166,51 @@ int main(void)
   HAL_Delay(100);
 
   SSD1306_Init();
-  SSD1306_Clear();
-  SSD1306_GotoXY (10,10); // goto 10, 10
-  SSD1306_Puts ("test", &Font_7x10, SSD1306_COLOR_WHITE);
-  SSD1306_UpdateScreen(); // update screen
 
+  /* Réglages enregistrés en flash, puis état conservé (plus récent) */
+  Config_Init();
+  Settings_Init();
+  Retain_RestoreSettings();
+  Output_Init();
+  Menu_Init();
+
+  /* Base de temps 32 bits puis boutons (EXTI + échéances TIM2 CH1) */
+  HAL_TIM_Base_Start(&htim2);
+  Buttons_Init();
+
+  /* Conduite : cues sur les échéances TIM2 CH2 */
+  Cue_Init();
+
+  /* Phase du tempo avancée à chaque période PWM (mise à jour TIM1) */
+  Tempo_Init();
+  Output_SetMode(Settings.output_mode);
+
+  /* Réception DMX (ligne A, et ligne B si PA3 lui est attribué) */
+  Merge_Init();
+  Fixture_Init();
+  Dmx_Init();
+  Dmx_SetLineB(Settings.rx2_mode == RX2_DMX);
+
+  /* Enregistrement des trames reçues, rejeu en l'absence de console */
+  Record_Init();
+
+  /* Dernière trame conservée, rendue comme un rejeu jusqu'au retour du DMX */
+  Retain_RestoreFrame();
+
+  /* Flux d'images de l'hôte USB, appliquées au SOF */
+  Host_Init();
+
+  /* Profils d'horloge : timers relevés à pleine vitesse */
+  Clock_Init();
+
+  /* Mesures internes (VREFINT, température) sur le débordement de TIM15 */
+  Sensor_Init();
+
+  /* Veille en Stop 1, réveil sur DMX, boutons ou reprise USB */
+  Power_Init();
+
+  /* Chien de garde en dernier : plus d'attente bloquante au-delà */
+  Watchdog_Init();
 
   /* USER CODE END 2 */
 
@@ -131,6 +226,24 @@ int main(void)
 
 	      /* USER CODE BEGIN 3 */
 
+    Menu_Process();
+    Fixture_Process();
+    Record_Process();
+    Sync_Process();
+    Host_Process();
+    Bulk_Process();
+    App_SelectSource();
+    Clock_Process();
+    Sensor_Process();
+    Audio_Process();
+    Retain_Process();
+    Watchdog_Process();
+
+    /* Rien à traiter : sommeil (ou Stop 1 au repos) jusqu'à la prochaine interruption */
+    if (!Buttons_Pending())
+    {
+      Power_Idle();
+    }
 
   }
   /* USER CODE END 3 */
@@ -196,11 +309,9 @@ void SystemClock_Config(void)
 void Error_Handler(void)
 {
   /* USER CODE BEGIN Error_Handler_Debug */
-  /* User can add his own implementation to report the HAL error return state */
+  /* Redémarrage immédiat : les sorties sont rétablies depuis la SRAM2 */
   __disable_irq();
-  while (1)
-  {
-  }
+  NVIC_SystemReset();
   /* USER CODE END Error_Handler_Debug */
 }
 
@@ -0,0 +1,604 @@
+/**
+  ******************************************************************************
+  * @file    menu.c
+  * @brief   Menu de configuration sur l'afficheur SSD1306.
+  *
+  *          L'écran est découpé en lignes de 12 pixels. Une action ne
+  *          redessine que les lignes touchées et n'envoie que les pages
+  *          correspondantes (SSD1306_UpdateArea) ; l'écran complet n'est
+  *          transféré qu'à l'ouverture, à la fermeture ou au défilement.
+  ******************************************************************************
+  */
+#include "menu.h"
+#include <stdio.h>
+#include <string.h>
+#include "ssd1306.h"
+#include "fonts.h"
+#include "buttons.h"
+#include "settings.h"
+#include "output.h"
+#include "tempo.h"
+#include "sync.h"
+#include "dmx.h"
+#include "merge.h"
+#include "record.h"
+#include "fault.h"
+#include "watchdog.h"
+#include "latency.h"
+
+#define MENU_ROW_Y(row)         (2U + (row) * MENU_ROW_H)
+#define MENU_ROW_H              12U
+#define MENU_VISIBLE            4U      /* Lignes d'entrées sous le titre */
+#define MENU_TEXT_LEN           19U     /* 18 caractères 7x10 par ligne */
+
+#define MENU_CONTRAST_STEP      16U
+#define MENU_TEST_PERIOD_MS     1000U
+#define MENU_HOME_ROWS          5U
+#define MENU_HOME_PERIOD_MS     500U
+
+typedef enum {
+	MENU_ITEM_ADDRESS = 0,
+	MENU_ITEM_PERSONALITY,
+	MENU_ITEM_LOSS,
+	MENU_ITEM_CONTRAST,
+	MENU_ITEM_EFFECT,
+	MENU_ITEM_SYNC,
+	MENU_ITEM_RX2,
+	MENU_ITEM_MERGE,
+	MENU_ITEM_OUTPUT,
+	MENU_ITEM_RECORD,
+	MENU_ITEM_LATENCY,
+	MENU_ITEM_TEST,
+	MENU_ITEM_COUNT
+} Menu_Item_t;
+
+static const char * const Menu_Labels[MENU_ITEM_COUNT] = {
+	"Adresse", "Mode", "Perte", "Contraste", "Effet", "Synchro", "RX2", "Fusion", "Sortie", "Enreg.", "Latence", "Test"
+};
+
+static const char * const Menu_LatencyNames[LATENCY_MODE_COUNT] = {
+	"Off", "On", "PA5"
+};
+
+/* Mire de test : rouge, vert, bleu, blanc */
+static const uint8_t Menu_TestColors[4][3] = {
+	{ 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 }, { 255, 255, 255 }
+};
+
+static uint8_t Menu_Active;
+static uint8_t Menu_Cursor;
+static uint8_t Menu_Top;
+static uint8_t Menu_Editing;
+static uint8_t Menu_Chord;
+
+static char Menu_Home[MENU_HOME_ROWS][MENU_TEXT_LEN];
+static uint32_t Menu_HomeTick;
+
+static uint8_t Menu_Test;
+static uint8_t Menu_Recording;      /* Etat affiché de l'enregistrement */
+static uint8_t Menu_TestStep;
+static uint32_t Menu_TestTick;
+
+static void Menu_DrawRow(uint8_t row, char *text, uint8_t selected)
+{
+	uint16_t y = MENU_ROW_Y(row);
+
+	SSD1306_DrawFilledRectangle(0, y, SSD1306_WIDTH - 1, MENU_ROW_H - 1,
+			selected ? SSD1306_COLOR_WHITE : SSD1306_COLOR_BLACK);
+	SSD1306_GotoXY(1, y + 1);
+	SSD1306_Puts(text, &Font_7x10, selected ? SSD1306_COLOR_BLACK : SSD1306_COLOR_WHITE);
+}
+
+static void Menu_FlushRow(uint8_t row)
+{
+	SSD1306_UpdateArea(0, MENU_ROW_Y(row), SSD1306_WIDTH, MENU_ROW_H);
+}
+
+static void Menu_FormatValue(uint8_t item, char *buf, uint8_t len)
+{
+	switch (item) {
+	case MENU_ITEM_ADDRESS:
+		snprintf(buf, len, "%03u", Settings.dmx_address);
+		break;
+	case MENU_ITEM_PERSONALITY:
+		snprintf(buf, len, "%s", Settings_PersonalityName(Settings.personality));
+		break;
+	case MENU_ITEM_LOSS:
+		snprintf(buf, len, "%s", Settings_LossName(Settings.loss_policy));
+		break;
+	case MENU_ITEM_CONTRAST:
+		snprintf(buf, len, "%u", Settings.contrast);
+		break;
+	case MENU_ITEM_EFFECT:
+		snprintf(buf, len, "%s", Settings_EffectName(Settings.effect));
+		break;
+	case MENU_ITEM_SYNC:
+		snprintf(buf, len, "%s", Settings_SyncName(Settings.sync_mode));
+		break;
+	case MENU_ITEM_RX2:
+		snprintf(buf, len, "%s", Settings_Rx2Name(Settings.rx2_mode));
+		break;
+	case MENU_ITEM_MERGE:
+		snprintf(buf, len, "%s", Settings_MergeName(Settings.merge_mode));
+		break;
+	case MENU_ITEM_OUTPUT:
+		snprintf(buf, len, "%s", Settings_OutputName(Settings.output_mode));
+		break;
+	case MENU_ITEM_RECORD:
+		snprintf(buf, len, "%s", Record_IsRecording() ? "On" : (Record_HasFailed() ? "Err" : "Off"));
+		break;
+	case MENU_ITEM_LATENCY:
+		snprintf(buf, len, "%s", Menu_LatencyNames[Latency_GetMode()]);
+		break;
+	case MENU_ITEM_TEST:
+	default:
+		snprintf(buf, len, "%s", Menu_Test ? "On" : "Off");
+		break;
+	}
+}
+
+/* Dessine l'entrée dans le tampon si elle est visible, retourne sa ligne */
+static uint8_t Menu_DrawItem(uint8_t item)
+{
+	char value[MENU_TEXT_LEN];
+	char text[MENU_TEXT_LEN + 2];
+	uint8_t row;
+
+	if (item < Menu_Top || item >= Menu_Top + MENU_VISIBLE) {
+		return 0;
+	}
+	row = 1U + item - Menu_Top;
+
+	Menu_FormatValue(item, value, sizeof(value));
+	if (Menu_Editing && item == Menu_Cursor) {
+		snprintf(text, sizeof(text), "%-9.9s<%.7s>", Menu_Labels[item], value);
+	} else {
+		snprintf(text, sizeof(text), "%-9.9s %.8s", Menu_Labels[item], value);
+	}
+	Menu_DrawRow(row, text, item == Menu_Cursor);
+	return row;
+}
+
+/* Redessine une entrée et ne transfère que sa ligne */
+static void Menu_RefreshItem(uint8_t item)
+{
+	uint8_t row = Menu_DrawItem(item);
+
+	if (row != 0) {
+		Menu_FlushRow(row);
+	}
+}
+
+static void Menu_DrawAll(void)
+{
+	char text[MENU_TEXT_LEN];
+	uint8_t i;
+
+	SSD1306_Fill(SSD1306_COLOR_BLACK);
+	snprintf(text, sizeof(text), "   - Reglages -");
+	Menu_DrawRow(0, text, 0);
+	for (i = 0; i < MENU_ITEM_COUNT; i++) {
+		Menu_DrawItem(i);
+	}
+	SSD1306_UpdateScreen();
+}
+
+/* Titre de l'écran d'accueil : défaut, enregistrement perdu ou synchronisation */
+static void Menu_FormatStatus(char *buf, uint8_t len)
+{
+	static const char * const names[] = { "NMI", "Hard", "Mem", "Bus", "Usg" };
+	const Fault_Info_t *f = Fault_Get();
+	int32_t v;
+
+	if (Fault_IsPending() && f != NULL) {
+		/* Redémarrage sur défaut : type et adresse, jusqu'à l'ouverture du menu */
+		snprintf(buf, len, "Def. %s %08lX",
+				(f->exception >= 2U && f->exception <= 6U) ? names[f->exception - 2U] : "?",
+				(unsigned long)f->pc);
+		return;
+	}
+	if (Record_HasFailed()) {
+		/* Enregistrement perdu : jusqu'au suivant */
+		snprintf(buf, len, "Enreg. en echec");
+		return;
+	}
+	if (Settings.rx2_mode != RX2_SYNC) {
+		snprintf(buf, len, "AnimLED DMX");
+		return;
+	}
+	switch (Settings.sync_mode) {
+	case SYNC_MASTER:
+		snprintf(buf, len, "AnimLED  Sync M");
+		break;
+	case SYNC_SLAVE:
+		switch (Sync_GetState()) {
+		case SYNC_STATE_LOCKED:
+			v = Sync_GetDriftPpm();
+			v = (v > 99999) ? 99999 : ((v < -99999) ? -99999 : v);
+			snprintf(buf, len, "Sync OK %+6ldppm", (long)v);
+			break;
+		case SYNC_STATE_ACQUIRE:
+			v = Sync_GetErrorUs();
+			v = (v > 999999) ? 999999 : ((v < -999999) ? -999999 : v);
+			snprintf(buf, len, "Sync ~ %+7ldus", (long)v);
+			break;
+		default:
+			snprintf(buf, len, "Sync absente");
+			break;
+		}
+		break;
+	default:
+		snprintf(buf, len, "AnimLED DMX");
+		break;
+	}
+}
+
+static const char *Menu_LineState(uint8_t line)
+{
+	if (line == DMX_LINE_B && Settings.rx2_mode != RX2_DMX) {
+		return "off";
+	}
+	return Dmx_IsPresent(line) ? "ok" : "--";
+}
+
+/* Microsecondes en dixièmes de milliseconde arrondis au-dessus, 99.9 au plus */
+static uint32_t Menu_Tenths(uint32_t us)
+{
+	uint32_t t = (us + 99U) / 100U;
+
+	return (t > 999U) ? 999U : t;
+}
+
+static void Menu_FormatHome(uint8_t row, char *buf, uint8_t len)
+{
+	const Latency_Stats_t *lat;
+	uint32_t bpm, p50, p99, max;
+
+	switch (row) {
+	case 0:
+		Menu_FormatStatus(buf, len);
+		break;
+	case 1:
+		snprintf(buf, len, "Adr   %03u", Settings.dmx_address);
+		break;
+	case 2:
+		snprintf(buf, len, "Mode  %s", Settings_PersonalityName(Settings.personality));
+		break;
+	case 3:
+		if (Settings.merge_mode == MERGE_FAILOVER && Settings.rx2_mode == RX2_DMX) {
+			snprintf(buf, len, "DMX A:%s B:%s >%c", Menu_LineState(DMX_LINE_A),
+					Menu_LineState(DMX_LINE_B), "ABHS"[Merge_GetActiveSource()]);
+		} else {
+			snprintf(buf, len, "DMX A:%s B:%s", Menu_LineState(DMX_LINE_A), Menu_LineState(DMX_LINE_B));
+		}
+		break;
+	default:
+		if (Latency_GetMode() != LATENCY_OFF) {
+			/* Mesure en cours : médiane, 99e centile et maximum en ms */
+			lat = Latency_GetStats();
+			p50 = Menu_Tenths(lat->p50_us);
+			p99 = Menu_Tenths(lat->p99_us);
+			max = Menu_Tenths(lat->max_us);
+			snprintf(buf, len, "Lat %lu.%lu/%lu.%lu/%lu.%lu",
+					(unsigned long)(p50 / 10U), (unsigned long)(p50 % 10U),
+					(unsigned long)(p99 / 10U), (unsigned long)(p99 % 10U),
+					(unsigned long)(max / 10U), (unsigned long)(max % 10U));
+			break;
+		}
+		bpm = Tempo_GetBPMx10();
+		snprintf(buf, len, "BPM %3lu.%lu %s", (unsigned long)(bpm / 10U), (unsigned long)(bpm % 10U),
+				Settings_EffectName(Settings.effect));
+		break;
+	}
+}
+
+static void Menu_DrawHome(void)
+{
+	uint8_t row;
+
+	SSD1306_Fill(SSD1306_COLOR_BLACK);
+	for (row = 0; row < MENU_HOME_ROWS; row++) {
+		Menu_FormatHome(row, Menu_Home[row], MENU_TEXT_LEN);
+		Menu_DrawRow(row, Menu_Home[row], 0);
+	}
+	SSD1306_UpdateScreen();
+}
+
+/* Ne redessine et ne transfère que les lignes d'accueil modifiées */
+static void Menu_RefreshHome(void)
+{
+	char text[MENU_TEXT_LEN];
+	uint8_t row;
+
+	for (row = 0; row < MENU_HOME_ROWS; row++) {
+		Menu_FormatHome(row, text, sizeof(text));
+		if (strcmp(text, Menu_Home[row]) != 0) {
+			memcpy(Menu_Home[row], text, sizeof(text));
+			Menu_DrawRow(row, Menu_Home[row], 0);
+			Menu_FlushRow(row);
+		}
+	}
+}
+
+/* Pas d'incrément selon la durée de maintien */
+static uint16_t Menu_Step(uint8_t repeat)
+{
+	if (repeat >= 20U) {
+		return 50;
+	}
+	if (repeat >= 8U) {
+		return 10;
+	}
+	return 1;
+}
+
+static void Menu_SetTest(uint8_t on)
+{
+	Menu_Test = on;
+	Menu_TestStep = 0;
+	Menu_TestTick = HAL_GetTick();
+	if (on) {
+		Output_SetSource(OUTPUT_SRC_TEST);
+		Output_SetRGB8(Menu_TestColors[0][0], Menu_TestColors[0][1], Menu_TestColors[0][2]);
+	} else {
+		/* La boucle principale réattribue les sorties */
+		Output_SetSource(OUTPUT_SRC_NONE);
+	}
+}
+
+/* Modifie la valeur sélectionnée ; retourne 1 si tout l'écran est à revoir */
+static uint8_t Menu_Adjust(int8_t dir, uint8_t repeat)
+{
+	int32_t addr;
+	uint16_t max;
+
+	switch (Menu_Cursor) {
+	case MENU_ITEM_ADDRESS:
+		addr = (int32_t)Settings.dmx_address + dir * (int32_t)Menu_Step(repeat);
+		max = Settings_MaxAddress();
+		if (addr < 1) {
+			addr = (repeat == 0) ? max : 1;
+		} else if (addr > max) {
+			addr = (repeat == 0) ? 1 : max;
+		}
+		Settings.dmx_address = (uint16_t)addr;
+		return 0;
+
+	case MENU_ITEM_PERSONALITY:
+		Settings.personality = (Settings.personality + PERSONALITY_COUNT + dir) % PERSONALITY_COUNT;
+		max = Settings_MaxAddress();
+		if (Settings.dmx_address > max) {
+			/* L'adresse change aussi : sa ligne est à redessiner */
+			Settings.dmx_address = max;
+			return 1;
+		}
+		return 0;
+
+	case MENU_ITEM_LOSS:
+		Settings.loss_policy = (Settings.loss_policy + LOSS_COUNT + dir) % LOSS_COUNT;
+		return 0;
+
+	case MENU_ITEM_CONTRAST:
+		if (dir > 0) {
+			Settings.contrast = (Settings.contrast > 255U - MENU_CONTRAST_STEP) ? 255U : Settings.contrast + MENU_CONTRAST_STEP;
+		} else {
+			Settings.contrast = (Settings.contrast < MENU_CONTRAST_STEP) ? 0U : Settings.contrast - MENU_CONTRAST_STEP;
+		}
+		SSD1306_SetContrast(Settings.contrast);
+		return 0;
+
+	case MENU_ITEM_EFFECT:
+		Settings.effect = (Settings.effect + EFFECT_COUNT + dir) % EFFECT_COUNT;
+		return 0;
+
+	case MENU_ITEM_SYNC:
+		Settings.sync_mode = (Settings.sync_mode + SYNC_MODE_COUNT + dir) % SYNC_MODE_COUNT;
+		if (Settings.rx2_mode == RX2_SYNC) {
+			Sync_SetMode(Settings.sync_mode);
+		}
+		return 0;
+
+	case MENU_ITEM_RX2:
+		Settings.rx2_mode = (Settings.rx2_mode + RX2_COUNT + dir) % RX2_COUNT;
+		Dmx_SetLineB(Settings.rx2_mode == RX2_DMX);
+		return 0;
+
+	case MENU_ITEM_MERGE:
+		Settings.merge_mode = (Settings.merge_mode + MERGE_COUNT + dir) % MERGE_COUNT;
+		return 0;
+
+	case MENU_ITEM_OUTPUT:
+		Settings.output_mode = (Settings.output_mode + OUTPUT_MODE_COUNT + dir) % OUTPUT_MODE_COUNT;
+		Output_SetMode(Settings.output_mode);
+		return 0;
+
+	case MENU_ITEM_RECORD:
+		if (Record_IsRecording()) {
+			Record_Stop();
+		} else {
+			Record_Start();
+		}
+		return 0;
+
+	case MENU_ITEM_LATENCY:
+		Latency_SetMode((Latency_GetMode() + LATENCY_MODE_COUNT + dir) % LATENCY_MODE_COUNT);
+		return 0;
+
+	case MENU_ITEM_TEST:
+	default:
+		Menu_SetTest(!Menu_Test);
+		return 0;
+	}
+}
+
+static void Menu_Move(int8_t dir)
+{
+	uint8_t prev = Menu_Cursor;
+
+	Menu_Cursor = (Menu_Cursor + MENU_ITEM_COUNT + dir) % MENU_ITEM_COUNT;
+
+	if (Menu_Cursor < Menu_Top) {
+		Menu_Top = Menu_Cursor;
+		Menu_DrawAll();
+	} else if (Menu_Cursor >= Menu_Top + MENU_VISIBLE) {
+		Menu_Top = Menu_Cursor + 1U - MENU_VISIBLE;
+		Menu_DrawAll();
+	} else {
+		/* Seules l'ancienne et la nouvelle ligne changent */
+		Menu_RefreshItem(prev);
+		Menu_RefreshItem(Menu_Cursor);
+	}
+}
+
+static void Menu_Open(void)
+{
+	Fault_Acknowledge();
+	Menu_Active = 1;
+	Menu_Editing = 0;
+	Menu_Cursor = 0;
+	Menu_Top = 0;
+	Menu_DrawAll();
+}
+
+static void Menu_Close(void)
+{
+	Menu_Active = 0;
+	Menu_Editing = 0;
+	Settings_Save();
+	Menu_DrawHome();
+}
+
+static void Menu_HandleEvent(const Button_Event_t *evt)
+{
+	int8_t dir;
+
+	if (evt->type == BUTTON_EVT_CHORD) {
+		Menu_Chord = 1;
+		if (Menu_Active && evt->mask == (BUTTON_MASK(BUTTON_SW2) | BUTTON_MASK(BUTTON_SW3))) {
+			if (Menu_Editing) {
+				Menu_Editing = 0;
+				Menu_RefreshItem(Menu_Cursor);
+			} else {
+				Menu_Close();
+			}
+		}
+		return;
+	}
+	if (Menu_Chord) {
+		/* Ignorer la fin d'un accord jusqu'au relâchement complet */
+		if (evt->type == BUTTON_EVT_RELEASE && evt->mask == 0) {
+			Menu_Chord = 0;
+		}
+		return;
+	}
+
+	if (evt->button == BUTTON_SW1) {
+		if (evt->type == BUTTON_EVT_LONG) {
+			if (Menu_Active) {
+				Menu_Close();
+			} else {
+				Menu_Open();
+			}
+		} else if (evt->type == BUTTON_EVT_RELEASE && evt->repeat == 0 && Menu_Active) {
+			/* Appui court */
+			if (Menu_Cursor == MENU_ITEM_TEST || Menu_Cursor == MENU_ITEM_RECORD) {
+				Menu_Adjust(1, 0);
+			} else {
+				Menu_Editing = !Menu_Editing;
+			}
+			Menu_RefreshItem(Menu_Cursor);
+		}
+		return;
+	}
+
+	if (!Menu_Active) {
+		/* Hors menu : SW2 frappe le tempo, SW3 passe à l'effet suivant */
+		if (evt->type == BUTTON_EVT_PRESS) {
+			if (evt->button == BUTTON_SW2) {
+				/* En esclave, le tempo appartient au maître */
+				if (Settings.rx2_mode == RX2_SYNC && Settings.sync_mode == SYNC_SLAVE) {
+					return;
+				}
+				Tempo_Tap(evt->time);
+			} else {
+				Settings.effect = (Settings.effect + 1U) % EFFECT_COUNT;
+				Settings_Save();
+			}
+			Menu_RefreshHome();
+		}
+		return;
+	}
+	if (evt->type == BUTTON_EVT_RELEASE) {
+		return;
+	}
+
+	dir = (evt->button == BUTTON_SW3) ? 1 : -1;
+	if (Menu_Editing) {
+		if (Menu_Adjust(dir, evt->repeat)) {
+			Menu_RefreshItem(MENU_ITEM_ADDRESS);
+		}
+		Menu_RefreshItem(Menu_Cursor);
+	} else {
+		/* En navigation, SW2 descend et SW3 monte */
+		Menu_Move(-dir);
+	}
+}
+
+/* Etat de l'enregistrement tel qu'affiché : 0 arrêté, 1 en cours, 2 perdu */
+static uint8_t Menu_RecordState(void)
+{
+	return Record_IsRecording() ? 1U : (Record_HasFailed() ? 2U : 0U);
+}
+
+void Menu_Init(void)
+{
+	Menu_Active = 0;
+	Menu_Editing = 0;
+	Menu_Chord = 0;
+	Menu_Test = 0;
+	Menu_Recording = 0;
+	SSD1306_SetContrast(Settings.contrast);
+	Menu_DrawHome();
+}
+
+void Menu_Process(void)
+{
+	Button_Event_t evt;
+
+	while (Buttons_GetEvent(&evt)) {
+		Menu_HandleEvent(&evt);
+	}
+
+	if (Menu_Test && (HAL_GetTick() - Menu_TestTick) >= MENU_TEST_PERIOD_MS) {
+		Menu_TestTick += MENU_TEST_PERIOD_MS;
+		Menu_TestStep = (Menu_TestStep + 1U) & 3U;
+		Output_SetRGB8(Menu_TestColors[Menu_TestStep][0],
+				Menu_TestColors[Menu_TestStep][1],
+				Menu_TestColors[Menu_TestStep][2]);
+	}
+
+	if (Menu_RecordState() != Menu_Recording) {
+		/* Arrêt de l'enregistrement sur emplacement plein ou échec de la flash */
+		Menu_Recording = Menu_RecordState();
+		if (Menu_Active) {
+			Menu_RefreshItem(MENU_ITEM_RECORD);
+		}
+	}
+
+	if (!Menu_Active && (HAL_GetTick() - Menu_HomeTick) >= MENU_HOME_PERIOD_MS) {
+		/* Etat DMX, synchronisation, tempo imposé par le maître */
+		Menu_HomeTick = HAL_GetTick();
+		Menu_RefreshHome();
+	}
+	Watchdog_Checkin(WATCHDOG_TASK_DISPLAY);
+}
+
+uint8_t Menu_IsActive(void)
+{
+	return Menu_Active;
+}
+
+uint8_t Menu_IsTestActive(void)
+{
+	return Menu_Test;
+}
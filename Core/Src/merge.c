@@ -0,0 +1,340 @@
+/**
+  ******************************************************************************
+  * @file    merge.c
+  * @brief   Fusion des sources DMX.
+  *
+  *          Les univers sont traités par mots de 32 bits, soit quatre
+  *          canaux par instruction :
+  *          - HTP : __USUB8 positionne les drapeaux GE octet par octet
+  *            (a >= b) et __SEL retient l'octet le plus grand ;
+  *          - LTP : un OU exclusif avec la trame précédente de la source
+  *            saute d'un coup les mots inchangés ; chaque canal modifié
+  *            est daté, et la modification la plus récente l'emporte,
+  *            quel que soit l'ordre de traitement des sources. Une source
+  *            qui rejoint la fusion est reprise en entier : une console qui
+  *            revient avec la même trame qu'avant sa perte efface ainsi les
+  *            valeurs du rejeu ou de la trame restaurée au démarrage.
+  *          Une source perdue (DMX_LOSS_TIMEOUT_MS) ne participe plus.
+  *
+  *          Chaque trame arrive avec sa carte de canaux modifiés : une trame
+  *          identique à la précédente ne déclenche aucun calcul, et l'univers
+  *          fusionné est publié avec sa propre carte, obtenue en le
+  *          comparant à sa version précédente.
+  ******************************************************************************
+  */
+#include "merge.h"
+#include <string.h>
+#include "dmx.h"
+#include "settings.h"
+
+#define MERGE_WORDS             (DMX_UNIVERSE_SIZE / 4U)
+
+static Dmx_Universe_t Merge_In[MERGE_SRC_COUNT];
+static uint32_t Merge_Prev[MERGE_SRC_COUNT][MERGE_WORDS];
+static uint32_t Merge_Out[MERGE_WORDS];
+static uint32_t Merge_Last[MERGE_WORDS];
+static uint32_t Merge_Changed[DMX_CHANGED_WORDS];
+static uint32_t Merge_Hash;
+static uint8_t Merge_Contrib;       /* Sources ayant formé l'univers publié */
+static uint8_t Merge_Mode;
+static uint32_t Merge_Stamp[DMX_UNIVERSE_SIZE];
+static uint8_t Merge_Seen;
+static uint8_t Merge_Pending;
+static uint8_t Merge_Active;
+static uint32_t Merge_Cycles;
+
+static uint8_t Merge_HasChanges(const uint32_t *changed)
+{
+	uint8_t i;
+
+	for (i = 0; i < DMX_CHANGED_WORDS; i++) {
+		if (changed[i] != 0U) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static uint8_t Merge_Present(void)
+{
+	uint8_t mask = 0;
+	uint8_t s;
+
+	for (s = 0; s < MERGE_SRC_COUNT; s++) {
+		if (Merge_IsSourcePresent(s)) {
+			mask |= 1U << s;
+		}
+	}
+	/* Le rejeu cède la place sans attendre sa propre perte de signal */
+	if (mask & ~(1U << MERGE_SRC_SHOW)) {
+		mask &= ~(1U << MERGE_SRC_SHOW);
+	}
+	return mask;
+}
+
+/* Maximum octet par octet des sources présentes */
+static void Merge_HTP(uint8_t present)
+{
+	const uint32_t *src;
+	uint32_t a, b;
+	uint16_t i;
+	uint8_t s;
+
+	memset(Merge_Out, 0, sizeof(Merge_Out));
+	for (s = 0; s < MERGE_SRC_COUNT; s++) {
+		if (!(present & (1U << s))) {
+			continue;
+		}
+		src = (const uint32_t *)Merge_In[s].slots;
+		for (i = 0; i < MERGE_WORDS; i++) {
+			a = Merge_Out[i];
+			b = src[i];
+			(void)__USUB8(a, b);
+			Merge_Out[i] = __SEL(a, b);
+		}
+	}
+}
+
+/* Dernière modification datée gagnante ; les sources de full sont
+   reprises en entier, sans comparaison à leur trame précédente */
+static void Merge_LTP(uint8_t fresh, uint8_t full)
+{
+	const uint32_t *src;
+	uint8_t *out = (uint8_t *)Merge_Out;
+	uint32_t diff, tick;
+	uint16_t i, slot;
+	uint8_t s;
+
+	for (s = 0; s < MERGE_SRC_COUNT; s++) {
+		if (!((fresh | full) & (1U << s))) {
+			continue;
+		}
+		src = (const uint32_t *)Merge_In[s].slots;
+		tick = Merge_In[s].tick;
+		for (i = 0; i < MERGE_WORDS; i++) {
+			if (full & (1U << s)) {
+				diff = 0xFFFFFFFFU;
+			} else if (((Merge_In[s].changed[i >> 3] >> ((i & 7U) * 4U)) & 0xFU) == 0U) {
+				/* Carte de la réception : quatre canaux par quartet */
+				continue;
+			} else {
+				diff = src[i] ^ Merge_Prev[s][i];
+			}
+			for (slot = i * 4U; diff != 0U; slot++, diff >>= 8) {
+				if ((diff & 0xFFU) != 0U && (int32_t)(tick - Merge_Stamp[slot]) >= 0) {
+					out[slot] = Merge_In[s].slots[slot];
+					Merge_Stamp[slot] = tick;
+				}
+			}
+		}
+	}
+}
+
+void Merge_Init(void)
+{
+	memset(Merge_In, 0, sizeof(Merge_In));
+	memset(Merge_Prev, 0, sizeof(Merge_Prev));
+	memset(Merge_Out, 0, sizeof(Merge_Out));
+	memset(Merge_Changed, 0, sizeof(Merge_Changed));
+	memset(Merge_Stamp, 0, sizeof(Merge_Stamp));
+	Merge_Hash = DMX_HASH_SEED;
+	Merge_Contrib = 0;
+	Merge_Mode = Settings.merge_mode;
+	Merge_Seen = 0;
+	Merge_Pending = 0;
+	Merge_Active = MERGE_SRC_LINE_A;
+
+	/* Compteur de cycles pour la mesure du coût de fusion */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void Merge_Submit(uint8_t src, const uint8_t *slots, uint16_t length)
+{
+	Dmx_Universe_t *u;
+
+	if (src >= MERGE_SRC_COUNT) {
+		return;
+	}
+	if (length > DMX_UNIVERSE_SIZE) {
+		length = DMX_UNIVERSE_SIZE;
+	}
+	u = &Merge_In[src];
+	memcpy(u->slots, slots, length);
+	memset(&u->slots[length], 0, DMX_UNIVERSE_SIZE - length);
+	u->length = length;
+	u->tick = HAL_GetTick();
+	Merge_Seen |= 1U << src;
+	Merge_Pending |= 1U << src;
+}
+
+uint8_t Merge_Process(void)
+{
+	uint8_t fresh = Merge_Pending;
+	uint8_t present, contrib, changed, full = 0;
+	uint8_t updated = 1;
+	uint8_t dirty = 0;
+	uint32_t start;
+	uint8_t s;
+	Dmx_Universe_t *u;
+
+	Merge_Pending = 0;
+	if (Dmx_Poll(DMX_LINE_A, &Merge_In[MERGE_SRC_LINE_A])) {
+		fresh |= 1U << MERGE_SRC_LINE_A;
+	}
+	if (Dmx_Poll(DMX_LINE_B, &Merge_In[MERGE_SRC_LINE_B])) {
+		fresh |= 1U << MERGE_SRC_LINE_B;
+	}
+	if (fresh == 0) {
+		return 0;
+	}
+	Merge_Seen |= fresh;
+	present = Merge_Present();
+
+	/* Merge_Submit ne fournit pas de carte : comparaison à la trame précédente */
+	for (s = MERGE_SRC_HOST; s < MERGE_SRC_COUNT; s++) {
+		if (fresh & (1U << s)) {
+			u = &Merge_In[s];
+			memset(u->changed, 0, sizeof(u->changed));
+			u->hash = Dmx_Compare((const uint32_t *)u->slots, Merge_Prev[s],
+					u->changed, 0, MERGE_WORDS, DMX_HASH_SEED);
+		}
+	}
+	changed = 0;
+	for (s = 0; s < MERGE_SRC_COUNT; s++) {
+		if ((fresh & (1U << s)) && Merge_HasChanges(Merge_In[s].changed)) {
+			changed |= 1U << s;
+		}
+	}
+
+	if (Settings.merge_mode != Merge_Mode) {
+		/* Changement de mode : recalcul complet au prochain passage */
+		Merge_Mode = Settings.merge_mode;
+		Merge_Contrib = 0xFFU;
+	}
+
+	start = DWT->CYCCNT;
+	contrib = Merge_Contrib;
+	switch (Settings.merge_mode) {
+	case MERGE_LTP:
+		contrib = present;
+		/* Trame d'une source écartée dans le même passage (rejeu, trame
+		   restaurée) : ni appliquée, ni retenue comme précédente */
+		changed &= present;
+		if (present != Merge_Contrib) {
+			/* Sources apparues (toutes après un changement de mode) */
+			full = present & ((Merge_Contrib == 0xFFU) ? 0xFFU : ~Merge_Contrib);
+			if (Merge_Contrib != 0xFFU && (Merge_Contrib & (1U << MERGE_SRC_SHOW))
+					&& !(present & (1U << MERGE_SRC_SHOW))) {
+				/* Fin du rejeu : ses dates ne masquent plus les sources revenues */
+				memset(Merge_Stamp, 0, sizeof(Merge_Stamp));
+			}
+		}
+		if (changed != 0 || full != 0) {
+			memcpy(Merge_Last, Merge_Out, sizeof(Merge_Last));
+			Merge_LTP(changed, full);
+			dirty = 1;
+		}
+		break;
+
+	case MERGE_FAILOVER:
+		/* Première source active par ordre de priorité, sinon première présente */
+		Merge_Active = MERGE_SRC_COUNT;
+		for (s = 0; s < MERGE_SRC_COUNT; s++) {
+			if ((Merge_Seen & (1U << s)) && (HAL_GetTick() - Merge_In[s].tick) < MERGE_FAILOVER_MS) {
+				Merge_Active = s;
+				break;
+			}
+		}
+		for (s = 0; s < MERGE_SRC_COUNT && Merge_Active == MERGE_SRC_COUNT; s++) {
+			if (present & (1U << s)) {
+				Merge_Active = s;
+			}
+		}
+		if (Merge_Active == MERGE_SRC_COUNT) {
+			Merge_Active = MERGE_SRC_LINE_A;
+			updated = 0;
+			break;
+		}
+		if (!(fresh & (1U << Merge_Active))) {
+			/* Rien de neuf sur la source retenue */
+			updated = 0;
+			break;
+		}
+		contrib = 1U << Merge_Active;
+		if ((changed & contrib) || contrib != Merge_Contrib) {
+			memcpy(Merge_Last, Merge_Out, sizeof(Merge_Last));
+			memcpy(Merge_Out, Merge_In[Merge_Active].slots, sizeof(Merge_Out));
+			dirty = 1;
+		}
+		break;
+
+	case MERGE_HTP:
+	default:
+		/* Recalcul si une source a changé, est apparue ou a disparu */
+		contrib = present;
+		if ((changed & present) || present != Merge_Contrib) {
+			memcpy(Merge_Last, Merge_Out, sizeof(Merge_Last));
+			Merge_HTP(present);
+			dirty = 1;
+		}
+		break;
+	}
+
+	if (updated) {
+		Merge_Contrib = contrib;
+		memset(Merge_Changed, 0, sizeof(Merge_Changed));
+		if (dirty) {
+			Merge_Hash = Dmx_Compare(Merge_Out, Merge_Last, Merge_Changed, 0, MERGE_WORDS, DMX_HASH_SEED);
+		}
+	}
+	Merge_Cycles = DWT->CYCCNT - start;
+
+	for (s = 0; s < MERGE_SRC_COUNT; s++) {
+		if ((changed | full) & (1U << s)) {
+			memcpy(Merge_Prev[s], Merge_In[s].slots, DMX_UNIVERSE_SIZE);
+		}
+	}
+	return updated;
+}
+
+const uint8_t *Merge_GetUniverse(void)
+{
+	return (const uint8_t *)Merge_Out;
+}
+
+const uint32_t *Merge_GetChanged(void)
+{
+	return Merge_Changed;
+}
+
+uint8_t Merge_SlotsChanged(uint16_t first, uint16_t count)
+{
+	return Dmx_RangeChanged(Merge_Changed, first, count);
+}
+
+uint32_t Merge_GetHash(void)
+{
+	return Merge_Hash;
+}
+
+uint8_t Merge_IsSourcePresent(uint8_t src)
+{
+	return (src < MERGE_SRC_COUNT) && (Merge_Seen & (1U << src))
+			&& (HAL_GetTick() - Merge_In[src].tick) < DMX_LOSS_TIMEOUT_MS;
+}
+
+uint8_t Merge_IsPresent(void)
+{
+	return Merge_Present() != 0;
+}
+
+uint8_t Merge_GetActiveSource(void)
+{
+	return Merge_Active;
+}
+
+uint32_t Merge_GetCycles(void)
+{
+	return Merge_Cycles;
+}
@@ -0,0 +1,179 @@
+/**
+  ******************************************************************************
+  * @file    output.c
+  * @brief   Sorties PWM RGB sur TIM1, ou ruban de LED sur PA8.
+  *
+  *          En PWM décalé, les trois impulsions sont réparties dans la
+  *          période au lieu de démarrer ensemble au passage à zéro :
+  *          - bleu (CH1, PWM1) au début : [0, d) ;
+  *          - vert (CH3, PWM combiné 2 avec CH4) centré : OC3REF (PWM2,
+  *            actif dès CCR3) ET OC4REF (PWM1, actif avant CCR4) ;
+  *          - rouge (CH2, PWM2) en fin : [P - d, P).
+  *          Jusqu'à un tiers de rapport cyclique, une seule voie conduit à
+  *          la fois : le pic de courant de l'alimentation est divisé
+  *          d'autant. CH4 reste interne (PA11 est l'USB).
+  *
+  *          L'ARR vaut 65534 pour qu'un CCR de 65535 (PWM2, niveau nul)
+  *          reste au-dessus du compteur.
+  ******************************************************************************
+  */
+#include "output.h"
+#include "tim.h"
+#include "settings.h"
+#include "strip.h"
+#include "retain.h"
+
+static volatile uint8_t Output_Source;
+static uint8_t Output_Stagger;
+static uint16_t Output_Level[3];    /* R, G, B appliqués en PWM */
+static volatile uint32_t Output_Limit = 65536U;
+
+/* Niveau 16 bits vers valeur de comparaison pour la période courante */
+static uint32_t Output_Duty(uint16_t level)
+{
+	uint32_t l = ((uint32_t)level * Output_Limit) >> 16;
+
+	return (l * (__HAL_TIM_GET_AUTORELOAD(&htim1) + 1U)) >> 16;
+}
+
+void Output_Init(void)
+{
+	Output_Source = OUTPUT_SRC_NONE;
+	if (Retain_GetLevels(Output_Level)) {
+		/* Redémarrage à chaud : TIM1 tient déjà les rapports conservés */
+		Output_Stagger = (Settings.output_mode == OUTPUT_MODE_STAGGER);
+	} else {
+		Output_SetRGB16(0, 0, 0);
+	}
+	HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_1);
+	HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_2);
+	HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_3);
+	Strip_Init();
+}
+
+/* Modes de comparaison des voies R et G : en phase ou décalés */
+static void Output_ConfigStagger(uint8_t stagger)
+{
+	TIM_OC_InitTypeDef sConfigOC = {0};
+
+	if (stagger == Output_Stagger) {
+		return;
+	}
+	Output_Stagger = stagger;
+
+	sConfigOC.Pulse = 0;
+	sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+	sConfigOC.OCNPolarity = TIM_OCNPOLARITY_HIGH;
+	sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+	sConfigOC.OCIdleState = TIM_OCIDLESTATE_RESET;
+	sConfigOC.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+
+	sConfigOC.OCMode = stagger ? TIM_OCMODE_PWM2 : TIM_OCMODE_PWM1;
+	HAL_TIM_PWM_ConfigChannel(&htim1, &sConfigOC, TIM_CHANNEL_2);
+	sConfigOC.OCMode = stagger ? TIM_OCMODE_COMBINED_PWM2 : TIM_OCMODE_PWM1;
+	HAL_TIM_PWM_ConfigChannel(&htim1, &sConfigOC, TIM_CHANNEL_3);
+	/* Référence interne seulement : CC4E reste à 0 */
+	sConfigOC.OCMode = TIM_OCMODE_PWM1;
+	HAL_TIM_PWM_ConfigChannel(&htim1, &sConfigOC, TIM_CHANNEL_4);
+
+	Output_SetRGB16(Output_Level[0], Output_Level[1], Output_Level[2]);
+}
+
+void Output_SetMode(uint8_t mode)
+{
+	if (mode == OUTPUT_MODE_STRIP) {
+		/* Voies R et G éteintes par CCR = 0 : modes en phase */
+		Output_ConfigStagger(0);
+		Strip_Start();
+	} else {
+		Strip_Stop();
+		Output_ConfigStagger(mode == OUTPUT_MODE_STAGGER);
+	}
+}
+
+void Output_SetRGB16(uint16_t r, uint16_t g, uint16_t b)
+{
+	uint32_t period, d;
+
+	if (Strip_IsActive()) {
+		/* Couleur unie sur tout le ruban */
+		Strip_Fill(r >> 8, g >> 8, b >> 8);
+		return;
+	}
+	Output_Level[0] = r;
+	Output_Level[1] = g;
+	Output_Level[2] = b;
+	if (Output_Stagger) {
+		period = __HAL_TIM_GET_AUTORELOAD(&htim1) + 1U;
+		d = Output_Duty(g);
+		__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, Output_Duty(b));
+		__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_2, period - Output_Duty(r));
+		__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_3, (period - d) / 2U);
+		__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_4, (period - d) / 2U + d);
+		return;
+	}
+	__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, Output_Duty(b));
+	__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_2, Output_Duty(r));
+	__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_3, Output_Duty(g));
+}
+
+void Output_Refresh(void)
+{
+	if (!Strip_IsActive()) {
+		Output_SetRGB16(Output_Level[0], Output_Level[1], Output_Level[2]);
+	}
+}
+
+void Output_SetLimit(uint32_t k)
+{
+	Output_Limit = (k > 65536U) ? 65536U : k;
+	/* Les effets écrivent aussi depuis la mise à jour de TIM1 */
+	__disable_irq();
+	Output_Refresh();
+	__enable_irq();
+}
+
+void Output_SetSource(uint8_t src)
+{
+	if (src == Output_Source) {
+		return;
+	}
+	Output_Source = src;
+	if (src == OUTPUT_SRC_NONE) {
+		Output_SetRGB16(0, 0, 0);
+	}
+}
+
+uint8_t Output_GetSource(void)
+{
+	return Output_Source;
+}
+
+const uint16_t *Output_GetLevels(void)
+{
+	return Output_Level;
+}
+
+uint8_t Output_IsDark(void)
+{
+	return !Strip_IsActive() && (Output_Level[0] | Output_Level[1] | Output_Level[2]) == 0U;
+}
+
+void Output_Write(uint8_t src, uint16_t r, uint16_t g, uint16_t b)
+{
+	if (src == Output_Source) {
+		Output_SetRGB16(r, g, b);
+	}
+}
+
+uint16_t Output_Gamma8(uint8_t v)
+{
+	uint32_t x = (uint32_t)v * 257U;
+
+	return (uint16_t)((x * x) >> 16);
+}
+
+void Output_SetRGB8(uint8_t r, uint8_t g, uint8_t b)
+{
+	Output_SetRGB16(Output_Gamma8(r), Output_Gamma8(g), Output_Gamma8(b));
+}
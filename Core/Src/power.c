@@ -0,0 +1,179 @@
+/**
+  ******************************************************************************
+  * @file    power.c
+  * @brief   Entrée en Stop 1 et restauration des horloges.
+  *
+  *          Le test des conditions et l'entrée en Stop se font interruptions
+  *          masquées : un événement arrivé entre les deux réveille aussitôt
+  *          le WFI au lieu d'être perdu. Au réveil, le réveil USART est
+  *          coupé avant de démasquer les interruptions (le gestionnaire
+  *          rapide ne traite que les erreurs de trame).
+  *
+  *          Un réveil dû à LPTIM1 seul (aucune autre interruption en
+  *          attente) recharge l'IWDG et rendort aussitôt la carte, sur
+  *          HSI16 : le profil d'horloge n'est remonté qu'au vrai réveil.
+  ******************************************************************************
+  */
+#include "power.h"
+#include "usart.h"
+#include "usb_device.h"
+#include "settings.h"
+#include "output.h"
+#include "buttons.h"
+#include "dmx.h"
+#include "sync.h"
+#include "record.h"
+#include "clock.h"
+#include "watchdog.h"
+
+/* LPTIM1 : LSI / 32, 1 kHz */
+#define POWER_LPTIM_PRESC       (LPTIM_CFGR_PRESC_2 | LPTIM_CFGR_PRESC_0)
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+static uint32_t Power_IdleTick;
+static uint32_t Power_Stops;
+
+/* Réveil par le bit de start (WUS réglé à l'initialisation de l'USART) */
+static void Power_UartWake(UART_HandleTypeDef *huart, uint8_t on)
+{
+	USART_TypeDef *u = huart->Instance;
+
+	if (on) {
+		u->ICR = USART_ICR_WUCF;
+		u->CR3 |= USART_CR3_WUFIE;
+		u->CR1 |= USART_CR1_UESM;
+	} else {
+		u->CR1 &= ~USART_CR1_UESM;
+		u->CR3 &= ~USART_CR3_WUFIE;
+		u->ICR = USART_ICR_WUCF;
+	}
+}
+
+/* Réveil programmé dans POWER_WAKE_MS (LSI démarré avec l'IWDG) */
+static void Power_TimerStart(void)
+{
+	LPTIM1->CR = LPTIM_CR_ENABLE;
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+	LPTIM1->ARR = POWER_WAKE_MS;
+	while (!(LPTIM1->ISR & LPTIM_ISR_ARROK)) {
+	}
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+	LPTIM1->CR = LPTIM_CR_ENABLE | LPTIM_CR_SNGSTRT;
+}
+
+/* Arrête LPTIM1 ; retourne 1 s'il a réveillé la carte */
+static uint8_t Power_TimerStop(void)
+{
+	uint8_t fired = (LPTIM1->ISR & LPTIM_ISR_ARRM) != 0U;
+
+	LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+	LPTIM1->CR = 0;
+	NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+	return fired;
+}
+
+/* Interruption en attente (masquée) autre que LPTIM1 */
+static uint8_t Power_Pending(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < sizeof(NVIC->ISPR) / sizeof(NVIC->ISPR[0]); i++) {
+		if (NVIC->ISPR[i] != 0U) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static uint8_t Power_CanStop(void)
+{
+	uint8_t src = Output_GetSource();
+
+	if (hUsbDeviceFS.dev_state != USBD_STATE_SUSPENDED) {
+		return 0;
+	}
+	/* Sorties éteintes : aucune source, ou DMX à zéro hors ruban */
+	if (src != OUTPUT_SRC_NONE && !(src == OUTPUT_SRC_DMX && Output_IsDark())) {
+		return 0;
+	}
+	/* Echéances TIM2 en cours (boutons, conduite), enregistrement, rejeu */
+	if ((TIM2->DIER & (TIM_DIER_CC1IE | TIM_DIER_CC2IE)) != 0U
+			|| Record_IsRecording() || Record_IsPlaying()) {
+		return 0;
+	}
+	/* Maître de synchronisation : les esclaves attendent ses impulsions */
+	if (Settings.rx2_mode == RX2_SYNC && Settings.sync_mode == SYNC_MASTER) {
+		return 0;
+	}
+	return 1;
+}
+
+void Power_Init(void)
+{
+	/* Réveil sur HSI16, qui cadence aussi les USART en Stop */
+	__HAL_RCC_WAKEUPSTOP_CLK_CONFIG(RCC_STOP_WAKEUPCLOCK_HSI);
+	/* Lignes directes USB, USART1 et USART2 (démasquées par défaut) */
+	EXTI->IMR1 |= EXTI_IMR1_IM17 | EXTI_IMR1_IM25 | EXTI_IMR1_IM26;
+
+	/* LPTIM1 sur LSI, réveil par la correspondance de ARR (EXTI 32) */
+	__HAL_RCC_LPTIM1_CONFIG(RCC_LPTIM1CLKSOURCE_LSI);
+	__HAL_RCC_LPTIM1_CLK_ENABLE();
+	LPTIM1->CR = 0;
+	LPTIM1->CFGR = POWER_LPTIM_PRESC;
+	LPTIM1->IER = LPTIM_IER_ARRMIE;
+	EXTI->IMR2 |= EXTI_IMR2_IM32;
+	HAL_NVIC_SetPriority(LPTIM1_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+	Power_IdleTick = HAL_GetTick();
+	Power_Stops = 0;
+}
+
+void Power_Idle(void)
+{
+	uint8_t line_b = (Settings.rx2_mode == RX2_DMX);
+
+	if (!Power_CanStop()) {
+		Power_IdleTick = HAL_GetTick();
+	}
+	if (HAL_GetTick() - Power_IdleTick < POWER_IDLE_MS) {
+		HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+		return;
+	}
+
+	__disable_irq();
+	if (Buttons_Pending() || !Power_CanStop()) {
+		__enable_irq();
+		return;
+	}
+	Power_UartWake(&huart1, 1);
+	if (line_b) {
+		Power_UartWake(&huart2, 1);
+	}
+	HAL_SuspendTick();
+	do {
+		Watchdog_Kick();
+		Power_TimerStart();
+		HAL_PWREx_EnterSTOP1Mode(PWR_STOPENTRY_WFI);
+	} while (Power_TimerStop() && !Power_Pending());
+
+	/* Réveil sur HSI16 : interruptions servies avant la remontée du profil */
+	Power_UartWake(&huart1, 0);
+	if (line_b) {
+		Power_UartWake(&huart2, 0);
+	}
+	__enable_irq();
+	Clock_Restore();
+	HAL_ResumeTick();
+	Power_Stops++;
+}
+
+uint32_t Power_GetStops(void)
+{
+	return Power_Stops;
+}
+
+void Power_Timer_Callback(void)
+{
+	LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+}
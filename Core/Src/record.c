@@ -0,0 +1,384 @@
+/**
+  ******************************************************************************
+  * @file    record.c
+  * @brief   Enregistrement et rejeu des trames DMX.
+  *
+  *          La réception DMA (double tampon de dmx.c) n'attend jamais la
+  *          flash : l'emplacement est effacé en entier au départ, chaque
+  *          trame est codée dans un anneau en RAM et la boucle principale
+  *          n'en programme que quelques double-mots par passage. Une trame
+  *          qui ne tient plus dans l'anneau est abandonnée sans perte
+  *          d'état : la suivante est codée par rapport à la dernière
+  *          trame retenue et son délai inclut celui de la trame abandonnée.
+  *          L'enregistrement s'arrête seul quand l'emplacement est plein,
+  *          ou sur un échec de la flash : il est alors perdu et signalé
+  *          (Record_HasFailed) jusqu'au suivant.
+  *
+  *          Le rejeu lit l'enregistrement directement en flash.
+  ******************************************************************************
+  */
+#include "record.h"
+#include <string.h>
+#include "flash.h"
+#include "show.h"
+#include "settings.h"
+#include "merge.h"
+
+#define RECORD_RING_SIZE        1024U
+#define RECORD_RING_MASK        (RECORD_RING_SIZE - 1U)
+
+/* Taille maximale : l'en-tête ne doit pas être programmé par Show_Write */
+#define RECORD_MAX_LENGTH       (SHOW_SIZE - FLASH_DWORD_SIZE)
+
+/* Dernière entrée : délai (varint 32 bits) et zéro plage */
+#define RECORD_END_MAX          6U
+
+/* Entrées rejouées au plus par passage (rattrapage d'un retard) */
+#define RECORD_ENTRIES_PER_PASS 8U
+
+typedef struct {
+	Show_Header_t show;
+	uint32_t tag;           /*!< RECORD_TAG */
+	uint16_t channels;      /*!< Canaux par trame */
+	uint16_t reserved;
+} Record_Header_t;
+
+static uint8_t Record_Ring[RECORD_RING_SIZE];
+static uint16_t Record_Head;        /* Index libres, modulo RECORD_RING_SIZE */
+static uint16_t Record_Tail;
+static uint16_t Record_Next;        /* Fin de l'entrée en cours de codage */
+static uint8_t Record_Fit;
+static uint32_t Record_Length;      /* Octets mis en file, en-tête compris */
+static uint32_t Record_Offset;      /* Octets programmés */
+
+/* Dernière trame retenue (enregistrement) ou univers rejoué */
+static uint8_t Record_Slots[DMX_UNIVERSE_SIZE] __attribute__((aligned(4)));
+static uint16_t Record_Channels;
+static uint32_t Record_Tick;         /* Date de la dernière entrée */
+static uint8_t Record_Recording;
+static uint8_t Record_Failed;
+
+static uint8_t Record_Playing;
+static const uint8_t *Record_Pos;
+static uint16_t Record_Address;
+static uint32_t Record_SubmitTick;
+
+static void Record_Put(uint8_t b)
+{
+	if ((uint16_t)(Record_Next - Record_Tail) >= RECORD_RING_SIZE) {
+		Record_Fit = 0;
+		return;
+	}
+	Record_Ring[Record_Next & RECORD_RING_MASK] = b;
+	Record_Next++;
+}
+
+static void Record_Put16(uint16_t v)
+{
+	Record_Put((uint8_t)v);
+	Record_Put((uint8_t)(v >> 8));
+}
+
+static void Record_Put32(uint32_t v)
+{
+	Record_Put16((uint16_t)v);
+	Record_Put16((uint16_t)(v >> 16));
+}
+
+static void Record_PutVarint(uint32_t v)
+{
+	while (v >= 0x80U) {
+		Record_Put((uint8_t)(v | 0x80U));
+		v >>= 7;
+	}
+	Record_Put((uint8_t)v);
+}
+
+/* Programme l'anneau par double-mots ; all complète le dernier avec 0xFF */
+static void Record_Flush(uint8_t all)
+{
+	uint8_t dw[FLASH_DWORD_SIZE];
+	uint16_t avail;
+	uint16_t n;
+	uint8_t k;
+
+	for (n = 0; all || n < RECORD_DWORDS_PER_PASS; n++) {
+		avail = Record_Head - Record_Tail;
+		if (avail == 0U || (!all && avail < FLASH_DWORD_SIZE)) {
+			break;
+		}
+		for (k = 0; k < FLASH_DWORD_SIZE; k++) {
+			dw[k] = (k < avail) ? Record_Ring[(Record_Tail + k) & RECORD_RING_MASK] : 0xFFU;
+		}
+		if (Show_Write(Record_Offset, dw, FLASH_DWORD_SIZE) == SHOW_WRITE_ERROR) {
+			/* Ecriture abandonnée par show.c : la suite ne serait plus programmée */
+			Record_Recording = 0;
+			Record_Failed = 1;
+			Record_Tail = Record_Head;
+			return;
+		}
+		Record_Offset += FLASH_DWORD_SIZE;
+		Record_Tail += (avail < FLASH_DWORD_SIZE) ? avail : FLASH_DWORD_SIZE;
+	}
+}
+
+/* Canal à enregistrer : tous pour la première trame */
+static uint8_t Record_Changed(const uint8_t *slots, uint16_t i, uint16_t count)
+{
+	return i < count && (Record_Length == 0U || slots[i] != Record_Slots[i]);
+}
+
+void Record_Init(void)
+{
+	Record_Recording = 0;
+	Record_Playing = 0;
+	Record_Head = 0;
+	Record_Tail = 0;
+}
+
+void Record_Start(void)
+{
+	Record_Playing = 0;
+	Record_Head = 0;
+	Record_Tail = 0;
+	Record_Length = 0;
+	Record_Offset = 0;
+	Record_Failed = 0;
+	Show_WriteBegin(SHOW_SIZE);
+	Show_Erase();
+	Record_Tick = HAL_GetTick();
+	Record_Recording = 1;
+}
+
+void Record_Stop(void)
+{
+	if (!Record_Recording) {
+		return;
+	}
+	Record_Recording = 0;
+	if (Record_Length == 0U) {
+		/* Aucune trame : l'emplacement reste vide */
+		return;
+	}
+
+	/* Durée de la fin, jusqu'au retour au début */
+	while (RECORD_RING_SIZE - (uint16_t)(Record_Head - Record_Tail) < RECORD_END_MAX) {
+		Record_Flush(0);
+	}
+	if (Record_Failed) {
+		return;
+	}
+	Record_Next = Record_Head;
+	Record_PutVarint(HAL_GetTick() - Record_Tick);
+	Record_Put(0);
+	Record_Length += (uint16_t)(Record_Next - Record_Head);
+	Record_Head = Record_Next;
+
+	Record_Flush(1);
+	if (!Record_Failed && !Show_WriteEnd(Record_Length)) {
+		Record_Failed = 1;
+	}
+}
+
+uint8_t Record_IsRecording(void)
+{
+	return Record_Recording;
+}
+
+uint8_t Record_IsPlaying(void)
+{
+	return Record_Playing;
+}
+
+uint8_t Record_HasFailed(void)
+{
+	return Record_Failed;
+}
+
+void Record_Frame(const uint8_t *slots, uint16_t count)
+{
+	uint32_t now = HAL_GetTick();
+	uint16_t runs_at, size;
+	uint16_t i, j, end, k;
+	uint8_t runs = 0;
+
+	if (!Record_Recording) {
+		return;
+	}
+	Record_Next = Record_Head;
+	Record_Fit = 1;
+	if (Record_Length == 0U) {
+		/* Première trame : l'empreinte courante fixe la taille des trames */
+		Record_Channels = (count > DMX_UNIVERSE_SIZE) ? DMX_UNIVERSE_SIZE : count;
+		Record_Put32(SHOW_MAGIC);
+		Record_Put32(SHOW_SIZE);        /* Remplacé par Show_WriteEnd */
+		Record_Put32(RECORD_TAG);
+		Record_Put16(Record_Channels);
+		Record_Put16(0xFFFFU);
+	}
+	if (count > Record_Channels) {
+		count = Record_Channels;
+	}
+
+	Record_PutVarint(now - Record_Tick);
+	runs_at = Record_Next;
+	Record_Put(0);
+	end = 0;
+	for (i = 0; i < count; i = j) {
+		if (!Record_Changed(slots, i, count)) {
+			j = i + 1U;
+			continue;
+		}
+		/* Deux canaux inchangés coûtent autant qu'une nouvelle plage */
+		for (j = i + 1U; j < count && j - i < 255U; j++) {
+			if (!Record_Changed(slots, j, count) && !Record_Changed(slots, j + 1U, count)
+					&& !Record_Changed(slots, j + 2U, count)) {
+				break;
+			}
+		}
+		Record_PutVarint(i - end);
+		Record_Put((uint8_t)(j - i));
+		for (k = i; k < j; k++) {
+			Record_Put(slots[k]);
+		}
+		end = j;
+		runs++;
+	}
+
+	if (runs == 0U) {
+		/* Trame inchangée : son délai s'ajoute à celui de la suivante */
+		return;
+	}
+	if (!Record_Fit) {
+		/* Anneau plein : trame abandonnée, comme une trame inchangée */
+		return;
+	}
+	size = Record_Next - Record_Head;
+	if (Record_Length + size + RECORD_END_MAX > RECORD_MAX_LENGTH) {
+		Record_Stop();
+		return;
+	}
+	Record_Ring[runs_at & RECORD_RING_MASK] = runs;
+	memcpy(Record_Slots, slots, count);
+	Record_Head = Record_Next;
+	Record_Length += size;
+	Record_Tick = now;
+}
+
+/* Enregistrement valide en flash, NULL sinon (ou en cours d'écriture) */
+static const Record_Header_t *Record_Get(void)
+{
+	const Record_Header_t *h = (const Record_Header_t *)Show_Get();
+
+	if (h == NULL || h->show.length < sizeof(Record_Header_t) || h->tag != RECORD_TAG) {
+		return NULL;
+	}
+	return h;
+}
+
+static const uint8_t *Record_GetVarint(const uint8_t *p, const uint8_t *end, uint32_t *v)
+{
+	uint8_t shift = 0;
+
+	*v = 0;
+	while (p < end && shift < 32U) {
+		*v |= (uint32_t)(*p & 0x7FU) << shift;
+		if (!(*p++ & 0x80U)) {
+			return p;
+		}
+		shift += 7U;
+	}
+	return NULL;
+}
+
+/* Applique les plages d'une entrée ; retourne la fin de l'entrée, NULL si invalide */
+static const uint8_t *Record_Apply(const uint8_t *p, const uint8_t *end, uint8_t *slots, uint16_t room)
+{
+	uint32_t skip;
+	uint16_t ch = 0;
+	uint16_t n;
+	uint8_t runs, len;
+
+	if (p >= end) {
+		return NULL;
+	}
+	for (runs = *p++; runs != 0U; runs--) {
+		p = Record_GetVarint(p, end, &skip);
+		if (p == NULL || p >= end) {
+			return NULL;
+		}
+		len = *p++;
+		if (skip > (uint32_t)(Record_Channels - ch) || len > Record_Channels - ch - skip
+				|| len > end - p) {
+			return NULL;
+		}
+		ch += skip;
+		/* Adresse trop haute pour l'empreinte enregistrée : fin tronquée */
+		if (ch < room) {
+			n = room - ch;
+			memcpy(&slots[ch], p, (len < n) ? len : n);
+		}
+		ch += len;
+		p += len;
+	}
+	return p;
+}
+
+void Record_Process(void)
+{
+	const Record_Header_t *h;
+	const uint8_t *start, *end, *p;
+	uint32_t now = HAL_GetTick();
+	uint32_t dt;
+	uint16_t room;
+	uint8_t submit = 0;
+	uint8_t n;
+
+	if (Record_Recording) {
+		Record_Flush(0);
+		return;
+	}
+
+	h = Record_Get();
+	if (h == NULL || Settings.loss_policy != LOSS_PLAYBACK
+			|| Merge_IsSourcePresent(MERGE_SRC_LINE_A) || Merge_IsSourcePresent(MERGE_SRC_LINE_B)
+			|| Merge_IsSourcePresent(MERGE_SRC_HOST)) {
+		Record_Playing = 0;
+		return;
+	}
+	start = (const uint8_t *)(h + 1);
+	end = (const uint8_t *)h + h->show.length;
+	if (!Record_Playing || Settings.dmx_address != Record_Address) {
+		/* Départ au début, l'univers repart de zéro (première entrée complète) */
+		Record_Playing = 1;
+		Record_Address = Settings.dmx_address;
+		Record_Channels = (h->channels > DMX_UNIVERSE_SIZE) ? DMX_UNIVERSE_SIZE : h->channels;
+		memset(Record_Slots, 0, sizeof(Record_Slots));
+		Record_Pos = start;
+		Record_Tick = now;
+	}
+	room = DMX_UNIVERSE_SIZE + 1U - Record_Address;
+
+	for (n = 0; n < RECORD_ENTRIES_PER_PASS; n++) {
+		if (Record_Pos >= end) {
+			/* Fin de l'enregistrement : en boucle */
+			Record_Pos = start;
+		}
+		p = Record_GetVarint(Record_Pos, end, &dt);
+		if (p == NULL) {
+			Record_Pos = end;
+			continue;
+		}
+		if (now - Record_Tick < dt) {
+			break;
+		}
+		p = Record_Apply(p, end, &Record_Slots[Record_Address - 1U], room);
+		Record_Tick += dt;
+		Record_Pos = (p != NULL) ? p : end;
+		submit = 1;
+	}
+	if (submit || now - Record_SubmitTick >= RECORD_REFRESH_MS) {
+		Merge_Submit(MERGE_SRC_SHOW, Record_Slots, DMX_UNIVERSE_SIZE);
+		Record_SubmitTick = now;
+	}
+}
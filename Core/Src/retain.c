@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * @file    retain.c
+  * @brief   Relevé et restitution de l'état conservé en SRAM2.
+  *
+  *          Les registres PWM sont conservés bruts (modes de comparaison
+  *          compris, PWM décalé) ; les comparaisons sont remises à
+  *          l'échelle de la période courante, qui dépend du profil
+  *          d'horloge au moment du relevé. Le ruban n'est pas rétabli à ce
+  *          stade : il est redessiné depuis la trame réinjectée.
+  ******************************************************************************
+  */
+#include "retain.h"
+#include <string.h>
+#include "tim.h"
+#include "dmx.h"
+#include "merge.h"
+#include "output.h"
+#include "strip.h"
+
+typedef struct {
+	Retain_Header_t header;
+	uint32_t resets;
+	uint32_t cause;
+	Settings_t settings;
+	uint8_t pwm;            /*!< Registres PWM valides (hors ruban) */
+	uint16_t level[3];
+	uint32_t arr;
+	uint32_t ccr[4];
+	uint32_t ccmr1;
+	uint32_t ccmr2;
+	uint32_t ccer;
+} Retain_State_t;
+
+typedef struct {
+	Retain_Header_t header;
+	uint8_t slots[DMX_UNIVERSE_SIZE];
+} Retain_Frame_t;
+
+RETAIN static Retain_State_t Retain_State;
+RETAIN static Retain_Frame_t Retain_Slots;
+
+static uint8_t Retain_Warm;
+static uint8_t Retain_HaveFrame;
+static uint32_t Retain_Cause;
+static uint32_t Retain_Tick;
+
+/* Empreinte FNV-1a par mots, comme celle des univers (dmx.h) */
+static uint32_t Retain_Sum(const void *block, uint32_t size)
+{
+	const uint32_t *w = (const uint32_t *)((const Retain_Header_t *)block + 1);
+	uint32_t n = (size - sizeof(Retain_Header_t)) / 4U;
+	uint32_t hash = DMX_HASH_SEED;
+
+	while (n--) {
+		hash = (hash ^ *w++) * DMX_HASH_PRIME;
+	}
+	return hash;
+}
+
+uint8_t Retain_Valid(const void *block, uint32_t size)
+{
+	const Retain_Header_t *h = (const Retain_Header_t *)block;
+
+	return h->magic == RETAIN_MAGIC && h->size == size && h->sum == Retain_Sum(block, size);
+}
+
+void Retain_Seal(void *block, uint32_t size)
+{
+	Retain_Header_t *h = (Retain_Header_t *)block;
+
+	h->magic = RETAIN_MAGIC;
+	h->size = size;
+	h->sum = Retain_Sum(block, size);
+}
+
+/* Comparaison conservée ramenée à la période courante de TIM1 */
+static uint32_t Retain_Scale(uint32_t ccr)
+{
+	return (uint32_t)(((uint64_t)ccr * (TIM1->ARR + 1U)) / (Retain_State.arr + 1U));
+}
+
+static void Retain_LoadPwm(void)
+{
+	uint8_t i;
+
+	TIM1->CCMR1 = Retain_State.ccmr1;
+	TIM1->CCMR2 = Retain_State.ccmr2;
+	for (i = 0; i < 4U; i++) {
+		(&TIM1->CCR1)[i] = Retain_Scale(Retain_State.ccr[i]);
+	}
+	/* Comparaisons préchargées : prises en compte par UG */
+	TIM1->EGR = TIM_EGR_UG;
+	TIM1->CCER = Retain_State.ccer;
+	TIM1->BDTR |= TIM_BDTR_MOE;
+}
+
+void Retain_Init(void)
+{
+	uint32_t pin;
+
+	Retain_Cause = RCC->CSR;
+	__HAL_RCC_CLEAR_RESET_FLAGS();
+
+	/* Mise sous tension : la SRAM2 n'a rien retenu */
+	Retain_Warm = !(Retain_Cause & RCC_CSR_BORRSTF)
+			&& Retain_Valid(&Retain_State, sizeof(Retain_State));
+	Retain_HaveFrame = Retain_Warm && Retain_Valid(&Retain_Slots, sizeof(Retain_Slots));
+	if (!Retain_Warm) {
+		memset(&Retain_State, 0, sizeof(Retain_State));
+	}
+	Retain_State.resets = Retain_Warm ? Retain_State.resets + 1U : 0U;
+	Retain_State.cause = Retain_Cause;
+	Retain_Seal(&Retain_State, sizeof(Retain_State));
+	if (!Retain_Warm || !Retain_State.pwm) {
+		return;
+	}
+
+	/* PA8, PA9, PA10 en AF1 (TIM1_CH1..3), comme HAL_TIM_MspPostInit */
+	RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
+	RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+	(void)RCC->APB2ENR;
+	TIM1->ARR = Retain_State.arr;
+	Retain_LoadPwm();
+	TIM1->CR1 |= TIM_CR1_CEN;
+	for (pin = 8U; pin <= 10U; pin++) {
+		GPIOA->AFR[1] = (GPIOA->AFR[1] & ~(0xFUL << ((pin - 8U) * 4U))) | (GPIO_AF1_TIM1 << ((pin - 8U) * 4U));
+		GPIOA->MODER = (GPIOA->MODER & ~(3UL << (pin * 2U))) | (2UL << (pin * 2U));
+	}
+}
+
+void Retain_RestorePwm(void)
+{
+	/* MX_TIM1_Init a remis les comparaisons à zéro et coupé MOE */
+	if (Retain_Warm && Retain_State.pwm) {
+		Retain_LoadPwm();
+	}
+}
+
+void Retain_RestoreSettings(void)
+{
+	if (Retain_Warm) {
+		Settings = Retain_State.settings;
+	}
+}
+
+void Retain_RestoreFrame(void)
+{
+	if (Retain_HaveFrame) {
+		Merge_Submit(MERGE_SRC_SHOW, Retain_Slots.slots, DMX_UNIVERSE_SIZE);
+	}
+}
+
+uint8_t Retain_GetLevels(uint16_t *rgb)
+{
+	if (!Retain_Warm || !Retain_State.pwm) {
+		return 0;
+	}
+	memcpy(rgb, Retain_State.level, sizeof(Retain_State.level));
+	return 1;
+}
+
+uint8_t Retain_IsWarm(void)
+{
+	return Retain_Warm;
+}
+
+uint32_t Retain_GetCause(void)
+{
+	return Retain_Cause;
+}
+
+uint32_t Retain_GetResets(void)
+{
+	return Retain_State.resets;
+}
+
+void Retain_Frame(const uint8_t *slots)
+{
+	memcpy(Retain_Slots.slots, slots, DMX_UNIVERSE_SIZE);
+	Retain_Seal(&Retain_Slots, sizeof(Retain_Slots));
+}
+
+void Retain_Process(void)
+{
+	Retain_State_t *s = &Retain_State;
+	uint8_t i;
+
+	if (HAL_GetTick() - Retain_Tick < RETAIN_SAVE_MS) {
+		return;
+	}
+	Retain_Tick = HAL_GetTick();
+
+	s->settings = Settings;
+	s->pwm = !Strip_IsActive();
+	memcpy(s->level, Output_GetLevels(), sizeof(s->level));
+	s->arr = TIM1->ARR;
+	for (i = 0; i < 4U; i++) {
+		s->ccr[i] = (&TIM1->CCR1)[i];
+	}
+	s->ccmr1 = TIM1->CCMR1;
+	s->ccmr2 = TIM1->CCMR2;
+	s->ccer = TIM1->CCER;
+	Retain_Seal(s, sizeof(*s));
+}
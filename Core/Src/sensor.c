@@ -0,0 +1,137 @@
+/**
+  ******************************************************************************
+  * @file    sensor.c
+  * @brief   Conversions injectées VREFINT et température, réduction PWM.
+  *
+  *          Aucune interruption : la fin de séquence injectée (JEOS) est
+  *          relevée par la boucle principale, qui tourne bien plus vite
+  *          que TIM15. TIM15 compte en permanence ; la synchronisation ne
+  *          fait qu'armer ou couper sa capture.
+  ******************************************************************************
+  */
+#include "sensor.h"
+#include "adc.h"
+#include "tim.h"
+#include "output.h"
+
+/**
+ * @brief  Point de la courbe de réduction
+ */
+typedef struct {
+	int16_t temp_dc;
+	uint32_t k;
+} Sensor_Point_t;
+
+static const Sensor_Point_t Sensor_Curve[] = {
+	{ SENSOR_DERATE_START_DC, 65536U },
+	{ SENSOR_DERATE_MID_DC, SENSOR_DERATE_MID },
+	{ SENSOR_DERATE_END_DC, SENSOR_DERATE_MIN }
+};
+
+#define SENSOR_POINTS           (sizeof(Sensor_Curve) / sizeof(Sensor_Curve[0]))
+
+static uint16_t Sensor_Vdda;
+static int16_t Sensor_Temp;
+static int32_t Sensor_TempAcc;      /* Température filtrée x SENSOR_FILTER */
+static uint8_t Sensor_Valid;
+static uint32_t Sensor_Derate;
+
+/* Facteur pour une température, interpolé entre les points de la courbe */
+static uint32_t Sensor_CurveAt(int16_t t)
+{
+	const Sensor_Point_t *a, *b;
+	uint8_t i;
+
+	if (t <= Sensor_Curve[0].temp_dc) {
+		return Sensor_Curve[0].k;
+	}
+	for (i = 1; i < SENSOR_POINTS; i++) {
+		a = &Sensor_Curve[i - 1U];
+		b = &Sensor_Curve[i];
+		if (t < b->temp_dc) {
+			return a->k - (uint32_t)(((int32_t)(a->k - b->k) * (t - a->temp_dc))
+					/ (b->temp_dc - a->temp_dc));
+		}
+	}
+	return Sensor_Curve[SENSOR_POINTS - 1U].k;
+}
+
+/* Température en dixièmes de degré, mesure ramenée à la VDDA d'étalonnage */
+static int16_t Sensor_Temperature(uint16_t raw, uint16_t vdda)
+{
+	int32_t ts = (int32_t)raw * vdda / TEMPSENSOR_CAL_VREFANALOG;
+	int32_t cal1 = *TEMPSENSOR_CAL1_ADDR;
+	int32_t cal2 = *TEMPSENSOR_CAL2_ADDR;
+
+	return (int16_t)((ts - cal1) * (TEMPSENSOR_CAL2_TEMP - TEMPSENSOR_CAL1_TEMP) * 10 / (cal2 - cal1)
+			+ TEMPSENSOR_CAL1_TEMP * 10);
+}
+
+void Sensor_Init(void)
+{
+	Sensor_Vdda = SENSOR_VDDA_DEFAULT_MV;
+	Sensor_Temp = 0;
+	Sensor_TempAcc = 0;
+	Sensor_Valid = 0;
+	Sensor_Derate = 65536U;
+
+	HAL_ADCEx_Calibration_Start(&hadc1, ADC_SINGLE_ENDED);
+	HAL_TIM_Base_Start(&htim15);
+	HAL_ADCEx_InjectedStart(&hadc1);
+}
+
+void Sensor_Process(void)
+{
+	uint16_t vref, ts;
+	int16_t t;
+	uint32_t k;
+
+	if (!__HAL_ADC_GET_FLAG(&hadc1, ADC_FLAG_JEOS)) {
+		return;
+	}
+	vref = (uint16_t)HAL_ADCEx_InjectedGetValue(&hadc1, ADC_INJECTED_RANK_1);
+	ts = (uint16_t)HAL_ADCEx_InjectedGetValue(&hadc1, ADC_INJECTED_RANK_2);
+	__HAL_ADC_CLEAR_FLAG(&hadc1, ADC_FLAG_JEOS | ADC_FLAG_JEOC);
+	if (vref == 0U) {
+		return;
+	}
+
+	Sensor_Vdda = (uint16_t)__HAL_ADC_CALC_VREFANALOG_VOLTAGE(vref, ADC_RESOLUTION_12B);
+	t = Sensor_Temperature(ts, Sensor_Vdda);
+	if (!Sensor_Valid) {
+		Sensor_TempAcc = (int32_t)t * SENSOR_FILTER;
+		Sensor_Valid = 1;
+	} else {
+		/* Accumulateur mis à l'échelle : pas d'écart résiduel dû à la troncature */
+		Sensor_TempAcc += t - Sensor_TempAcc / SENSOR_FILTER;
+	}
+	Sensor_Temp = (int16_t)(Sensor_TempAcc / SENSOR_FILTER);
+
+	/* Pas de retouche des sorties pour une variation infime */
+	k = Sensor_CurveAt(Sensor_Temp);
+	if (k != Sensor_Derate && (k == 65536U || k + SENSOR_DERATE_STEP <= Sensor_Derate
+			|| k >= Sensor_Derate + SENSOR_DERATE_STEP)) {
+		Sensor_Derate = k;
+		Output_SetLimit(k);
+	}
+}
+
+int16_t Sensor_GetTemperature(void)
+{
+	return Sensor_Temp;
+}
+
+uint16_t Sensor_GetVdda(void)
+{
+	return Sensor_Vdda;
+}
+
+uint16_t Sensor_ToMillivolts(uint16_t raw)
+{
+	return (uint16_t)__HAL_ADC_CALC_DATA_TO_VOLTAGE(Sensor_Vdda, raw, ADC_RESOLUTION_12B);
+}
+
+uint32_t Sensor_GetDerate(void)
+{
+	return Sensor_Derate;
+}
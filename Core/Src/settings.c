@@ -0,0 +1,158 @@
+/**
+  ******************************************************************************
+  * @file    settings.c
+  * @brief   Réglages de la carte et tables associées.
+  ******************************************************************************
+  */
+#include "settings.h"
+#include <stddef.h>
+#include <string.h>
+#include "sync.h"
+#include "config.h"
+
+/**
+ * @brief  Champ enregistré : clé, position et taille dans Settings_t
+ */
+typedef struct {
+	uint8_t key;            /*!< Valeur de @ref Config_Key_t */
+	uint8_t offset;
+	uint8_t size;
+	uint8_t count;          /*!< Nombre de valeurs de l'énumération, 0 : libre */
+} Settings_Field_t;
+
+Settings_t Settings;
+
+static const uint8_t Settings_Footprints[PERSONALITY_COUNT] = { 3, 6, 4 };
+
+static const Settings_Field_t Settings_Fields[] = {
+	{ CONFIG_KEY_DMX_ADDRESS, offsetof(Settings_t, dmx_address), 2, 0 },
+	{ CONFIG_KEY_PERSONALITY, offsetof(Settings_t, personality), 1, PERSONALITY_COUNT },
+	{ CONFIG_KEY_LOSS_POLICY, offsetof(Settings_t, loss_policy), 1, LOSS_COUNT },
+	{ CONFIG_KEY_CONTRAST, offsetof(Settings_t, contrast), 1, 0 },
+	{ CONFIG_KEY_EFFECT, offsetof(Settings_t, effect), 1, EFFECT_COUNT },
+	{ CONFIG_KEY_SYNC_MODE, offsetof(Settings_t, sync_mode), 1, SYNC_MODE_COUNT },
+	{ CONFIG_KEY_RX2_MODE, offsetof(Settings_t, rx2_mode), 1, RX2_COUNT },
+	{ CONFIG_KEY_MERGE_MODE, offsetof(Settings_t, merge_mode), 1, MERGE_COUNT },
+	{ CONFIG_KEY_OUTPUT_MODE, offsetof(Settings_t, output_mode), 1, OUTPUT_MODE_COUNT }
+};
+
+#define SETTINGS_FIELDS         (sizeof(Settings_Fields) / sizeof(Settings_Fields[0]))
+
+static const char * const Settings_PersonalityNames[PERSONALITY_COUNT] = {
+	"RGB 8b", "RGB 16b", "Dim+RGB"
+};
+
+static const char * const Settings_LossNames[LOSS_COUNT] = {
+	"Maintien", "Noir", "Fondu", "Autonome", "Rejeu"
+};
+
+static const char * const Settings_EffectNames[EFFECT_COUNT] = {
+	"Aucun", "Pulse", "Chenille", "Strobe", "Arc-ciel", "Son"
+};
+
+static const char * const Settings_SyncNames[SYNC_MODE_COUNT] = {
+	"Off", "Esclave", "Maitre"
+};
+
+static const char * const Settings_Rx2Names[RX2_COUNT] = {
+	"Synchro", "DMX B"
+};
+
+static const char * const Settings_MergeNames[MERGE_COUNT] = {
+	"HTP", "LTP", "Secours"
+};
+
+static const char * const Settings_OutputNames[OUTPUT_MODE_COUNT] = {
+	"PWM", "Decale", "Ruban"
+};
+
+void Settings_Init(void)
+{
+	const Settings_Field_t *f;
+	const uint8_t *v;
+	uint8_t len;
+	uint8_t i;
+
+	Settings.dmx_address = 1;
+	Settings.personality = PERSONALITY_RGB8;
+	Settings.loss_policy = LOSS_HOLD;
+	Settings.contrast = 0x7F;
+	Settings.effect = EFFECT_NONE;
+	Settings.sync_mode = SYNC_OFF;
+	Settings.rx2_mode = RX2_SYNC;
+	Settings.merge_mode = MERGE_HTP;
+	Settings.output_mode = OUTPUT_MODE_PWM;
+
+	/* Valeurs enregistrées, hors bornes ignorées */
+	for (i = 0; i < SETTINGS_FIELDS; i++) {
+		f = &Settings_Fields[i];
+		v = Config_Get(f->key, &len);
+		if (v == NULL || len != f->size || (f->count != 0U && v[0] >= f->count)) {
+			continue;
+		}
+		memcpy((uint8_t *)&Settings + f->offset, v, f->size);
+	}
+	if (Settings.dmx_address < 1U || Settings.dmx_address > Settings_MaxAddress()) {
+		Settings.dmx_address = 1;
+	}
+}
+
+void Settings_Save(void)
+{
+	const Settings_Field_t *f;
+	uint8_t i;
+
+	for (i = 0; i < SETTINGS_FIELDS; i++) {
+		f = &Settings_Fields[i];
+		/* Champ inchangé : rien n'est programmé */
+		Config_Set(f->key, (const uint8_t *)&Settings + f->offset, f->size);
+	}
+}
+
+uint8_t Settings_Footprint(uint8_t personality)
+{
+	if (personality >= PERSONALITY_COUNT) {
+		return 0;
+	}
+	return Settings_Footprints[personality];
+}
+
+uint16_t Settings_MaxAddress(void)
+{
+	return DMX_UNIVERSE_SIZE + 1U - Settings_Footprint(Settings.personality);
+}
+
+const char *Settings_PersonalityName(uint8_t personality)
+{
+	return (personality < PERSONALITY_COUNT) ? Settings_PersonalityNames[personality] : "?";
+}
+
+const char *Settings_LossName(uint8_t policy)
+{
+	return (policy < LOSS_COUNT) ? Settings_LossNames[policy] : "?";
+}
+
+const char *Settings_EffectName(uint8_t effect)
+{
+	return (effect < EFFECT_COUNT) ? Settings_EffectNames[effect] : "?";
+}
+
+const char *Settings_SyncName(uint8_t mode)
+{
+	return (mode < SYNC_MODE_COUNT) ? Settings_SyncNames[mode] : "?";
+}
+
+const char *Settings_Rx2Name(uint8_t mode)
+{
+	return (mode < RX2_COUNT) ? Settings_Rx2Names[mode] : "?";
+}
+
+const char *Settings_MergeName(uint8_t mode)
+{
+	return (mode < MERGE_COUNT) ? Settings_MergeNames[mode] : "?";
+}
+
+const char *Settings_OutputName(uint8_t mode)
+{
+	return (mode < OUTPUT_MODE_COUNT) ? Settings_OutputNames[mode] : "?";
+}
@@ -0,0 +1,120 @@
+/**
+  ******************************************************************************
+  * @file    show.c
+  * @brief   Ecriture en flux du spectacle.
+  *
+  *          Chaque page est effacée quand l'écriture l'atteint : un fichier
+  *          reçu par morceaux est programmé au fil de l'eau, sans copie en
+  *          RAM. Le premier double-mot (l'en-tête) est gardé de côté et
+  *          programmé une fois la taille annoncée atteinte.
+  *
+  *          Un enregistrement en direct (record.c) ne connaît sa taille
+  *          qu'à la fin : il efface tout d'avance (Show_Erase) pour ne pas
+  *          bloquer 22 ms en cours de route, et fixe la taille réelle avec
+  *          Show_WriteEnd.
+  ******************************************************************************
+  */
+#include "show.h"
+#include <string.h>
+#include "flash.h"
+
+static uint32_t Show_Length;        /* Taille annoncée, 0 hors écriture */
+static uint32_t Show_Written;       /* Octets programmés (ou sautés) */
+static uint32_t Show_Erased;        /* Octets effacés depuis le début */
+static uint64_t Show_Header;
+
+uint8_t Show_IsValid(const Show_Header_t *h)
+{
+	return h->magic == SHOW_MAGIC && h->length >= sizeof(Show_Header_t) && h->length <= SHOW_SIZE;
+}
+
+const Show_Header_t *Show_Get(void)
+{
+	const Show_Header_t *h = (const Show_Header_t *)SHOW_BASE;
+
+	return Show_IsValid(h) ? h : NULL;
+}
+
+void Show_WriteBegin(uint32_t length)
+{
+	Show_Length = (length > SHOW_SIZE) ? SHOW_SIZE : length;
+	Show_Written = 0;
+	Show_Erased = 0;
+	Show_Header = UINT64_MAX;
+}
+
+uint8_t Show_Write(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+	uint32_t skip;
+	uint32_t end = (Show_Length + FLASH_DWORD_SIZE - 1U) & ~(FLASH_DWORD_SIZE - 1U);
+
+	if (Show_Length == 0U || offset >= end || offset + len <= Show_Written) {
+		return SHOW_WRITE_PENDING;
+	}
+	if (offset > Show_Written) {
+		/* Trou : il ne serait jamais comblé, l'en-tête scellerait un fichier incomplet */
+		Show_Length = 0;
+		return SHOW_WRITE_ERROR;
+	}
+	if (offset < Show_Written) {
+		/* Recouvrement : seule la partie nouvelle est programmée */
+		skip = Show_Written - offset;
+		offset += skip;
+		data += skip;
+		len -= skip;
+	}
+	if (offset + len > end) {
+		len = end - offset;
+	}
+	while (Show_Erased < offset + len) {
+		if (Flash_ErasePage(SHOW_BASE + Show_Erased) != HAL_OK) {
+			Show_Length = 0;
+			return SHOW_WRITE_ERROR;
+		}
+		Show_Erased += FLASH_PAGE_SIZE;
+	}
+	if (offset == 0U && len >= sizeof(Show_Header)) {
+		memcpy(&Show_Header, data, sizeof(Show_Header));
+		offset += sizeof(Show_Header);
+		data += sizeof(Show_Header);
+		len -= sizeof(Show_Header);
+	}
+	if (Flash_Program(SHOW_BASE + offset, data, len) != HAL_OK) {
+		Show_Length = 0;
+		return SHOW_WRITE_ERROR;
+	}
+	Show_Written = offset + len;
+
+	if (Show_Written < Show_Length) {
+		return SHOW_WRITE_PENDING;
+	}
+	Show_Length = 0;
+	if (Flash_Program(SHOW_BASE, &Show_Header, sizeof(Show_Header)) != HAL_OK) {
+		return SHOW_WRITE_ERROR;
+	}
+	return SHOW_WRITE_DONE;
+}
+
+void Show_Erase(void)
+{
+	while (Show_Length != 0U && Show_Erased < Show_Length) {
+		if (Flash_ErasePage(SHOW_BASE + Show_Erased) != HAL_OK) {
+			/* Page reprise par Show_Write, qui signale l'échec */
+			return;
+		}
+		Show_Erased += FLASH_PAGE_SIZE;
+	}
+}
+
+uint8_t Show_WriteEnd(uint32_t length)
+{
+	Show_Header_t h;
+
+	if (Show_Length == 0U || length < sizeof(h) || length > Show_Written) {
+		return 0;
+	}
+	memcpy(&h, &Show_Header, sizeof(h));
+	h.length = length;
+	Show_Length = 0;
+	return Flash_Program(SHOW_BASE, &h, sizeof(h)) == HAL_OK;
+}
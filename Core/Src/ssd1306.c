@@ -228,18 +228,51 @@ uint8_t SSD1306_Init(void) {
 }
 
 void SSD1306_UpdateScreen(void) {
-	uint8_t m;
+	SSD1306_UpdateArea(0, 0, SSD1306_WIDTH, SSD1306_HEIGHT);
+}
+
+void SSD1306_UpdateArea(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+	uint8_t cmd[3];
+	uint8_t m, first, last;
 	
-	for (m = 0; m < 8; m++) {
-		SSD1306_WRITECOMMAND(0xB0 + m);
-		SSD1306_WRITECOMMAND(0x00);
-		SSD1306_WRITECOMMAND(0x10);
+	/* Check input parameters */
+	if (
+		x >= SSD1306_WIDTH ||
+		y >= SSD1306_HEIGHT ||
+		w == 0 || h == 0
+	) {
+		return;
+	}
+	if ((x + w) > SSD1306_WIDTH) {
+		w = SSD1306_WIDTH - x;
+	}
+	if ((y + h) > SSD1306_HEIGHT) {
+		h = SSD1306_HEIGHT - y;
+	}
+	
+	first = y / 8;
+	last = (y + h - 1) / 8;
+	
+	for (m = first; m <= last; m++) {
+		/* Page and start column in one transfer */
+		cmd[0] = 0xB0 + m;
+		cmd[1] = 0x00 | (x & 0x0F);
+		cmd[2] = 0x10 | (x >> 4);
+		ssd1306_I2C_WriteMulti(SSD1306_I2C_ADDR, 0x00, cmd, 3);
 		
 		/* Write multi data */
-		ssd1306_I2C_WriteMulti(SSD1306_I2C_ADDR, 0x40, &SSD1306_Buffer[SSD1306_WIDTH * m], SSD1306_WIDTH);
+		ssd1306_I2C_WriteMulti(SSD1306_I2C_ADDR, 0x40, &SSD1306_Buffer[SSD1306_WIDTH * m + x], w);
 	}
 }
 
+void SSD1306_SetContrast(uint8_t value) {
+	uint8_t cmd[2];
+	
+	cmd[0] = 0x81;
+	cmd[1] = value;
+	ssd1306_I2C_WriteMulti(SSD1306_I2C_ADDR, 0x00, cmd, 2);
+}
+
 void SSD1306_ToggleInvert(void) {
 	uint16_t i;
 	
@@ -22,7 +22,19 @@
 #include "stm32l4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "buttons.h"
+#include "tempo.h"
+#include "effects.h"
+#include "sync.h"
+#include "dmx.h"
+#include "strip.h"
+#include "host.h"
+#include "cue.h"
+#include "fault.h"
+#include "watchdog.h"
+#include "power.h"
+#include "audio.h"
+#include "latency.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -38,27 +50,63 @@
 /* Private macro -------------------------------------------------------------*/
 /* USER CODE BEGIN PM */
 
+#if ISR_PROFILE
+#define ISR_ENTER()             (Isr_Entry = DWT->CYCCNT)
+#define ISR_WORK(id)            (Isr_Cycles[(id)] = DWT->CYCCNT - Isr_Entry)
+#else
+#define ISR_ENTER()             ((void)0)
+#define ISR_WORK(id)            ((void)0)
+#endif
+
 /* USER CODE END PM */
 
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN PV */
 
+#if ISR_PROFILE
+volatile uint32_t Isr_Cycles[ISR_PROF_COUNT];
+static uint32_t Isr_Entry;
+#endif
+
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN PFP */
 
+/* Défauts sans prologue : le cadre empilé est au sommet de la pile (fault.h) */
+void NMI_Handler(void) __attribute__((naked));
+void HardFault_Handler(void) __attribute__((naked));
+void MemManage_Handler(void) __attribute__((naked));
+void BusFault_Handler(void) __attribute__((naked));
+void UsageFault_Handler(void) __attribute__((naked));
+
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
 
+/* Cadence du tempo : mise à jour de TIM1, ou moitié du DMA en mode ruban */
+static void TIM1_Tick(void)
+{
+  Tempo_Update_Callback();
+  Sync_Update_Callback(Tempo_GetBeats());
+  Effects_Update(Tempo_GetPhase(), Tempo_GetBeats());
+  Cue_Update();
+  Watchdog_Tick();
+  Latency_Tick();
+}
+
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
 extern PCD_HandleTypeDef hpcd_USB_FS;
+extern DMA_HandleTypeDef hdma_adc1;
 extern I2C_HandleTypeDef hi2c3;
+extern DMA_HandleTypeDef hdma_tim1_ch1;
+extern TIM_HandleTypeDef htim1;
 extern TIM_HandleTypeDef htim2;
+extern TIM_HandleTypeDef htim15;
+extern DMA_HandleTypeDef hdma_usart1_rx;
 extern UART_HandleTypeDef huart1;
 /* USER CODE BEGIN EV */
 
@@ -73,7 +121,7 @@ extern UART_HandleTypeDef huart1;
 void NMI_Handler(void)
 {
   /* USER CODE BEGIN NonMaskableInt_IRQn 0 */
-
+  FAULT_ENTRY();
   /* USER CODE END NonMaskableInt_IRQn 0 */
   /* USER CODE BEGIN NonMaskableInt_IRQn 1 */
    while (1)
@@ -88,7 +136,7 @@ void NMI_Handler(void)
 void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-
+  FAULT_ENTRY();
   /* USER CODE END HardFault_IRQn 0 */
   while (1)
   {
@@ -103,7 +151,7 @@ void HardFault_Handler(void)
 void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+  FAULT_ENTRY();
   /* USER CODE END MemoryManagement_IRQn 0 */
   while (1)
   {
@@ -118,7 +166,7 @@ void MemManage_Handler(void)
 void BusFault_Handler(void)
 {
   /* USER CODE BEGIN BusFault_IRQn 0 */
-
+  FAULT_ENTRY();
   /* USER CODE END BusFault_IRQn 0 */
   while (1)
   {
@@ -133,7 +181,7 @@ void BusFault_Handler(void)
 void UsageFault_Handler(void)
 {
   /* USER CODE BEGIN UsageFault_IRQn 0 */
-
+  FAULT_ENTRY();
   /* USER CODE END UsageFault_IRQn 0 */
   while (1)
   {
@@ -202,13 +250,201 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32l4xx.s).                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles EXTI line0 interrupt.
+  */
+void EXTI0_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI0_IRQn 0 */
+
+  /* USER CODE END EXTI0_IRQn 0 */
+  HAL_GPIO_EXTI_IRQHandler(SW1_Pin);
+  /* USER CODE BEGIN EXTI0_IRQn 1 */
+
+  /* USER CODE END EXTI0_IRQn 1 */
+}
+
+/**
+  * @brief This function handles EXTI line1 interrupt.
+  */
+void EXTI1_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI1_IRQn 0 */
+
+  /* USER CODE END EXTI1_IRQn 0 */
+  HAL_GPIO_EXTI_IRQHandler(SW2_Pin);
+  /* USER CODE BEGIN EXTI1_IRQn 1 */
+
+  /* USER CODE END EXTI1_IRQn 1 */
+}
+
+/**
+  * @brief This function handles EXTI line3 interrupt.
+  */
+void EXTI3_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI3_IRQn 0 */
+
+  /* USER CODE END EXTI3_IRQn 0 */
+  HAL_GPIO_EXTI_IRQHandler(SW3_Pin);
+  /* USER CODE BEGIN EXTI3_IRQn 1 */
+
+  /* USER CODE END EXTI3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 channel1 global interrupt.
+  */
+void DMA1_Channel1_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Channel1_IRQn 0 */
+  ISR_ENTER();
+#if ISR_FAST_PATH
+  /* Echantillons audio : moitié prête, erreurs laissées à la HAL */
+  uint32_t isr = DMA1->ISR;
+
+  if (!(isr & DMA_ISR_TEIF1))
+  {
+    DMA1->IFCR = isr & (DMA_IFCR_CHTIF1 | DMA_IFCR_CTCIF1 | DMA_IFCR_CGIF1);
+    ISR_WORK(ISR_PROF_AUDIO);
+    if (isr & DMA_ISR_HTIF1)
+    {
+      Audio_DMA_Callback(0);
+    }
+    if (isr & DMA_ISR_TCIF1)
+    {
+      Audio_DMA_Callback(1);
+    }
+    return;
+  }
+#endif
+  /* USER CODE END DMA1_Channel1_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_adc1);
+  /* USER CODE BEGIN DMA1_Channel1_IRQn 1 */
+
+  /* USER CODE END DMA1_Channel1_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 channel2 global interrupt.
+  */
+void DMA1_Channel2_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Channel2_IRQn 0 */
+  ISR_ENTER();
+#if ISR_FAST_PATH
+  /* Ruban : les deux moitiés du tampon circulaire, erreurs laissées à la HAL */
+  uint32_t isr = DMA1->ISR;
+
+  if (!(isr & DMA_ISR_TEIF2))
+  {
+    DMA1->IFCR = isr & (DMA_IFCR_CHTIF2 | DMA_IFCR_CTCIF2 | DMA_IFCR_CGIF2);
+    if (isr & DMA_ISR_HTIF2)
+    {
+      ISR_WORK(ISR_PROF_STRIP);
+      Strip_DMA_Callback(0);
+      TIM1_Tick();
+    }
+    if (isr & DMA_ISR_TCIF2)
+    {
+      ISR_WORK(ISR_PROF_STRIP);
+      Strip_DMA_Callback(1);
+      TIM1_Tick();
+    }
+    return;
+  }
+#endif
+  /* USER CODE END DMA1_Channel2_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_tim1_ch1);
+  /* USER CODE BEGIN DMA1_Channel2_IRQn 1 */
+
+  /* USER CODE END DMA1_Channel2_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 channel5 global interrupt.
+  */
+void DMA1_Channel5_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Channel5_IRQn 0 */
+  ISR_ENTER();
+#if ISR_FAST_PATH
+  ISR_WORK(ISR_PROF_DMX_HALF);
+  Dmx_DMA_IRQHandler(DMX_LINE_A);
+  return;
+#endif
+  /* USER CODE END DMA1_Channel5_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_usart1_rx);
+  /* USER CODE BEGIN DMA1_Channel5_IRQn 1 */
+
+  /* USER CODE END DMA1_Channel5_IRQn 1 */
+}
+
+/**
+  * @brief This function handles TIM1 break interrupt and TIM15 global interrupt.
+  */
+void TIM1_BRK_TIM15_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM1_BRK_TIM15_IRQn 0 */
+
+  /* USER CODE END TIM1_BRK_TIM15_IRQn 0 */
+  HAL_TIM_IRQHandler(&htim15);
+  /* USER CODE BEGIN TIM1_BRK_TIM15_IRQn 1 */
+
+  /* USER CODE END TIM1_BRK_TIM15_IRQn 1 */
+}
+
+/**
+  * @brief This function handles TIM1 update interrupt and TIM16 global interrupt.
+  */
+void TIM1_UP_TIM16_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM1_UP_TIM16_IRQn 0 */
+  ISR_ENTER();
+#if ISR_FAST_PATH
+  /* Seule source : la mise à jour de TIM1 (TIM16 inutilisé) */
+  if ((TIM1->SR & TIM_SR_UIF) && (TIM1->DIER & TIM_DIER_UIE))
+  {
+    TIM1->SR = ~TIM_SR_UIF;
+    ISR_WORK(ISR_PROF_TIM1);
+    TIM1_Tick();
+  }
+  return;
+#endif
+  /* USER CODE END TIM1_UP_TIM16_IRQn 0 */
+  HAL_TIM_IRQHandler(&htim1);
+  /* USER CODE BEGIN TIM1_UP_TIM16_IRQn 1 */
+
+  /* USER CODE END TIM1_UP_TIM16_IRQn 1 */
+}
+
 /**
   * @brief This function handles TIM2 global interrupt.
   */
 void TIM2_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM2_IRQn 0 */
+  ISR_ENTER();
+#if ISR_FAST_PATH
+  /* Alarme des boutons (CH1) et cues (CH2) ; toute autre source passe par la HAL */
+  uint32_t sr = TIM2->SR & TIM2->DIER;
 
+  if (sr != 0U && (sr & ~(TIM_SR_CC1IF | TIM_SR_CC2IF)) == 0U)
+  {
+    TIM2->SR = ~sr;
+    if (sr & TIM_SR_CC2IF)
+    {
+      ISR_WORK(ISR_PROF_CUE);
+      Cue_Timer_Callback();
+    }
+    if (sr & TIM_SR_CC1IF)
+    {
+      ISR_WORK(ISR_PROF_TIM2);
+      Buttons_Timer_Callback();
+    }
+    return;
+  }
+#endif
   /* USER CODE END TIM2_IRQn 0 */
   HAL_TIM_IRQHandler(&htim2);
   /* USER CODE BEGIN TIM2_IRQn 1 */
@@ -222,7 +458,12 @@ void TIM2_IRQHandler(void)
 void USART1_IRQHandler(void)
 {
   /* USER CODE BEGIN USART1_IRQn 0 */
-
+  ISR_ENTER();
+#if ISR_FAST_PATH
+  ISR_WORK(ISR_PROF_DMX_BREAK);
+  Dmx_UART_IRQHandler(DMX_LINE_A);
+  return;
+#endif
   /* USER CODE END USART1_IRQn 0 */
   HAL_UART_IRQHandler(&huart1);
   /* USER CODE BEGIN USART1_IRQn 1 */
@@ -236,7 +477,17 @@ void USART1_IRQHandler(void)
 void USB_IRQHandler(void)
 {
   /* USER CODE BEGIN USB_IRQn 0 */
-
+  /* SOF traité avant la pile USB : latence minimale sur TIM1 */
+  if (USB->ISTR & USB_ISTR_SOF)
+  {
+    Host_SOF();
+    Watchdog_Checkin(WATCHDOG_TASK_USB);
+  }
+  /* Bus suspendu ou câble retiré : plus de SOF à attendre */
+  if (USB->ISTR & USB_ISTR_SUSP)
+  {
+    Watchdog_Pause(WATCHDOG_TASK_USB);
+  }
   /* USER CODE END USB_IRQn 0 */
   HAL_PCD_IRQHandler(&hpcd_USB_FS);
   /* USER CODE BEGIN USB_IRQn 1 */
@@ -260,6 +511,51 @@ void I2C3_EV_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief  Interruption LPTIM1 (réveil périodique en Stop, power.c)
+  */
+void LPTIM1_IRQHandler(void)
+{
+  Power_Timer_Callback();
+}
+
+/**
+  * @brief  Interruption USART2 (ligne DMX B sur PA3, configurée par dmx.c)
+  */
+void USART2_IRQHandler(void)
+{
+#if ISR_FAST_PATH
+  Dmx_UART_IRQHandler(DMX_LINE_B);
+#else
+  HAL_UART_IRQHandler(&huart2);
+#endif
+}
+
+/**
+  * @brief  Interruption DMA1 canal 6 (réception USART2)
+  */
+void DMA1_Channel6_IRQHandler(void)
+{
+#if ISR_FAST_PATH
+  Dmx_DMA_IRQHandler(DMX_LINE_B);
+#else
+  HAL_DMA_IRQHandler(&hdma_usart2_rx);
+#endif
+}
+
+/**
+  * @brief  Moitiés du tampon d'échantillons audio (chemin HAL)
+  */
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  Audio_DMA_Callback(0);
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  Audio_DMA_Callback(1);
+}
+
 /**
   * @brief  Callback appelé quand une erreur de réception UART se produit
   * @param  huart: pointeur vers le handle UART
@@ -268,7 +564,19 @@ void I2C3_EV_IRQHandler(void)
   */
 void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
 {
+  ISR_WORK(ISR_PROF_DMX_BREAK);
+  Dmx_UART_ErrorCallback(huart);
+}
 
+/**
+  * @brief  Callback appelé à la moitié d'une réception UART par DMA
+  * @param  huart: pointeur vers le handle UART
+  * @retval None
+  */
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart)
+{
+  ISR_WORK(ISR_PROF_DMX_HALF);
+  Dmx_UART_RxHalfCpltCallback(huart);
 }
 
 /**
@@ -278,7 +586,99 @@ void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
   */
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 {
+  Dmx_UART_RxCpltCallback(huart);
+}
 
+/**
+  * @brief  Callback appelé sur un front d'un bouton (EXTI)
+  * @param  GPIO_Pin: broche ayant déclenché l'interruption
+  * @retval None
+  */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  Buttons_EXTI_Callback(GPIO_Pin);
+}
+
+/**
+  * @brief  Callback appelé quand une échéance de comparaison TIM expire
+  * @param  htim: pointeur vers le handle TIM
+  * @retval None
+  * @note   TIM2 CH1 sert d'alarme au moteur de boutons (anti-rebond, appui long),
+  *         TIM2 CH2 déclenche les cues de la conduite
+  */
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM2 && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_1)
+  {
+    ISR_WORK(ISR_PROF_TIM2);
+    Buttons_Timer_Callback();
+  }
+  else if (htim->Instance == TIM2 && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_2)
+  {
+    ISR_WORK(ISR_PROF_CUE);
+    Cue_Timer_Callback();
+  }
+}
+
+/**
+  * @brief  Callback appelé à chaque mise à jour d'un timer
+  * @param  htim: pointeur vers le handle TIM
+  * @retval None
+  * @note   La mise à jour de TIM1 (fin de période PWM) cadence l'accumulateur
+  *         de phase du tempo et le calcul des effets
+  */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM1)
+  {
+    ISR_WORK(ISR_PROF_TIM1);
+    TIM1_Tick();
+  }
+}
+
+/**
+  * @brief  Callback appelé quand le DMA de TIM1 CH1 a lu la première moitié
+  * @param  htim: pointeur vers le handle TIM
+  * @retval None
+  * @note   Mode ruban : la moitié libérée est réencodée
+  */
+void HAL_TIM_PWM_PulseFinishedHalfCpltCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM1)
+  {
+    ISR_WORK(ISR_PROF_STRIP);
+    Strip_DMA_Callback(0);
+    TIM1_Tick();
+  }
+}
+
+/**
+  * @brief  Callback appelé quand le DMA de TIM1 CH1 a lu la seconde moitié
+  * @param  htim: pointeur vers le handle TIM
+  * @retval None
+  */
+void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM1)
+  {
+    ISR_WORK(ISR_PROF_STRIP);
+    Strip_DMA_Callback(1);
+    TIM1_Tick();
+  }
+}
+
+/**
+  * @brief  Callback appelé sur une capture d'entrée TIM
+  * @param  htim: pointeur vers le handle TIM
+  * @retval None
+  * @note   TIM15 CH2 (PA3) reçoit les impulsions de synchronisation
+  */
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM15 && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_2)
+  {
+    Sync_Capture_Callback();
+  }
 }
 
 /* USER CODE END 1 */
@@ -0,0 +1,289 @@
+/**
+  ******************************************************************************
+  * @file    strip.c
+  * @brief   Ruban de LED adressables par DMA sur TIM1 CH1.
+  *
+  *          Chaque bit est une période de TIM1 dont le rapport cyclique est
+  *          chargé par le DMA dans CCR1 (préchargé, appliqué à la mise à
+  *          jour suivante). Une moitié du tampon DMA contient
+  *          STRIP_CHUNK_PIXELS pixels : elle est réencodée pendant que le DMA
+  *          lit l'autre, soit une interruption toutes les 240 us pendant
+  *          l'envoi d'une image (170 pixels en 5,6 ms, verrouillage compris).
+  *          Ruban au repos, les moitiés restent à zéro et les interruptions
+  *          ne font que cadencer le tempo.
+  *
+  *          L'encodage passe par une table de quartets (4 bits -> 4
+  *          demi-mots) et remet les octets dans l'ordre G, R, B du ruban.
+  *          Les niveaux DMX sont envoyés tels quels : la réponse des
+  *          pilotes de LED est déjà linéaire.
+  ******************************************************************************
+  */
+#include "strip.h"
+#include <string.h>
+#include "tim.h"
+#include "tempo.h"
+
+typedef enum {
+	STRIP_REQ_NONE = 0,
+	STRIP_REQ_PIXELS,           /* Nouvelle image dans le tampon arrière */
+	STRIP_REQ_FILL,             /* Couleur unie */
+	STRIP_REQ_REFRESH           /* Même image, atténuation modifiée */
+} Strip_Request_t;
+
+typedef enum {
+	STRIP_IDLE = 0,
+	STRIP_DATA,
+	STRIP_RESET
+} Strip_State_t;
+
+static uint16_t Strip_Dma[2][STRIP_CHUNK_BITS] __attribute__((aligned(4)));
+static uint32_t Strip_Lut[16][2];
+static uint8_t Strip_Zero[2];
+
+static uint8_t Strip_Buf[2][STRIP_PIXELS * 3U];
+static uint8_t Strip_Front;
+static volatile uint8_t Strip_Request;
+static volatile uint32_t Strip_Color;   /* 0x00RRGGBB */
+static volatile uint16_t Strip_Scale;   /* 0..256 */
+static volatile uint8_t Strip_Active;
+
+/* Image en cours d'envoi */
+static uint8_t Strip_State;
+static uint16_t Strip_Pixel;
+static uint8_t Strip_ResetLeft;
+static uint8_t Strip_FrameFill;
+static uint32_t Strip_FrameColor;
+static uint16_t Strip_FrameScale;
+
+static void Strip_Encode(uint32_t *dst, uint8_t v)
+{
+	dst[0] = Strip_Lut[v >> 4][0];
+	dst[1] = Strip_Lut[v >> 4][1];
+	dst[2] = Strip_Lut[v & 0x0FU][0];
+	dst[3] = Strip_Lut[v & 0x0FU][1];
+}
+
+static void Strip_Clear(uint8_t half)
+{
+	if (!Strip_Zero[half]) {
+		memset(Strip_Dma[half], 0, sizeof(Strip_Dma[0]));
+		Strip_Zero[half] = 1;
+	}
+}
+
+static void Strip_EncodeChunk(uint8_t half)
+{
+	uint32_t *dst = (uint32_t *)Strip_Dma[half];
+	const uint8_t *src = &Strip_Buf[Strip_Front][Strip_Pixel * 3U];
+	uint16_t n = STRIP_PIXELS - Strip_Pixel;
+	uint8_t r, g, b;
+	uint16_t i;
+
+	if (n > STRIP_CHUNK_PIXELS) {
+		n = STRIP_CHUNK_PIXELS;
+	}
+	for (i = 0; i < n; i++, src += 3) {
+		if (Strip_FrameFill) {
+			r = (uint8_t)(Strip_FrameColor >> 16);
+			g = (uint8_t)(Strip_FrameColor >> 8);
+			b = (uint8_t)Strip_FrameColor;
+		} else {
+			r = src[0];
+			g = src[1];
+			b = src[2];
+		}
+		if (Strip_FrameScale < 256U) {
+			r = (uint8_t)((r * Strip_FrameScale) >> 8);
+			g = (uint8_t)((g * Strip_FrameScale) >> 8);
+			b = (uint8_t)((b * Strip_FrameScale) >> 8);
+		}
+		Strip_Encode(dst, g);
+		Strip_Encode(dst + 4, r);
+		Strip_Encode(dst + 8, b);
+		dst += 12;
+	}
+	if (n < STRIP_CHUNK_PIXELS) {
+		memset(dst, 0, (STRIP_CHUNK_PIXELS - n) * 24U * sizeof(uint16_t));
+	}
+	Strip_Zero[half] = 0;
+	Strip_Pixel += n;
+}
+
+/* Prise en compte de la dernière demande au début d'une image */
+static void Strip_BeginFrame(void)
+{
+	switch (Strip_Request) {
+	case STRIP_REQ_PIXELS:
+		Strip_Front ^= 1U;
+		Strip_FrameFill = 0;
+		break;
+
+	case STRIP_REQ_FILL:
+		Strip_FrameFill = 1;
+		Strip_FrameColor = Strip_Color;
+		break;
+
+	case STRIP_REQ_REFRESH:
+	default:
+		break;
+	}
+	Strip_Request = STRIP_REQ_NONE;
+	/* L'atténuation ne concerne que les images DMX */
+	Strip_FrameScale = Strip_FrameFill ? 256U : Strip_Scale;
+	Strip_Pixel = 0;
+	Strip_State = STRIP_DATA;
+}
+
+void Strip_Init(void)
+{
+	uint16_t t[4];
+	uint8_t n, i;
+
+	for (n = 0; n < 16U; n++) {
+		for (i = 0; i < 4U; i++) {
+			t[i] = (n & (0x08U >> i)) ? STRIP_T1H : STRIP_T0H;
+		}
+		/* Petit boutiste : le premier bit émis dans le demi-mot bas */
+		Strip_Lut[n][0] = t[0] | ((uint32_t)t[1] << 16);
+		Strip_Lut[n][1] = t[2] | ((uint32_t)t[3] << 16);
+	}
+	memset(Strip_Buf, 0, sizeof(Strip_Buf));
+	Strip_Front = 0;
+	Strip_Request = STRIP_REQ_NONE;
+	Strip_Color = 0;
+	Strip_Scale = 256;
+	Strip_FrameFill = 1;
+	Strip_FrameColor = 0;
+	Strip_Active = 0;
+}
+
+void Strip_Start(void)
+{
+	if (Strip_Active) {
+		return;
+	}
+	/* 800 kHz : la mise à jour de TIM1 ne peut plus cadencer le tempo */
+	__HAL_TIM_DISABLE_IT(&htim1, TIM_IT_UPDATE);
+	HAL_TIM_PWM_Stop(&htim1, TIM_CHANNEL_1);
+	__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, 0);
+	__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_2, 0);
+	__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_3, 0);
+	__HAL_TIM_SET_AUTORELOAD(&htim1, STRIP_BIT_PERIOD - 1U);
+	__HAL_TIM_SET_COUNTER(&htim1, 0);
+	htim1.Instance->EGR = TIM_EGR_UG;
+
+	memset(Strip_Dma, 0, sizeof(Strip_Dma));
+	Strip_Zero[0] = Strip_Zero[1] = 1;
+	Strip_State = STRIP_IDLE;
+	if (Strip_Request == STRIP_REQ_NONE) {
+		/* Première image : l'état courant du ruban est inconnu */
+		Strip_Request = STRIP_REQ_REFRESH;
+	}
+	Tempo_SetTickPeriods(STRIP_CHUNK_BITS);
+	Strip_Active = 1;
+
+	if (HAL_TIM_PWM_Start_DMA(&htim1, TIM_CHANNEL_1, (const uint32_t *)Strip_Dma, 2U * STRIP_CHUNK_BITS) != HAL_OK) {
+		Error_Handler();
+	}
+}
+
+void Strip_Stop(void)
+{
+	if (!Strip_Active) {
+		return;
+	}
+	Strip_Active = 0;
+	HAL_TIM_PWM_Stop_DMA(&htim1, TIM_CHANNEL_1);
+	__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_1, 0);
+	__HAL_TIM_SET_AUTORELOAD(&htim1, htim1.Init.Period);
+	__HAL_TIM_SET_COUNTER(&htim1, 0);
+	htim1.Instance->EGR = TIM_EGR_UG;
+	HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_1);
+
+	Tempo_SetTickPeriods(1);
+	__HAL_TIM_CLEAR_FLAG(&htim1, TIM_FLAG_UPDATE);
+	__HAL_TIM_ENABLE_IT(&htim1, TIM_IT_UPDATE);
+}
+
+uint8_t Strip_IsActive(void)
+{
+	return Strip_Active;
+}
+
+uint8_t Strip_SetPixels(const uint8_t *rgb, uint16_t count)
+{
+	uint8_t *back;
+
+	if (Strip_Request == STRIP_REQ_PIXELS) {
+		/* Tampon arrière pas encore basculé */
+		return 0;
+	}
+	if (count > STRIP_PIXELS) {
+		count = STRIP_PIXELS;
+	}
+	back = Strip_Buf[Strip_Front ^ 1U];
+	memcpy(back, rgb, count * 3U);
+	memset(&back[count * 3U], 0, (STRIP_PIXELS - count) * 3U);
+	Strip_Request = STRIP_REQ_PIXELS;
+	return 1;
+}
+
+void Strip_Fill(uint8_t r, uint8_t g, uint8_t b)
+{
+	uint32_t color = ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+
+	if (Strip_Request == STRIP_REQ_FILL && color == Strip_Color) {
+		return;
+	}
+	if (Strip_Request == STRIP_REQ_NONE && Strip_FrameFill && color == Strip_FrameColor) {
+		/* Déjà affichée */
+		return;
+	}
+	Strip_Color = color;
+	Strip_Request = STRIP_REQ_FILL;
+}
+
+void Strip_SetScale(uint32_t k)
+{
+	uint16_t scale = (uint16_t)((k > 65536U ? 65536U : k) >> 8);
+
+	if (scale == Strip_Scale) {
+		return;
+	}
+	Strip_Scale = scale;
+	if (Strip_Request == STRIP_REQ_NONE) {
+		Strip_Request = STRIP_REQ_REFRESH;
+	}
+}
+
+void Strip_DMA_Callback(uint8_t half)
+{
+	if (!Strip_Active) {
+		return;
+	}
+	if (Strip_State == STRIP_IDLE && Strip_Request != STRIP_REQ_NONE) {
+		Strip_BeginFrame();
+	}
+
+	switch (Strip_State) {
+	case STRIP_DATA:
+		Strip_EncodeChunk(half);
+		if (Strip_Pixel >= STRIP_PIXELS) {
+			Strip_State = STRIP_RESET;
+			Strip_ResetLeft = STRIP_RESET_CHUNKS;
+		}
+		break;
+
+	case STRIP_RESET:
+		Strip_Clear(half);
+		if (--Strip_ResetLeft == 0U) {
+			Strip_State = STRIP_IDLE;
+		}
+		break;
+
+	case STRIP_IDLE:
+	default:
+		Strip_Clear(half);
+		break;
+	}
+}
@@ -0,0 +1,181 @@
+/**
+  ******************************************************************************
+  * @file    sync.c
+  * @brief   Synchronisation multi-cartes sur PA3 (RX2).
+  *
+  *          Le front capturé par TIM15 (1 us) est ramené dans la base de
+  *          temps TIM2 en retranchant son âge au moment de l'interruption :
+  *          toute la boucle travaille ainsi sur des horodatages 32 bits sans
+  *          gestion de débordement de TIM15.
+  *
+  *          La boucle combine une mesure lissée de la période du maître
+  *          (fréquence) et une correction proportionnelle de l'erreur de
+  *          phase mesurée à chaque front, interpolée dans la période PWM.
+  *          Une erreur trop grande recale directement la phase.
+  ******************************************************************************
+  */
+#include "sync.h"
+#include "tim.h"
+#include "tempo.h"
+
+static uint8_t Sync_Mode;
+static volatile uint8_t Sync_State;
+static volatile uint8_t Sync_HaveEdge;
+static volatile uint32_t Sync_LastEdge;
+static uint32_t Sync_Ratio;         /* Ticks TIM2 par tick TIM15 */
+static uint32_t Sync_PeriodQ4;      /* Période mesurée lissée, 1/16 tick */
+static uint32_t Sync_RefPeriod;     /* Premier intervalle mesuré, référence de dérive */
+static uint8_t Sync_Good;
+static volatile int32_t Sync_ErrorUs;
+static volatile int32_t Sync_DriftPpm;
+
+static uint32_t Sync_LastBeat;
+static uint8_t Sync_Pulse;
+
+static void Sync_ConfigPin(uint32_t mode, uint32_t alternate)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	HAL_GPIO_WritePin(RX2_GPIO_Port, RX2_Pin, GPIO_PIN_RESET);
+	GPIO_InitStruct.Pin = RX2_Pin;
+	GPIO_InitStruct.Mode = mode;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	GPIO_InitStruct.Alternate = alternate;
+	HAL_GPIO_Init(RX2_GPIO_Port, &GPIO_InitStruct);
+}
+
+static void Sync_Edge(uint32_t edge)
+{
+	uint32_t dt = edge - Sync_LastEdge;
+	uint32_t period;
+	int32_t err, err_ticks;
+
+	Sync_LastEdge = edge;
+	if (!Sync_HaveEdge) {
+		Sync_HaveEdge = 1;
+		return;
+	}
+	if (dt < TEMPO_MIN_PERIOD || dt > TEMPO_MAX_PERIOD) {
+		/* Impulsion parasite ou hors plage : on repart de ce front */
+		Sync_State = SYNC_STATE_SEARCH;
+		return;
+	}
+
+	if (Sync_State == SYNC_STATE_SEARCH) {
+		/* Premier intervalle valide : prise de période et de phase directes */
+		Sync_PeriodQ4 = dt << 4;
+		Sync_RefPeriod = dt;
+		Tempo_SetPeriod(dt);
+		Tempo_Align(edge);
+		Sync_Good = 0;
+		Sync_State = SYNC_STATE_ACQUIRE;
+		return;
+	}
+
+	Sync_PeriodQ4 += (uint32_t)(((int32_t)(dt << 4) - (int32_t)Sync_PeriodQ4) >> SYNC_FLL_SHIFT);
+	period = Sync_PeriodQ4 >> 4;
+	Sync_DriftPpm = (int32_t)(((int64_t)period - (int64_t)Sync_RefPeriod) * 1000000 / (int64_t)Sync_RefPeriod);
+
+	err = (int32_t)Tempo_PhaseAt(edge);
+	err_ticks = (int32_t)(((int64_t)err * Tempo_GetPeriod()) >> 32);
+	Sync_ErrorUs = err_ticks / (int32_t)TIMEBASE_TICKS_PER_US;
+
+	if (err > SYNC_RELOCK_PHASE || err < -SYNC_RELOCK_PHASE) {
+		Tempo_SetPeriod(period);
+		Tempo_Align(edge);
+		Sync_Good = 0;
+		Sync_State = SYNC_STATE_ACQUIRE;
+		return;
+	}
+
+	/* En avance : période allongée pendant le temps suivant, et inversement */
+	Tempo_SetPeriod((uint32_t)((int32_t)period + err_ticks / (int32_t)SYNC_KP_DIV));
+
+	if (Sync_ErrorUs < (int32_t)SYNC_LOCK_US && Sync_ErrorUs > -(int32_t)SYNC_LOCK_US) {
+		if (Sync_Good < SYNC_LOCK_COUNT) {
+			Sync_Good++;
+		}
+		if (Sync_Good >= SYNC_LOCK_COUNT) {
+			Sync_State = SYNC_STATE_LOCKED;
+		}
+	} else {
+		Sync_Good = 0;
+		Sync_State = SYNC_STATE_ACQUIRE;
+	}
+}
+
+void Sync_SetMode(uint8_t mode)
+{
+	HAL_TIM_IC_Stop_IT(&htim15, TIM_CHANNEL_2);
+	/* TIM15 déclenche aussi les mesures internes (sensor.h) : il continue */
+	__HAL_TIM_ENABLE(&htim15);
+	Sync_Mode = mode;
+	Sync_State = SYNC_STATE_SEARCH;
+	Sync_HaveEdge = 0;
+	Sync_Pulse = 0;
+	Sync_ErrorUs = 0;
+	Sync_DriftPpm = 0;
+	Sync_Ratio = (htim15.Instance->PSC + 1U) / (htim2.Instance->PSC + 1U);
+
+	if (mode == SYNC_MASTER) {
+		Sync_LastBeat = Tempo_GetBeats();
+		Sync_ConfigPin(GPIO_MODE_OUTPUT_PP, 0);
+	} else {
+		Sync_ConfigPin(GPIO_MODE_AF_PP, GPIO_AF14_TIM15);
+		if (mode == SYNC_SLAVE) {
+			HAL_TIM_IC_Start_IT(&htim15, TIM_CHANNEL_2);
+		}
+	}
+}
+
+void Sync_Process(void)
+{
+	if (Sync_Mode != SYNC_SLAVE) {
+		return;
+	}
+	__disable_irq();
+	if (Sync_HaveEdge && (TIMEBASE_NOW() - Sync_LastEdge) > 2U * Tempo_GetPeriod()) {
+		/* Plus d'impulsions : le tempo continue librement sur sa période */
+		Sync_HaveEdge = 0;
+		Sync_State = SYNC_STATE_SEARCH;
+	}
+	__enable_irq();
+}
+
+uint8_t Sync_GetState(void)
+{
+	return Sync_State;
+}
+
+int32_t Sync_GetErrorUs(void)
+{
+	return Sync_ErrorUs;
+}
+
+int32_t Sync_GetDriftPpm(void)
+{
+	return Sync_DriftPpm;
+}
+
+void Sync_Capture_Callback(void)
+{
+	uint32_t now = TIMEBASE_NOW();
+	uint16_t age = (uint16_t)(htim15.Instance->CNT - HAL_TIM_ReadCapturedValue(&htim15, TIM_CHANNEL_2));
+
+	Sync_Edge(now - (uint32_t)age * Sync_Ratio);
+}
+
+void Sync_Update_Callback(uint32_t beats)
+{
+	if (Sync_Mode != SYNC_MASTER) {
+		return;
+	}
+	if (beats != Sync_LastBeat) {
+		Sync_LastBeat = beats;
+		Sync_Pulse = SYNC_PULSE_PERIODS;
+		RX2_GPIO_Port->BSRR = RX2_Pin;
+	} else if (Sync_Pulse != 0 && --Sync_Pulse == 0) {
+		RX2_GPIO_Port->BRR = RX2_Pin;
+	}
+}
@@ -0,0 +1,182 @@
+/**
+  ******************************************************************************
+  * @file    tempo.c
+  * @brief   Tap tempo et accumulateur de phase.
+  *
+  *          Les frappes sont horodatées au premier front du bouton (TIM2,
+  *          1/16 us), avant anti-rebond : la période est la pente moyenne
+  *          des TEMPO_TAP_COUNT dernières frappes. La phase avance d'un
+  *          incrément constant à chaque mise à jour de TIM1 ; TIM1 et TIM2
+  *          étant cadencés par la même horloge, l'incrément est calculé
+  *          exactement en 64 bits et l'erreur d'arrondi reste inférieure à
+  *          2^-33 temps par période PWM (moins d'un millième de temps après
+  *          une heure à 977 Hz).
+  ******************************************************************************
+  */
+#include "tempo.h"
+#include "tim.h"
+
+static volatile uint32_t Tempo_Phase;
+static volatile uint32_t Tempo_Beats;
+static volatile uint32_t Tempo_Inc;
+static uint32_t Tempo_Period;
+static uint32_t Tempo_TickPeriods = 1;
+
+static uint32_t Tempo_Taps[TEMPO_TAP_COUNT];
+static uint8_t Tempo_TapIdx;
+static uint8_t Tempo_TapNb;
+
+/* Phase acquise depuis la dernière mise à jour traitée (IRQ masquées) */
+static uint32_t Tempo_Elapsed(void)
+{
+	uint32_t cnt = htim1.Instance->CNT;
+	uint32_t arr = __HAL_TIM_GET_AUTORELOAD(&htim1);
+	uint32_t inc = Tempo_Inc;
+	uint32_t extra = 0;
+
+	if (Tempo_TickPeriods != 1U) {
+		/* Avance cadencée hors mise à jour TIM1 : pas d'interpolation */
+		return 0;
+	}
+	if (__HAL_TIM_GET_FLAG(&htim1, TIM_FLAG_UPDATE) != RESET) {
+		/* Mise à jour en attente : une période complète de plus */
+		cnt = htim1.Instance->CNT;
+		extra = inc;
+	}
+	return extra + (uint32_t)(((uint64_t)inc * cnt) / (arr + 1U));
+}
+
+void Tempo_Init(void)
+{
+	Tempo_Phase = 0;
+	Tempo_Beats = 0;
+	Tempo_TapIdx = 0;
+	Tempo_TapNb = 0;
+	Tempo_SetPeriod(TEMPO_TICKS_PER_MIN / TEMPO_DEFAULT_BPM);
+	__HAL_TIM_CLEAR_FLAG(&htim1, TIM_FLAG_UPDATE);
+	__HAL_TIM_ENABLE_IT(&htim1, TIM_IT_UPDATE);
+}
+
+void Tempo_Tap(uint32_t time)
+{
+	uint32_t last, oldest, dt, avg;
+
+	if (Tempo_TapNb > 0) {
+		last = Tempo_Taps[(Tempo_TapIdx - 1U) & (TEMPO_TAP_COUNT - 1U)];
+		dt = time - last;
+		if (dt < TEMPO_MIN_PERIOD || dt > TEMPO_MAX_PERIOD) {
+			/* Frappe isolée : nouvelle série, la période est conservée */
+			Tempo_TapNb = 0;
+		} else if (Tempo_TapNb >= 2) {
+			oldest = Tempo_Taps[(Tempo_TapIdx - Tempo_TapNb) & (TEMPO_TAP_COUNT - 1U)];
+			avg = (last - oldest) / (Tempo_TapNb - 1U);
+			if ((dt > avg ? dt - avg : avg - dt) > avg / TEMPO_TAP_TOLERANCE_DIV) {
+				/* Changement de tempo : la série repart de la frappe précédente */
+				Tempo_Taps[0] = last;
+				Tempo_TapIdx = 1;
+				Tempo_TapNb = 1;
+			}
+		}
+	}
+
+	Tempo_Taps[Tempo_TapIdx] = time;
+	Tempo_TapIdx = (Tempo_TapIdx + 1U) & (TEMPO_TAP_COUNT - 1U);
+	if (Tempo_TapNb < TEMPO_TAP_COUNT) {
+		Tempo_TapNb++;
+	}
+
+	if (Tempo_TapNb >= 2) {
+		oldest = Tempo_Taps[(Tempo_TapIdx - Tempo_TapNb) & (TEMPO_TAP_COUNT - 1U)];
+		Tempo_SetPeriod((time - oldest) / (Tempo_TapNb - 1U));
+	}
+	Tempo_Align(time);
+}
+
+void Tempo_Align(uint32_t time)
+{
+	uint32_t elapsed = (TIMEBASE_NOW() - time) % Tempo_Period;
+	uint32_t phase = (uint32_t)(((uint64_t)elapsed << 32) / Tempo_Period);
+	uint32_t old, frac;
+	int32_t d;
+
+	__disable_irq();
+	frac = Tempo_Elapsed();
+	old = Tempo_Phase + frac;
+	d = (int32_t)(phase - old);
+	/* Un recalage qui franchit la limite d'un temps corrige aussi le compteur */
+	if (d > 0 && phase < old) {
+		Tempo_Beats++;
+	} else if (d < 0 && phase > old) {
+		Tempo_Beats--;
+	}
+	Tempo_Phase = phase - frac;
+	__enable_irq();
+}
+
+uint32_t Tempo_PhaseAt(uint32_t time)
+{
+	uint32_t phase, now;
+
+	__disable_irq();
+	now = TIMEBASE_NOW();
+	phase = Tempo_Phase + Tempo_Elapsed();
+	__enable_irq();
+	return phase - (uint32_t)(((uint64_t)(now - time) << 32) / Tempo_Period);
+}
+
+void Tempo_SetPeriod(uint32_t ticks)
+{
+	if (ticks < TEMPO_MIN_PERIOD) {
+		ticks = TEMPO_MIN_PERIOD;
+	} else if (ticks > TEMPO_MAX_PERIOD) {
+		ticks = TEMPO_MAX_PERIOD;
+	}
+	Tempo_Period = ticks;
+	Tempo_Recompute();
+}
+
+uint32_t Tempo_GetPeriod(void)
+{
+	return Tempo_Period;
+}
+
+uint32_t Tempo_GetBPMx10(void)
+{
+	return (uint32_t)(((uint64_t)TEMPO_TICKS_PER_MIN * 10U + Tempo_Period / 2U) / Tempo_Period);
+}
+
+void Tempo_Recompute(void)
+{
+	/* Période PWM en ticks TIM1, ramenée aux ticks TIM2 par le diviseur */
+	uint64_t pwm = (uint64_t)(__HAL_TIM_GET_AUTORELOAD(&htim1) + 1U) * (htim1.Instance->PSC + 1U)
+			* Tempo_TickPeriods;
+	uint64_t den = (uint64_t)(htim2.Instance->PSC + 1U) * Tempo_Period;
+
+	Tempo_Inc = (uint32_t)(((pwm << 32) + den / 2U) / den);
+}
+
+void Tempo_SetTickPeriods(uint32_t periods)
+{
+	Tempo_TickPeriods = (periods != 0U) ? periods : 1U;
+	Tempo_Recompute();
+}
+
+uint32_t Tempo_GetPhase(void)
+{
+	return Tempo_Phase;
+}
+
+uint32_t Tempo_GetBeats(void)
+{
+	return Tempo_Beats;
+}
+
+void Tempo_Update_Callback(void)
+{
+	uint32_t phase = Tempo_Phase + Tempo_Inc;
+
+	if (phase < Tempo_Phase) {
+		Tempo_Beats++;
+	}
+	Tempo_Phase = phase;
+}
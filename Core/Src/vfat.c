@@ -0,0 +1,237 @@
+/**
+  ******************************************************************************
+  * @file    vfat.c
+  * @brief   Secteurs du volume FAT12 virtuel.
+  *
+  *          Secteur 0 : amorçage, 1-6 et 7-12 : les deux FAT, 13 : racine,
+  *          14 et suivants : données (cluster n au secteur 12 + n).
+  ******************************************************************************
+  */
+#include "vfat.h"
+#include <stdio.h>
+#include <string.h>
+#include "record.h"
+#include "settings.h"
+#include "show.h"
+
+#define VFAT_FAT_LBA            1U
+#define VFAT_ROOT_LBA           (VFAT_FAT_LBA + 2U * VFAT_FAT_SECTORS)
+#define VFAT_DATA_LBA           (VFAT_ROOT_LBA + VFAT_ROOT_ENTRIES * 32U / VFAT_SECTOR_SIZE)
+
+/* Clusters des fichiers */
+#define VFAT_SHOW_CLUSTER       2U
+#define VFAT_SHOW_CLUSTERS      (SHOW_SIZE / VFAT_SECTOR_SIZE)
+#define VFAT_CONFIG_CLUSTER     (VFAT_SHOW_CLUSTER + VFAT_SHOW_CLUSTERS)
+
+#define VFAT_LBA(cluster)       (VFAT_DATA_LBA + (cluster) - 2U)
+
+/* 1er janvier 2025, minuit */
+#define VFAT_DATE               (((2025U - 1980U) << 9) | (1U << 5) | 1U)
+
+#define VFAT_ATTR_READ_ONLY     0x01U
+#define VFAT_ATTR_VOLUME_ID     0x08U
+#define VFAT_ATTR_ARCHIVE       0x20U
+
+static uint32_t Vfat_BlockCount(void);
+static const uint8_t *Vfat_Read(uint32_t lba);
+static int8_t Vfat_Write(uint32_t lba, const uint8_t *buf);
+
+USBD_Storage_ItfTypeDef Vfat_fops = {
+	Vfat_BlockCount,
+	Vfat_Read,
+	Vfat_Write
+};
+
+static uint8_t Vfat_Sector[VFAT_SECTOR_SIZE] __attribute__((aligned(4)));
+
+/* Premier secteur du spectacle en cours d'écriture, 0 hors écriture */
+static uint32_t Vfat_ShowLba;
+
+static void Vfat_Put16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void Vfat_Put32(uint8_t *p, uint32_t v)
+{
+	Vfat_Put16(p, (uint16_t)v);
+	Vfat_Put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint32_t Vfat_ShowSize(void)
+{
+	const Show_Header_t *h = Show_Get();
+
+	return h != NULL ? h->length : 0U;
+}
+
+static uint32_t Vfat_Config(char *buf, uint32_t len)
+{
+	int n;
+
+	n = snprintf(buf, len,
+			"adresse=%u\r\npersonnalite=%s\r\nperte=%s\r\ncontraste=%u\r\neffet=%s\r\n"
+			"synchro=%s\r\nrx2=%s\r\nfusion=%s\r\nsortie=%s\r\n",
+			Settings.dmx_address,
+			Settings_PersonalityName(Settings.personality),
+			Settings_LossName(Settings.loss_policy),
+			Settings.contrast,
+			Settings_EffectName(Settings.effect),
+			Settings_SyncName(Settings.sync_mode),
+			Settings_Rx2Name(Settings.rx2_mode),
+			Settings_MergeName(Settings.merge_mode),
+			Settings_OutputName(Settings.output_mode));
+	if (n < 0) {
+		return 0;
+	}
+	return ((uint32_t)n < len) ? (uint32_t)n : len - 1U;
+}
+
+static void Vfat_Boot(uint8_t *p)
+{
+	p[0] = 0xEB;
+	p[1] = 0x3C;
+	p[2] = 0x90;
+	memcpy(&p[3], "MSDOS5.0", 8);
+	Vfat_Put16(&p[11], VFAT_SECTOR_SIZE);
+	p[13] = 1;                                      /* Secteurs par cluster */
+	Vfat_Put16(&p[14], VFAT_FAT_LBA);               /* Secteurs réservés */
+	p[16] = 2;                                      /* Nombre de FAT */
+	Vfat_Put16(&p[17], VFAT_ROOT_ENTRIES);
+	Vfat_Put16(&p[19], VFAT_SECTORS);
+	p[21] = 0xF8;                                   /* Support fixe */
+	Vfat_Put16(&p[22], VFAT_FAT_SECTORS);
+	Vfat_Put16(&p[24], 1);                          /* Secteurs par piste */
+	Vfat_Put16(&p[26], 1);                          /* Têtes */
+	p[36] = 0x80;
+	p[38] = 0x29;                                   /* Champs suivants présents */
+	Vfat_Put32(&p[39], HAL_GetUIDw0());
+	memcpy(&p[43], "ANIMLED    ", 11);
+	memcpy(&p[54], "FAT12   ", 8);
+	p[510] = 0x55;
+	p[511] = 0xAA;
+}
+
+static uint16_t Vfat_FatEntry(uint32_t n)
+{
+	uint32_t last = VFAT_SHOW_CLUSTER + (Vfat_ShowSize() + VFAT_SECTOR_SIZE - 1U) / VFAT_SECTOR_SIZE - 1U;
+
+	if (n == 0U) {
+		return 0xFF8;
+	}
+	if (n == 1U || n == VFAT_CONFIG_CLUSTER) {
+		return 0xFFF;
+	}
+	if (n >= VFAT_SHOW_CLUSTER && n <= last) {
+		return (n == last) ? 0xFFF : (uint16_t)(n + 1U);
+	}
+	return 0;
+}
+
+/* Secteur de FAT : deux entrées de 12 bits sur trois octets */
+static void Vfat_Fat(uint8_t *p, uint32_t sector)
+{
+	uint32_t b;
+	uint32_t i;
+	uint16_t e0, e1;
+
+	for (i = 0; i < VFAT_SECTOR_SIZE; i++) {
+		b = sector * VFAT_SECTOR_SIZE + i;
+		e0 = Vfat_FatEntry(b / 3U * 2U);
+		e1 = Vfat_FatEntry(b / 3U * 2U + 1U);
+		switch (b % 3U) {
+		case 0:
+			p[i] = (uint8_t)e0;
+			break;
+		case 1:
+			p[i] = (uint8_t)((e0 >> 8) | ((e1 & 0x0FU) << 4));
+			break;
+		default:
+			p[i] = (uint8_t)(e1 >> 4);
+			break;
+		}
+	}
+}
+
+static uint8_t *Vfat_Entry(uint8_t *p, const char *name, uint8_t attr, uint16_t cluster, uint32_t size)
+{
+	memcpy(p, name, 11);
+	p[11] = attr;
+	Vfat_Put16(&p[16], VFAT_DATE);
+	Vfat_Put16(&p[18], VFAT_DATE);
+	Vfat_Put16(&p[24], VFAT_DATE);
+	Vfat_Put16(&p[26], cluster);
+	Vfat_Put32(&p[28], size);
+	return p + 32;
+}
+
+static void Vfat_Root(uint8_t *p)
+{
+	uint32_t show = Vfat_ShowSize();
+	uint32_t config = Vfat_Config((char *)p, VFAT_SECTOR_SIZE);
+
+	memset(p, 0, VFAT_SECTOR_SIZE);
+	p = Vfat_Entry(p, "ANIMLED    ", VFAT_ATTR_VOLUME_ID, 0, 0);
+	p = Vfat_Entry(p, "SHOW    BIN", VFAT_ATTR_ARCHIVE, show ? VFAT_SHOW_CLUSTER : 0U, show);
+	Vfat_Entry(p, "CONFIG  TXT", VFAT_ATTR_READ_ONLY | VFAT_ATTR_ARCHIVE, VFAT_CONFIG_CLUSTER, config);
+}
+
+static uint32_t Vfat_BlockCount(void)
+{
+	return VFAT_SECTORS;
+}
+
+static const uint8_t *Vfat_Read(uint32_t lba)
+{
+	if (lba >= VFAT_LBA(VFAT_SHOW_CLUSTER) && lba < VFAT_LBA(VFAT_CONFIG_CLUSTER)) {
+		/* Données du spectacle : lues telles quelles dans la flash */
+		return (const uint8_t *)(SHOW_BASE + (lba - VFAT_LBA(VFAT_SHOW_CLUSTER)) * VFAT_SECTOR_SIZE);
+	}
+
+	memset(Vfat_Sector, 0, sizeof(Vfat_Sector));
+	if (lba == 0U) {
+		Vfat_Boot(Vfat_Sector);
+	} else if (lba < VFAT_ROOT_LBA) {
+		Vfat_Fat(Vfat_Sector, (lba - VFAT_FAT_LBA) % VFAT_FAT_SECTORS);
+	} else if (lba == VFAT_ROOT_LBA) {
+		Vfat_Root(Vfat_Sector);
+	} else if (lba == VFAT_LBA(VFAT_CONFIG_CLUSTER)) {
+		Vfat_Config((char *)Vfat_Sector, VFAT_SECTOR_SIZE);
+	}
+	return Vfat_Sector;
+}
+
+static int8_t Vfat_Write(uint32_t lba, const uint8_t *buf)
+{
+	const Show_Header_t *h = (const Show_Header_t *)buf;
+
+	if (lba < VFAT_DATA_LBA) {
+		/* FAT et répertoire : le volume reste calculé */
+		return 0;
+	}
+	if (Record_IsRecording() || Record_IsPlaying()) {
+		/* L'enregistreur lit ou écrit le même emplacement : copie à refaire */
+		Vfat_ShowLba = 0;
+		return -1;
+	}
+	if (Show_IsValid(h)) {
+		Vfat_ShowLba = lba;
+		Show_WriteBegin(h->length);
+	}
+	if (Vfat_ShowLba == 0U || lba < Vfat_ShowLba) {
+		return 0;
+	}
+	switch (Show_Write((lba - Vfat_ShowLba) * VFAT_SECTOR_SIZE, buf, VFAT_SECTOR_SIZE)) {
+	case SHOW_WRITE_DONE:
+		Vfat_ShowLba = 0;
+		break;
+	case SHOW_WRITE_ERROR:
+		/* Secteur hors ordre, flash occupée ou en défaut : spectacle à recopier */
+		Vfat_ShowLba = 0;
+		return -1;
+	default:
+		break;
+	}
+	return 0;
+}
@@ -0,0 +1,173 @@
+/**
+  ******************************************************************************
+  * @file    watchdog.c
+  * @brief   IWDG piloté par registres et délais des tâches.
+  *
+  *          Le contrôle des délais se fait à la fois dans la boucle
+  *          principale et à chaque période PWM : une boucle bloquée est
+  *          relevée par l'interruption de TIM1, une interruption TIM1 perdue
+  *          par la boucle. Un retard est définitif : l'IWDG n'est plus
+  *          rechargé même si la tâche repart, le relevé reste cohérent avec
+  *          le reset qui suit.
+  *
+  *          Les passages sont datés par tâche sur un mot, l'armement tient
+  *          sur un octet par tâche : aucun masquage n'est nécessaire entre
+  *          l'interruption USB, celle de TIM1 et la boucle principale.
+  ******************************************************************************
+  */
+#include "watchdog.h"
+#include <string.h>
+#include "retain.h"
+
+/* Clés de IWDG_KR */
+#define WATCHDOG_KEY_START      0xCCCCU
+#define WATCHDOG_KEY_ACCESS     0x5555U
+#define WATCHDOG_KEY_RELOAD     0xAAAAU
+
+/* LSI / 32 : 1 kHz */
+#define WATCHDOG_PRESCALER      3U
+
+typedef struct {
+	Retain_Header_t header;
+	Watchdog_Report_t report;
+} Watchdog_Record_t;
+
+static const uint16_t Watchdog_Deadline[WATCHDOG_TASK_COUNT] = {
+	WATCHDOG_DMX_MS,
+	WATCHDOG_PWM_MS,
+	WATCHDOG_DISPLAY_MS,
+	WATCHDOG_USB_MS
+};
+
+RETAIN static Watchdog_Record_t Watchdog_Record;
+
+static volatile uint32_t Watchdog_Seen[WATCHDOG_TASK_COUNT];
+static volatile uint8_t Watchdog_Armed[WATCHDOG_TASK_COUNT];
+static volatile uint32_t Watchdog_Late;
+static Watchdog_Report_t Watchdog_Report;
+static Watchdog_Report_t Watchdog_Last;
+static uint8_t Watchdog_HaveLast;
+static volatile uint8_t Watchdog_Running;
+
+static uint16_t Watchdog_Clamp(uint32_t ms)
+{
+	return (ms > 0xFFFFU) ? 0xFFFFU : (uint16_t)ms;
+}
+
+/* Relevé des retards ; interruptions masquées ou depuis TIM1 */
+static void Watchdog_Update(void)
+{
+	uint32_t now = HAL_GetTick();
+	uint32_t late = 0;
+	uint32_t d;
+	uint8_t t;
+
+	if (!Watchdog_Running) {
+		return;
+	}
+	for (t = 0; t < WATCHDOG_TASK_COUNT; t++) {
+		if (!Watchdog_Armed[t]) {
+			continue;
+		}
+		d = now - Watchdog_Seen[t];
+		if (d > Watchdog_Deadline[t]) {
+			late |= 1UL << t;
+			if (d - Watchdog_Deadline[t] > Watchdog_Report.lateness_ms[t]) {
+				Watchdog_Report.lateness_ms[t] = Watchdog_Clamp(d - Watchdog_Deadline[t]);
+			}
+		}
+	}
+	Watchdog_Late |= late;
+	Watchdog_Report.late = Watchdog_Late;
+	Watchdog_Report.uptime_ms = now;
+	if (Watchdog_Late) {
+		/* Relevé mis à jour jusqu'au reset : retard le plus grand atteint */
+		memcpy(&Watchdog_Record.report, &Watchdog_Report, sizeof(Watchdog_Report));
+		Retain_Seal(&Watchdog_Record, sizeof(Watchdog_Record));
+	}
+}
+
+void Watchdog_Init(void)
+{
+	Watchdog_HaveLast = (Retain_GetCause() & RCC_CSR_IWDGRSTF)
+			&& Retain_Valid(&Watchdog_Record, sizeof(Watchdog_Record));
+	if (Watchdog_HaveLast) {
+		memcpy(&Watchdog_Last, &Watchdog_Record.report, sizeof(Watchdog_Last));
+	}
+	memset(&Watchdog_Record, 0, sizeof(Watchdog_Record));
+	memset(&Watchdog_Report, 0, sizeof(Watchdog_Report));
+	memset((void *)Watchdog_Armed, 0, sizeof(Watchdog_Armed));
+	Watchdog_Late = 0;
+
+	/* Arrêté avec le coeur sous débogueur */
+	__HAL_DBGMCU_FREEZE_IWDG();
+
+	/* Démarrage (LSI forcé), puis prédiviseur et rechargement */
+	IWDG->KR = WATCHDOG_KEY_START;
+	IWDG->KR = WATCHDOG_KEY_ACCESS;
+	IWDG->PR = WATCHDOG_PRESCALER;
+	IWDG->RLR = WATCHDOG_TIMEOUT_MS - 1U;
+	while (IWDG->SR != 0U) {
+	}
+	IWDG->KR = WATCHDOG_KEY_RELOAD;
+	Watchdog_Running = 1;
+}
+
+void Watchdog_Checkin(uint8_t task)
+{
+	uint32_t now = HAL_GetTick();
+	uint32_t d;
+
+	if (task >= WATCHDOG_TASK_COUNT) {
+		return;
+	}
+	if (Watchdog_Armed[task]) {
+		d = now - Watchdog_Seen[task];
+		if (d > Watchdog_Report.worst_ms[task]) {
+			Watchdog_Report.worst_ms[task] = Watchdog_Clamp(d);
+		}
+	}
+	Watchdog_Seen[task] = now;
+	Watchdog_Armed[task] = 1;
+}
+
+void Watchdog_Pause(uint8_t task)
+{
+	if (task < WATCHDOG_TASK_COUNT) {
+		Watchdog_Armed[task] = 0;
+	}
+}
+
+void Watchdog_Tick(void)
+{
+	Watchdog_Checkin(WATCHDOG_TASK_PWM);
+	Watchdog_Update();
+}
+
+void Watchdog_Process(void)
+{
+	__disable_irq();
+	Watchdog_Update();
+	__enable_irq();
+	Watchdog_Kick();
+}
+
+void Watchdog_Kick(void)
+{
+	if (!Watchdog_Late) {
+		IWDG->KR = WATCHDOG_KEY_RELOAD;
+	}
+}
+
+const Watchdog_Report_t *Watchdog_GetReport(void)
+{
+	__disable_irq();
+	Watchdog_Update();
+	__enable_irq();
+	return &Watchdog_Report;
+}
+
+const Watchdog_Report_t *Watchdog_GetLast(void)
+{
+	return Watchdog_HaveLast ? &Watchdog_Last : NULL;
+}
@@ -27,6 +27,9 @@
 #include "usbd_cdc_if.h"
 
 /* USER CODE BEGIN Includes */
+#include "usbd_composite.h"
+#include "bulk.h"
+#include "vfat.h"
 
 /* USER CODE END Includes */
 
@@ -86,6 +89,11 @@ void MX_USB_DEVICE_Init(void)
     Error_Handler();
   }
   /* USER CODE BEGIN USB_DEVICE_Init_PostTreatment */
+  /* CDC + interface vendeur : enregistré avant la première requête de l'hôte */
+  if (USBD_Composite_Register(&hUsbDeviceFS, &Bulk_fops, &Vfat_fops) != USBD_OK)
+  {
+    Error_Handler();
+  }
 
   /* USER CODE END USB_DEVICE_Init_PostTreatment */
 }
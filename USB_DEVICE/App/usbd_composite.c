@@ -0,0 +1,425 @@
+/**
+  ******************************************************************************
+  * @file    usbd_composite.c
+  * @brief   Fonction composite CDC + interface vendeur bulk + stockage.
+  *
+  *          La classe CDC de la bibliothèque est conservée telle quelle : ce
+  *          module l'enveloppe et ne traite lui-même que l'interface 2 et
+  *          ses deux points de terminaison ; l'interface 3 est confiée à
+  *          usbd_storage.c. Le descripteur de configuration est celui du CDC
+  *          précédé d'un IAD (les deux interfaces CDC forment une fonction)
+  *          et suivi des interfaces vendeur et stockage.
+  *
+  *          Windows lit le BOS, y trouve la capacité MS OS 2.0 puis demande
+  *          l'ensemble de descripteurs par la requête vendeur
+  *          COMPOSITE_MSOS_VENDOR_CODE : l'interface 2 reçoit WinUSB et un
+  *          GUID d'interface, sans pilote à installer.
+  ******************************************************************************
+  */
+#include "usbd_composite.h"
+#include <string.h>
+#include "usbd_cdc.h"
+#include "usbd_ctlreq.h"
+#include "usbd_storage.h"
+
+#define COMPOSITE_IAD_SIZ               8U
+#define COMPOSITE_VENDOR_DESC_SIZ       23U
+#define COMPOSITE_CFG_DESC_SIZ          (USB_CDC_CONFIG_DESC_SIZ + COMPOSITE_IAD_SIZ + COMPOSITE_VENDOR_DESC_SIZ \
+                                         + STORAGE_DESC_SIZ)
+#define COMPOSITE_BOS_DESC_SIZ          64U
+
+/* Ensemble MS OS 2.0 : en-tête, configuration, fonction, WinUSB, GUID */
+#define COMPOSITE_MSOS_INDEX            0x07U
+#define COMPOSITE_MSOS_PROP_SIZ         132U
+#define COMPOSITE_MSOS_FUNC_SIZ         (8U + 20U + COMPOSITE_MSOS_PROP_SIZ)
+#define COMPOSITE_MSOS_CONF_SIZ         (8U + COMPOSITE_MSOS_FUNC_SIZ)
+#define COMPOSITE_MSOS_SET_SIZ          (10U + COMPOSITE_MSOS_CONF_SIZ)
+#define COMPOSITE_MSOS_GUID             "{8A3C5E1F-2B47-4D69-9E0A-5C7B1D3F6E28}"
+
+static uint8_t Composite_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t Composite_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t Composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+static uint8_t Composite_EP0_RxReady(USBD_HandleTypeDef *pdev);
+static uint8_t Composite_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t Composite_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t *Composite_GetCfgDesc(uint16_t *length);
+static uint8_t *Composite_GetDeviceQualifierDesc(uint16_t *length);
+static uint8_t *Composite_GetDeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
+static uint8_t *Composite_GetBOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
+
+USBD_ClassTypeDef USBD_COMPOSITE =
+{
+  Composite_Init,
+  Composite_DeInit,
+  Composite_Setup,
+  NULL,                 /* EP0_TxSent */
+  Composite_EP0_RxReady,
+  Composite_DataIn,
+  Composite_DataOut,
+  NULL,                 /* SOF : traité à l'entrée de l'interruption USB */
+  NULL,
+  NULL,
+  Composite_GetCfgDesc,
+  Composite_GetCfgDesc,
+  Composite_GetCfgDesc,
+  Composite_GetDeviceQualifierDesc,
+};
+
+static USBD_Vendor_ItfTypeDef *Composite_Fops;
+static uint8_t *Composite_RxBuf;
+static volatile uint8_t Composite_TxBusy;
+
+__ALIGN_BEGIN static uint8_t Composite_CfgDesc[COMPOSITE_CFG_DESC_SIZ] __ALIGN_END;
+__ALIGN_BEGIN static uint8_t Composite_DevDesc[USB_LEN_DEV_DESC] __ALIGN_END;
+__ALIGN_BEGIN static uint8_t Composite_MsOsSet[COMPOSITE_MSOS_SET_SIZ] __ALIGN_END;
+
+__ALIGN_BEGIN static uint8_t Composite_BOSDesc[COMPOSITE_BOS_DESC_SIZ] __ALIGN_END =
+{
+  0x05,                                   /* bLength */
+  USB_DESC_TYPE_BOS,                      /* bDescriptorType */
+  LOBYTE(COMPOSITE_BOS_DESC_SIZ),         /* wTotalLength */
+  HIBYTE(COMPOSITE_BOS_DESC_SIZ),
+  0x03,                                   /* bNumDeviceCaps */
+
+  /* Extension USB 2.0 : LPM */
+  0x07,
+  USB_DEVICE_CAPABITY_TYPE,
+  0x02,                                   /* USB 2.0 Extension */
+  0x02, 0x00, 0x00, 0x00,                 /* bmAttributes : LPM */
+
+  /* Plateforme WebUSB {3408B638-09A9-47A0-8BFD-A0768815B665} */
+  0x18,
+  USB_DEVICE_CAPABITY_TYPE,
+  0x05,                                   /* Platform */
+  0x00,
+  0x38, 0xB6, 0x08, 0x34, 0xA9, 0x09, 0xA0, 0x47,
+  0x8B, 0xFD, 0xA0, 0x76, 0x88, 0x15, 0xB6, 0x65,
+  0x00, 0x01,                             /* bcdVersion 1.00 */
+  COMPOSITE_WEBUSB_VENDOR_CODE,
+  0x00,                                   /* iLandingPage : aucune */
+
+  /* Plateforme MS OS 2.0 {D8DD60DF-4589-4CC7-9CD2-659D9E648A9F} */
+  0x1C,
+  USB_DEVICE_CAPABITY_TYPE,
+  0x05,
+  0x00,
+  0xDF, 0x60, 0xDD, 0xD8, 0x89, 0x45, 0xC7, 0x4C,
+  0x9C, 0xD2, 0x65, 0x9D, 0x9E, 0x64, 0x8A, 0x9F,
+  0x00, 0x00, 0x03, 0x06,                 /* Windows 8.1 et suivants */
+  LOBYTE(COMPOSITE_MSOS_SET_SIZ),
+  HIBYTE(COMPOSITE_MSOS_SET_SIZ),
+  COMPOSITE_MSOS_VENDOR_CODE,
+  0x00                                    /* bAltEnumCode */
+};
+
+/* Interface vendeur et ses deux points de terminaison bulk */
+static const uint8_t Composite_VendorDesc[COMPOSITE_VENDOR_DESC_SIZ] =
+{
+  0x09,
+  USB_DESC_TYPE_INTERFACE,
+  COMPOSITE_VENDOR_ITF,                   /* bInterfaceNumber */
+  0x00,                                   /* bAlternateSetting */
+  0x02,                                   /* bNumEndpoints */
+  0xFF, 0x00, 0x00,                       /* Classe vendeur */
+  0x00,                                   /* iInterface */
+
+  0x07,
+  USB_DESC_TYPE_ENDPOINT,
+  COMPOSITE_VENDOR_OUT_EP,
+  USBD_EP_TYPE_BULK,
+  LOBYTE(COMPOSITE_VENDOR_PACKET_SIZE),
+  HIBYTE(COMPOSITE_VENDOR_PACKET_SIZE),
+  0x00,
+
+  0x07,
+  USB_DESC_TYPE_ENDPOINT,
+  COMPOSITE_VENDOR_IN_EP,
+  USBD_EP_TYPE_BULK,
+  LOBYTE(COMPOSITE_VENDOR_PACKET_SIZE),
+  HIBYTE(COMPOSITE_VENDOR_PACKET_SIZE),
+  0x00
+};
+
+/* Chaîne ASCII en UTF-16LE, zéro final compris */
+static uint8_t *Composite_PutUtf16(uint8_t *p, const char *s)
+{
+  do
+  {
+    *p++ = (uint8_t)*s;
+    *p++ = 0x00;
+  } while (*s++ != '\0');
+  return p;
+}
+
+static uint8_t *Composite_PutHeader(uint8_t *p, uint16_t length, uint16_t type)
+{
+  *p++ = LOBYTE(length);
+  *p++ = HIBYTE(length);
+  *p++ = LOBYTE(type);
+  *p++ = HIBYTE(type);
+  return p;
+}
+
+static void Composite_BuildMsOsSet(void)
+{
+  uint8_t *p = Composite_MsOsSet;
+
+  (void)memset(Composite_MsOsSet, 0, sizeof(Composite_MsOsSet));
+
+  /* En-tête de l'ensemble */
+  p = Composite_PutHeader(p, 10U, 0x00U);
+  *p++ = 0x00;
+  *p++ = 0x00;
+  *p++ = 0x03;
+  *p++ = 0x06;
+  *p++ = LOBYTE(COMPOSITE_MSOS_SET_SIZ);
+  *p++ = HIBYTE(COMPOSITE_MSOS_SET_SIZ);
+
+  /* Sous-ensemble de la configuration 0 */
+  p = Composite_PutHeader(p, 8U, 0x01U);
+  *p++ = 0x00;
+  *p++ = 0x00;
+  *p++ = LOBYTE(COMPOSITE_MSOS_CONF_SIZ);
+  *p++ = HIBYTE(COMPOSITE_MSOS_CONF_SIZ);
+
+  /* Sous-ensemble de la fonction vendeur */
+  p = Composite_PutHeader(p, 8U, 0x02U);
+  *p++ = COMPOSITE_VENDOR_ITF;
+  *p++ = 0x00;
+  *p++ = LOBYTE(COMPOSITE_MSOS_FUNC_SIZ);
+  *p++ = HIBYTE(COMPOSITE_MSOS_FUNC_SIZ);
+
+  /* Identifiant compatible : WINUSB, sous-identifiant vide */
+  p = Composite_PutHeader(p, 20U, 0x03U);
+  (void)memcpy(p, "WINUSB", 6U);
+  p += 16U;
+
+  /* Propriété de registre DeviceInterfaceGUIDs (REG_MULTI_SZ) */
+  p = Composite_PutHeader(p, COMPOSITE_MSOS_PROP_SIZ, 0x04U);
+  *p++ = 0x07;
+  *p++ = 0x00;
+  *p++ = 42U;
+  *p++ = 0x00;
+  p = Composite_PutUtf16(p, "DeviceInterfaceGUIDs");
+  *p++ = 80U;
+  *p++ = 0x00;
+  p = Composite_PutUtf16(p, COMPOSITE_MSOS_GUID);
+  /* Second zéro de fin de liste : tampon déjà à zéro */
+}
+
+static uint8_t Composite_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  uint8_t ret = USBD_CDC.Init(pdev, cfgidx);
+
+  (void)USBD_LL_OpenEP(pdev, COMPOSITE_VENDOR_OUT_EP, USBD_EP_TYPE_BULK, COMPOSITE_VENDOR_PACKET_SIZE);
+  pdev->ep_out[COMPOSITE_VENDOR_OUT_EP & 0xFU].is_used = 1U;
+  (void)USBD_LL_OpenEP(pdev, COMPOSITE_VENDOR_IN_EP, USBD_EP_TYPE_BULK, COMPOSITE_VENDOR_PACKET_SIZE);
+  pdev->ep_in[COMPOSITE_VENDOR_IN_EP & 0xFU].is_used = 1U;
+  Composite_TxBusy = 0U;
+  if (Composite_Fops != NULL)
+  {
+    (void)Composite_Fops->Init();
+  }
+  USBD_Storage_Init(pdev);
+  return ret;
+}
+
+static uint8_t Composite_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  (void)USBD_LL_CloseEP(pdev, COMPOSITE_VENDOR_OUT_EP);
+  pdev->ep_out[COMPOSITE_VENDOR_OUT_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, COMPOSITE_VENDOR_IN_EP);
+  pdev->ep_in[COMPOSITE_VENDOR_IN_EP & 0xFU].is_used = 0U;
+  Composite_TxBusy = 0U;
+  if (Composite_Fops != NULL)
+  {
+    (void)Composite_Fops->DeInit();
+  }
+  USBD_Storage_DeInit(pdev);
+  return USBD_CDC.DeInit(pdev, cfgidx);
+}
+
+static uint8_t Composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+  if (((req->bmRequest & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_ENDPOINT)
+      && ((LOBYTE(req->wIndex) & 0x7FU) == STORAGE_OUT_EP))
+  {
+    /* CLEAR_FEATURE sur un point de terminaison du stockage */
+    return USBD_Storage_Setup(pdev, req);
+  }
+
+  switch (req->bmRequest & USB_REQ_TYPE_MASK)
+  {
+    case USB_REQ_TYPE_VENDOR:
+      if ((req->bRequest == COMPOSITE_MSOS_VENDOR_CODE) && (req->wIndex == COMPOSITE_MSOS_INDEX))
+      {
+        (void)USBD_CtlSendData(pdev, Composite_MsOsSet, MIN(req->wLength, COMPOSITE_MSOS_SET_SIZ));
+        return (uint8_t)USBD_OK;
+      }
+      /* Pas de page d'accueil WebUSB ni d'autre requête vendeur */
+      USBD_CtlError(pdev, req);
+      return (uint8_t)USBD_FAIL;
+
+    case USB_REQ_TYPE_CLASS:
+      if (LOBYTE(req->wIndex) == COMPOSITE_VENDOR_ITF)
+      {
+        /* Requête de classe CDC adressée à l'interface vendeur */
+        USBD_CtlError(pdev, req);
+        return (uint8_t)USBD_FAIL;
+      }
+      if (LOBYTE(req->wIndex) == STORAGE_ITF)
+      {
+        return USBD_Storage_Setup(pdev, req);
+      }
+      break;
+
+    default:
+      break;
+  }
+  /* Requêtes standard : traitement générique de la classe CDC */
+  return USBD_CDC.Setup(pdev, req);
+}
+
+static uint8_t Composite_EP0_RxReady(USBD_HandleTypeDef *pdev)
+{
+  return USBD_CDC.EP0_RxReady(pdev);
+}
+
+static uint8_t Composite_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  USBD_EndpointTypeDef *ep;
+
+  if (epnum == (STORAGE_IN_EP & 0xFU))
+  {
+    USBD_Storage_DataIn(pdev);
+    return (uint8_t)USBD_OK;
+  }
+  if (epnum != (COMPOSITE_VENDOR_IN_EP & 0xFU))
+  {
+    return USBD_CDC.DataIn(pdev, epnum);
+  }
+  ep = &pdev->ep_in[epnum];
+  if ((ep->total_length > 0U) && ((ep->total_length % COMPOSITE_VENDOR_PACKET_SIZE) == 0U))
+  {
+    /* Transfert multiple de la taille de paquet : ZLP de fin */
+    ep->total_length = 0U;
+    (void)USBD_LL_Transmit(pdev, COMPOSITE_VENDOR_IN_EP, NULL, 0U);
+    return (uint8_t)USBD_OK;
+  }
+  Composite_TxBusy = 0U;
+  if (Composite_Fops != NULL)
+  {
+    (void)Composite_Fops->TransmitCplt();
+  }
+  return (uint8_t)USBD_OK;
+}
+
+static uint8_t Composite_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  if (epnum == STORAGE_OUT_EP)
+  {
+    USBD_Storage_DataOut(pdev);
+    return (uint8_t)USBD_OK;
+  }
+  if (epnum != COMPOSITE_VENDOR_OUT_EP)
+  {
+    return USBD_CDC.DataOut(pdev, epnum);
+  }
+  if (Composite_Fops != NULL)
+  {
+    (void)Composite_Fops->Receive(Composite_RxBuf, USBD_LL_GetRxDataSize(pdev, epnum));
+  }
+  return (uint8_t)USBD_OK;
+}
+
+static uint8_t *Composite_GetCfgDesc(uint16_t *length)
+{
+  *length = (uint16_t)sizeof(Composite_CfgDesc);
+  return Composite_CfgDesc;
+}
+
+static uint8_t *Composite_GetDeviceQualifierDesc(uint16_t *length)
+{
+  return USBD_CDC.GetDeviceQualifierDescriptor(length);
+}
+
+static uint8_t *Composite_GetDeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+  UNUSED(speed);
+  *length = (uint16_t)sizeof(Composite_DevDesc);
+  return Composite_DevDesc;
+}
+
+static uint8_t *Composite_GetBOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+  UNUSED(speed);
+  *length = (uint16_t)sizeof(Composite_BOSDesc);
+  return Composite_BOSDesc;
+}
+
+uint8_t USBD_Composite_Register(USBD_HandleTypeDef *pdev, USBD_Vendor_ItfTypeDef *fops,
+                                USBD_Storage_ItfTypeDef *storage)
+{
+  uint8_t *desc;
+  uint8_t *p = Composite_CfgDesc;
+  uint16_t len;
+
+  Composite_Fops = fops;
+  USBD_Storage_Register(storage);
+
+  /* Configuration : en-tête CDC, IAD, interfaces CDC, vendeur, stockage */
+  desc = USBD_CDC.GetFSConfigDescriptor(&len);
+  (void)memcpy(p, desc, 9U);
+  p[2] = LOBYTE(COMPOSITE_CFG_DESC_SIZ);
+  p[3] = HIBYTE(COMPOSITE_CFG_DESC_SIZ);
+  p[4] = 0x04;                            /* bNumInterfaces */
+  p += 9U;
+  *p++ = COMPOSITE_IAD_SIZ;
+  *p++ = USB_DESC_TYPE_IAD;
+  *p++ = 0x00;                            /* bFirstInterface */
+  *p++ = 0x02;                            /* bInterfaceCount */
+  *p++ = 0x02;                            /* CDC */
+  *p++ = 0x02;                            /* ACM */
+  *p++ = 0x01;
+  *p++ = 0x00;
+  (void)memcpy(p, &desc[9], USB_CDC_CONFIG_DESC_SIZ - 9U);
+  p += USB_CDC_CONFIG_DESC_SIZ - 9U;
+  (void)memcpy(p, Composite_VendorDesc, sizeof(Composite_VendorDesc));
+  p += sizeof(Composite_VendorDesc);
+  (void)memcpy(p, USBD_Storage_Desc, sizeof(USBD_Storage_Desc));
+
+  /* Périphérique : classe « divers / IAD » au lieu de CDC */
+  desc = pdev->pDesc->GetDeviceDescriptor(pdev->dev_speed, &len);
+  (void)memcpy(Composite_DevDesc, desc, sizeof(Composite_DevDesc));
+  Composite_DevDesc[4] = 0xEF;
+  Composite_DevDesc[5] = 0x02;
+  Composite_DevDesc[6] = 0x01;
+  pdev->pDesc->GetDeviceDescriptor = Composite_GetDeviceDescriptor;
+  pdev->pDesc->GetBOSDescriptor = Composite_GetBOSDescriptor;
+
+  Composite_BuildMsOsSet();
+
+  return (uint8_t)USBD_RegisterClass(pdev, &USBD_COMPOSITE);
+}
+
+uint8_t USBD_Composite_VendorReceive(USBD_HandleTypeDef *pdev, uint8_t *buf, uint16_t len)
+{
+  /* Appelée aussi depuis Init, avant le passage à l'état configuré */
+  Composite_RxBuf = buf;
+  return (uint8_t)USBD_LL_PrepareReceive(pdev, COMPOSITE_VENDOR_OUT_EP, buf, len);
+}
+
+uint8_t USBD_Composite_VendorTransmit(USBD_HandleTypeDef *pdev, uint8_t *buf, uint16_t len)
+{
+  if (pdev->dev_state != USBD_STATE_CONFIGURED)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+  if (Composite_TxBusy)
+  {
+    return (uint8_t)USBD_BUSY;
+  }
+  Composite_TxBusy = 1U;
+  pdev->ep_in[COMPOSITE_VENDOR_IN_EP & 0xFU].total_length = len;
+  return (uint8_t)USBD_LL_Transmit(pdev, COMPOSITE_VENDOR_IN_EP, buf, len);
+}
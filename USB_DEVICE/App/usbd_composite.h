@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file    usbd_composite.h
+  * @brief   Fonction composite : CDC (interfaces 0 et 1) + interface vendeur
+  *          en bulk (interface 2, EP 0x03 / 0x83) + stockage de masse
+  *          (interface 3, EP 0x04 / 0x84, voir usbd_storage.h).
+  *
+  *          L'interface vendeur est annoncée à Windows par les descripteurs
+  *          MS OS 2.0 (pilote WinUSB sans .inf) et aux navigateurs par la
+  *          capacité WebUSB du BOS.
+  ******************************************************************************
+  */
+#ifndef __USBD_COMPOSITE_H__
+#define __USBD_COMPOSITE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "usbd_ioreq.h"
+#include "usbd_storage.h"
+
+#define COMPOSITE_VENDOR_ITF            0x02U
+#define COMPOSITE_VENDOR_OUT_EP         0x03U
+#define COMPOSITE_VENDOR_IN_EP          0x83U
+#define COMPOSITE_VENDOR_PACKET_SIZE    64U
+
+/* Codes des requêtes vendeur de lecture des descripteurs */
+#define COMPOSITE_MSOS_VENDOR_CODE      0x20U
+#define COMPOSITE_WEBUSB_VENDOR_CODE    0x21U
+
+/**
+ * @brief  Callbacks de l'application pour l'interface vendeur
+ */
+typedef struct
+{
+  int8_t (*Init)(void);                                 /*!< Configuration choisie */
+  int8_t (*DeInit)(void);                               /*!< Déconfiguration */
+  int8_t (*Receive)(uint8_t *buf, uint32_t len);        /*!< Transfert OUT terminé */
+  int8_t (*TransmitCplt)(void);                         /*!< Transfert IN terminé */
+} USBD_Vendor_ItfTypeDef;
+
+extern USBD_ClassTypeDef USBD_COMPOSITE;
+
+/**
+ * @brief  Remplace la classe CDC enregistrée par la fonction composite
+ * @note   A appeler après USBD_CDC_RegisterInterface, avant l'énumération
+ * @param  pdev: instance du périphérique
+ * @param  fops: callbacks de l'interface vendeur
+ * @param  storage: callbacks du volume de stockage
+ * @retval USBD_OK
+ */
+uint8_t USBD_Composite_Register(USBD_HandleTypeDef *pdev, USBD_Vendor_ItfTypeDef *fops,
+                                USBD_Storage_ItfTypeDef *storage);
+
+/**
+ * @brief  Arme la réception d'un transfert OUT (NAK jusque-là)
+ * @param  pdev: instance du périphérique
+ * @param  buf: tampon de réception
+ * @param  len: taille du tampon, multiple de COMPOSITE_VENDOR_PACKET_SIZE
+ * @retval USBD_OK
+ */
+uint8_t USBD_Composite_VendorReceive(USBD_HandleTypeDef *pdev, uint8_t *buf, uint16_t len);
+
+/**
+ * @brief  Envoie un transfert IN (paquet court ou ZLP final)
+ * @param  pdev: instance du périphérique
+ * @param  buf: données, conservées jusqu'à TransmitCplt
+ * @param  len: nombre d'octets
+ * @retval USBD_OK, USBD_BUSY si un envoi est en cours, USBD_FAIL hors
+ *         configuration
+ */
+uint8_t USBD_Composite_VendorTransmit(USBD_HandleTypeDef *pdev, uint8_t *buf, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_COMPOSITE_H__ */
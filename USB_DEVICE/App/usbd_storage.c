@@ -0,0 +1,439 @@
+/**
+  ******************************************************************************
+  * @file    usbd_storage.c
+  * @brief   Stockage de masse Bulk-Only, un LUN, SCSI transparent.
+  *
+  *          La classe MSC de la bibliothèque ST n'est pas dans le projet ;
+  *          ce module n'en reprend que le nécessaire. Un transfert est
+  *          décrit par un CBW de 31 octets, suivi éventuellement d'une phase
+  *          de données par secteurs de 512 octets, et se termine par un CSW
+  *          de 13 octets sur l'EP IN.
+  *
+  *          En cas d'échec avec une phase de données IN, l'EP IN est mis en
+  *          STALL et le CSW n'est envoyé qu'après le CLEAR_FEATURE de l'hôte.
+  *          Un CBW invalide bloque les deux EP jusqu'au Reset de classe.
+  *
+  *          Tout s'exécute dans l'interruption USB, écritures en flash
+  *          comprises.
+  ******************************************************************************
+  */
+#include "usbd_storage.h"
+#include <string.h>
+#include "usbd_ctlreq.h"
+
+#define STORAGE_CBW_SIGNATURE           0x43425355UL
+#define STORAGE_CSW_SIGNATURE           0x53425355UL
+#define STORAGE_CBW_LENGTH              31U
+#define STORAGE_CSW_LENGTH              13U
+
+#define STORAGE_CSW_PASSED              0x00U
+#define STORAGE_CSW_FAILED              0x01U
+
+/* Requêtes de classe */
+#define STORAGE_REQ_GET_MAX_LUN         0xFEU
+#define STORAGE_REQ_RESET               0xFFU
+
+/* Commandes SCSI */
+#define SCSI_TEST_UNIT_READY            0x00U
+#define SCSI_REQUEST_SENSE              0x03U
+#define SCSI_INQUIRY                    0x12U
+#define SCSI_MODE_SENSE6                0x1AU
+#define SCSI_START_STOP_UNIT            0x1BU
+#define SCSI_PREVENT_ALLOW              0x1EU
+#define SCSI_READ_FORMAT_CAPACITIES     0x23U
+#define SCSI_READ_CAPACITY10            0x25U
+#define SCSI_READ10                     0x28U
+#define SCSI_WRITE10                    0x2AU
+#define SCSI_VERIFY10                   0x2FU
+#define SCSI_MODE_SENSE10               0x5AU
+
+/* Clés de sense et codes additionnels */
+#define SCSI_SENSE_MEDIUM_ERROR         0x03U
+#define SCSI_SENSE_ILLEGAL_REQUEST      0x05U
+#define SCSI_ASC_WRITE_FAULT            0x03U
+#define SCSI_ASC_INVALID_COMMAND        0x20U
+#define SCSI_ASC_LBA_OUT_OF_RANGE       0x21U
+#define SCSI_ASC_INVALID_FIELD          0x24U
+
+typedef enum
+{
+  STORAGE_IDLE = 0,     /* Attente d'un CBW */
+  STORAGE_DATA_IN,      /* READ(10) en cours */
+  STORAGE_DATA_OUT,     /* WRITE(10) en cours */
+  STORAGE_LAST_IN,      /* Réponse envoyée, CSW ensuite */
+  STORAGE_STALLED,      /* EP IN en STALL, CSW après CLEAR_FEATURE */
+  STORAGE_STATUS,       /* CSW envoyé */
+  STORAGE_ERROR         /* CBW invalide, attente du Reset */
+} Storage_State_t;
+
+const uint8_t USBD_Storage_Desc[STORAGE_DESC_SIZ] =
+{
+  0x09,
+  USB_DESC_TYPE_INTERFACE,
+  STORAGE_ITF,                            /* bInterfaceNumber */
+  0x00,                                   /* bAlternateSetting */
+  0x02,                                   /* bNumEndpoints */
+  0x08, 0x06, 0x50,                       /* Mass Storage, SCSI transparent, Bulk-Only */
+  0x00,                                   /* iInterface */
+
+  0x07,
+  USB_DESC_TYPE_ENDPOINT,
+  STORAGE_OUT_EP,
+  USBD_EP_TYPE_BULK,
+  LOBYTE(STORAGE_PACKET_SIZE),
+  HIBYTE(STORAGE_PACKET_SIZE),
+  0x00,
+
+  0x07,
+  USB_DESC_TYPE_ENDPOINT,
+  STORAGE_IN_EP,
+  USBD_EP_TYPE_BULK,
+  LOBYTE(STORAGE_PACKET_SIZE),
+  HIBYTE(STORAGE_PACKET_SIZE),
+  0x00
+};
+
+/* Réponse à INQUIRY : périphérique à accès direct, amovible */
+static const uint8_t Storage_Inquiry[36] =
+{
+  0x00, 0x80, 0x02, 0x02, 31U, 0x00, 0x00, 0x00,
+  'A', 'n', 'i', 'm', 'L', 'E', 'D', ' ',
+  'S', 'h', 'o', 'w', ' ', 's', 't', 'o', 'r', 'a', 'g', 'e', ' ', ' ', ' ', ' ',
+  '1', '.', '0', ' '
+};
+
+static USBD_Storage_ItfTypeDef *Storage_Fops;
+static Storage_State_t Storage_State;
+
+__ALIGN_BEGIN static uint8_t Storage_Cbw[STORAGE_PACKET_SIZE] __ALIGN_END;
+__ALIGN_BEGIN static uint8_t Storage_Csw[STORAGE_CSW_LENGTH] __ALIGN_END;
+__ALIGN_BEGIN static uint8_t Storage_Buf[STORAGE_BLOCK_SIZE] __ALIGN_END;
+
+static uint32_t Storage_Tag;
+static uint32_t Storage_Residue;
+static uint8_t Storage_Status;
+static uint32_t Storage_Lba;
+static uint32_t Storage_Blocks;
+static uint8_t Storage_SenseKey;
+static uint8_t Storage_SenseAsc;
+
+static uint32_t Storage_Get32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void Storage_Put32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static void Storage_ArmCbw(USBD_HandleTypeDef *pdev)
+{
+  Storage_State = STORAGE_IDLE;
+  (void)USBD_LL_PrepareReceive(pdev, STORAGE_OUT_EP, Storage_Cbw, STORAGE_PACKET_SIZE);
+}
+
+static void Storage_SendCsw(USBD_HandleTypeDef *pdev)
+{
+  uint32_t signature = STORAGE_CSW_SIGNATURE;
+
+  /* Signature, tag et résidu en petit boutiste */
+  (void)memcpy(&Storage_Csw[0], &signature, 4U);
+  (void)memcpy(&Storage_Csw[4], &Storage_Tag, 4U);
+  (void)memcpy(&Storage_Csw[8], &Storage_Residue, 4U);
+  Storage_Csw[12] = Storage_Status;
+  Storage_State = STORAGE_STATUS;
+  (void)USBD_LL_Transmit(pdev, STORAGE_IN_EP, Storage_Csw, STORAGE_CSW_LENGTH);
+}
+
+static void Storage_Fail(USBD_HandleTypeDef *pdev, uint8_t key, uint8_t asc)
+{
+  Storage_SenseKey = key;
+  Storage_SenseAsc = asc;
+  Storage_Status = STORAGE_CSW_FAILED;
+  if (Storage_Residue == 0U)
+  {
+    Storage_SendCsw(pdev);
+  }
+  else if ((Storage_Cbw[12] & 0x80U) != 0U)
+  {
+    Storage_State = STORAGE_STALLED;
+    (void)USBD_LL_StallEP(pdev, STORAGE_IN_EP);
+  }
+  else
+  {
+    /* L'hôte lève le STALL de l'EP OUT puis lit le CSW déjà en place */
+    (void)USBD_LL_StallEP(pdev, STORAGE_OUT_EP);
+    Storage_SendCsw(pdev);
+  }
+}
+
+/* Réponse courte depuis Storage_Buf, tronquée à la longueur demandée */
+static void Storage_Reply(USBD_HandleTypeDef *pdev, uint32_t len)
+{
+  len = MIN(len, Storage_Residue);
+  Storage_Residue -= len;
+  if (len == 0U)
+  {
+    Storage_SendCsw(pdev);
+    return;
+  }
+  Storage_State = STORAGE_LAST_IN;
+  (void)USBD_LL_Transmit(pdev, STORAGE_IN_EP, Storage_Buf, len);
+}
+
+static void Storage_Transfer(USBD_HandleTypeDef *pdev, const uint8_t *cb, uint8_t in)
+{
+  uint32_t count = Storage_Fops->BlockCount();
+
+  Storage_Lba = Storage_Get32(&cb[2]);
+  Storage_Blocks = ((uint32_t)cb[7] << 8) | cb[8];
+
+  if ((Storage_Lba >= count) || (Storage_Blocks > count - Storage_Lba))
+  {
+    Storage_Fail(pdev, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_ASC_LBA_OUT_OF_RANGE);
+    return;
+  }
+  if ((Storage_Blocks * STORAGE_BLOCK_SIZE != Storage_Residue) || (((Storage_Cbw[12] & 0x80U) != 0U) != in))
+  {
+    /* Hôte et commande en désaccord sur la phase de données */
+    Storage_Fail(pdev, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+    return;
+  }
+  if (Storage_Blocks == 0U)
+  {
+    Storage_SendCsw(pdev);
+  }
+  else if (in)
+  {
+    Storage_State = STORAGE_DATA_IN;
+    (void)USBD_LL_Transmit(pdev, STORAGE_IN_EP, (uint8_t *)Storage_Fops->Read(Storage_Lba), STORAGE_BLOCK_SIZE);
+  }
+  else
+  {
+    Storage_State = STORAGE_DATA_OUT;
+    (void)USBD_LL_PrepareReceive(pdev, STORAGE_OUT_EP, Storage_Buf, STORAGE_BLOCK_SIZE);
+  }
+}
+
+static void Storage_Command(USBD_HandleTypeDef *pdev)
+{
+  const uint8_t *cb = &Storage_Cbw[15];
+  uint32_t count = Storage_Fops->BlockCount();
+
+  (void)memcpy(&Storage_Tag, &Storage_Cbw[4], 4U);
+  (void)memcpy(&Storage_Residue, &Storage_Cbw[8], 4U);
+  Storage_Status = STORAGE_CSW_PASSED;
+  (void)memset(Storage_Buf, 0, 36U);
+
+  switch (cb[0])
+  {
+    case SCSI_TEST_UNIT_READY:
+    case SCSI_PREVENT_ALLOW:
+    case SCSI_START_STOP_UNIT:
+    case SCSI_VERIFY10:
+      Storage_Reply(pdev, 0U);
+      break;
+
+    case SCSI_REQUEST_SENSE:
+      Storage_Buf[0] = 0x70;              /* Erreur courante, format fixe */
+      Storage_Buf[2] = Storage_SenseKey;
+      Storage_Buf[7] = 10U;
+      Storage_Buf[12] = Storage_SenseAsc;
+      Storage_SenseKey = 0U;
+      Storage_SenseAsc = 0U;
+      Storage_Reply(pdev, 18U);
+      break;
+
+    case SCSI_INQUIRY:
+      if ((cb[1] & 0x01U) != 0U)
+      {
+        /* Pas de pages VPD */
+        Storage_Fail(pdev, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+        break;
+      }
+      (void)memcpy(Storage_Buf, Storage_Inquiry, sizeof(Storage_Inquiry));
+      Storage_Reply(pdev, sizeof(Storage_Inquiry));
+      break;
+
+    case SCSI_MODE_SENSE6:
+      /* En-tête seul : pas de page, pas de protection en écriture */
+      Storage_Buf[0] = 0x03;
+      Storage_Reply(pdev, 4U);
+      break;
+
+    case SCSI_MODE_SENSE10:
+      Storage_Buf[1] = 0x06;
+      Storage_Reply(pdev, 8U);
+      break;
+
+    case SCSI_READ_FORMAT_CAPACITIES:
+      Storage_Buf[3] = 0x08;              /* Longueur de la liste */
+      Storage_Put32(&Storage_Buf[4], count);
+      Storage_Buf[8] = 0x02;              /* Support formaté */
+      Storage_Buf[10] = HIBYTE(STORAGE_BLOCK_SIZE);
+      Storage_Buf[11] = LOBYTE(STORAGE_BLOCK_SIZE);
+      Storage_Reply(pdev, 12U);
+      break;
+
+    case SCSI_READ_CAPACITY10:
+      Storage_Put32(&Storage_Buf[0], count - 1U);
+      Storage_Put32(&Storage_Buf[4], STORAGE_BLOCK_SIZE);
+      Storage_Reply(pdev, 8U);
+      break;
+
+    case SCSI_READ10:
+      Storage_Transfer(pdev, cb, 1U);
+      break;
+
+    case SCSI_WRITE10:
+      Storage_Transfer(pdev, cb, 0U);
+      break;
+
+    default:
+      Storage_Fail(pdev, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_ASC_INVALID_COMMAND);
+      break;
+  }
+}
+
+void USBD_Storage_Register(USBD_Storage_ItfTypeDef *fops)
+{
+  Storage_Fops = fops;
+}
+
+void USBD_Storage_Init(USBD_HandleTypeDef *pdev)
+{
+  (void)USBD_LL_OpenEP(pdev, STORAGE_OUT_EP, USBD_EP_TYPE_BULK, STORAGE_PACKET_SIZE);
+  pdev->ep_out[STORAGE_OUT_EP & 0xFU].is_used = 1U;
+  (void)USBD_LL_OpenEP(pdev, STORAGE_IN_EP, USBD_EP_TYPE_BULK, STORAGE_PACKET_SIZE);
+  pdev->ep_in[STORAGE_IN_EP & 0xFU].is_used = 1U;
+  Storage_SenseKey = 0U;
+  Storage_SenseAsc = 0U;
+  Storage_ArmCbw(pdev);
+}
+
+void USBD_Storage_DeInit(USBD_HandleTypeDef *pdev)
+{
+  (void)USBD_LL_CloseEP(pdev, STORAGE_OUT_EP);
+  pdev->ep_out[STORAGE_OUT_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, STORAGE_IN_EP);
+  pdev->ep_in[STORAGE_IN_EP & 0xFU].is_used = 0U;
+  Storage_State = STORAGE_IDLE;
+}
+
+uint8_t USBD_Storage_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+  static uint8_t max_lun = 0U;
+
+  if ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_CLASS)
+  {
+    switch (req->bRequest)
+    {
+      case STORAGE_REQ_GET_MAX_LUN:
+        (void)USBD_CtlSendData(pdev, &max_lun, 1U);
+        return (uint8_t)USBD_OK;
+
+      case STORAGE_REQ_RESET:
+        /* Les STALL sont levés ensuite par l'hôte (CLEAR_FEATURE) */
+        Storage_ArmCbw(pdev);
+        (void)USBD_CtlSendStatus(pdev);
+        return (uint8_t)USBD_OK;
+
+      default:
+        USBD_CtlError(pdev, req);
+        return (uint8_t)USBD_FAIL;
+    }
+  }
+
+  /* CLEAR_FEATURE(ENDPOINT_HALT), STALL déjà levé par la bibliothèque */
+  if ((req->bRequest == USB_REQ_CLEAR_FEATURE) && (req->wValue == USB_FEATURE_EP_HALT))
+  {
+    if (Storage_State == STORAGE_ERROR)
+    {
+      /* Seul le Reset débloque après un CBW invalide */
+      (void)USBD_LL_StallEP(pdev, LOBYTE(req->wIndex));
+    }
+    else if ((Storage_State == STORAGE_STALLED) && (LOBYTE(req->wIndex) == STORAGE_IN_EP))
+    {
+      Storage_SendCsw(pdev);
+    }
+  }
+  return (uint8_t)USBD_OK;
+}
+
+void USBD_Storage_DataIn(USBD_HandleTypeDef *pdev)
+{
+  switch (Storage_State)
+  {
+    case STORAGE_DATA_IN:
+      Storage_Residue -= STORAGE_BLOCK_SIZE;
+      Storage_Lba++;
+      if (--Storage_Blocks > 0U)
+      {
+        (void)USBD_LL_Transmit(pdev, STORAGE_IN_EP, (uint8_t *)Storage_Fops->Read(Storage_Lba), STORAGE_BLOCK_SIZE);
+      }
+      else
+      {
+        Storage_SendCsw(pdev);
+      }
+      break;
+
+    case STORAGE_LAST_IN:
+      Storage_SendCsw(pdev);
+      break;
+
+    case STORAGE_STATUS:
+      Storage_ArmCbw(pdev);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void USBD_Storage_DataOut(USBD_HandleTypeDef *pdev)
+{
+  uint32_t signature;
+
+  switch (Storage_State)
+  {
+    case STORAGE_IDLE:
+      (void)memcpy(&signature, Storage_Cbw, 4U);
+      if ((USBD_LL_GetRxDataSize(pdev, STORAGE_OUT_EP) != STORAGE_CBW_LENGTH) || (signature != STORAGE_CBW_SIGNATURE)
+          || (Storage_Cbw[13] != 0U) || (Storage_Cbw[14] == 0U) || (Storage_Cbw[14] > 16U))
+      {
+        Storage_State = STORAGE_ERROR;
+        (void)USBD_LL_StallEP(pdev, STORAGE_IN_EP);
+        (void)USBD_LL_StallEP(pdev, STORAGE_OUT_EP);
+        break;
+      }
+      Storage_Command(pdev);
+      break;
+
+    case STORAGE_DATA_OUT:
+      if ((Storage_Fops->Write(Storage_Lba, Storage_Buf) != 0) && (Storage_Status == STORAGE_CSW_PASSED))
+      {
+        /* Les secteurs suivants sont tout de même acceptés */
+        Storage_Status = STORAGE_CSW_FAILED;
+        Storage_SenseKey = SCSI_SENSE_MEDIUM_ERROR;
+        Storage_SenseAsc = SCSI_ASC_WRITE_FAULT;
+      }
+      Storage_Residue -= STORAGE_BLOCK_SIZE;
+      Storage_Lba++;
+      if (--Storage_Blocks > 0U)
+      {
+        (void)USBD_LL_PrepareReceive(pdev, STORAGE_OUT_EP, Storage_Buf, STORAGE_BLOCK_SIZE);
+      }
+      else
+      {
+        Storage_SendCsw(pdev);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    usbd_storage.h
+  * @brief   Interface de stockage de masse de la fonction composite
+  *          (interface 3, EP 0x04 / 0x84) : transport Bulk-Only et jeu de
+  *          commandes SCSI transparent réduit à ce qu'attendent Windows,
+  *          macOS et Linux pour un volume amovible d'un seul LUN.
+  *
+  *          Les secteurs sont fournis par l'application : la lecture rend un
+  *          pointeur (la flash est envoyée sans copie), l'écriture reçoit
+  *          chaque secteur dès sa réception.
+  ******************************************************************************
+  */
+#ifndef __USBD_STORAGE_H__
+#define __USBD_STORAGE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "usbd_ioreq.h"
+
+#define STORAGE_ITF                     0x03U
+#define STORAGE_OUT_EP                  0x04U
+#define STORAGE_IN_EP                   0x84U
+#define STORAGE_PACKET_SIZE             64U
+#define STORAGE_BLOCK_SIZE              512U
+#define STORAGE_DESC_SIZ                23U
+
+/**
+ * @brief  Callbacks de l'application pour le volume
+ */
+typedef struct
+{
+  uint32_t (*BlockCount)(void);                         /*!< Nombre de secteurs */
+  const uint8_t *(*Read)(uint32_t lba);                 /*!< Secteur, valable jusqu'à la lecture suivante */
+  int8_t (*Write)(uint32_t lba, const uint8_t *buf);    /*!< Secteur reçu */
+} USBD_Storage_ItfTypeDef;
+
+extern const uint8_t USBD_Storage_Desc[STORAGE_DESC_SIZ];
+
+/**
+ * @brief  Enregistre les callbacks du volume
+ * @param  fops: callbacks
+ * @retval None
+ */
+void USBD_Storage_Register(USBD_Storage_ItfTypeDef *fops);
+
+/**
+ * @brief  Ouvre les points de terminaison et attend le premier CBW
+ * @param  pdev: instance du périphérique
+ * @retval None
+ */
+void USBD_Storage_Init(USBD_HandleTypeDef *pdev);
+
+/**
+ * @brief  Ferme les points de terminaison
+ * @param  pdev: instance du périphérique
+ * @retval None
+ */
+void USBD_Storage_DeInit(USBD_HandleTypeDef *pdev);
+
+/**
+ * @brief  Requêtes de classe (Reset, Get Max LUN) et fin de STALL sur l'EP IN
+ * @param  pdev: instance du périphérique
+ * @param  req: requête
+ * @retval USBD_OK ou USBD_FAIL
+ */
+uint8_t USBD_Storage_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+
+/**
+ * @brief  Fin d'émission sur STORAGE_IN_EP
+ * @param  pdev: instance du périphérique
+ * @retval None
+ */
+void USBD_Storage_DataIn(USBD_HandleTypeDef *pdev);
+
+/**
+ * @brief  Fin de réception sur STORAGE_OUT_EP
+ * @param  pdev: instance du périphérique
+ * @retval None
+ */
+void USBD_Storage_DataOut(USBD_HandleTypeDef *pdev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_STORAGE_H__ */
@@ -0,0 +1,514 @@
+/**
+  ******************************************************************************
+  * @file    bulk_test.c
+  * @brief   Essai sur PC des commandes de l'interface vendeur (bulk.h).
+  *
+  *          bulk.c et show.c sont compilés tels quels avec ce fichier ; les
+  *          en-têtes de stubs/ remplacent la HAL et la pile USB. La
+  *          réception armée par Bulk_Arm et les réponses de
+  *          USBD_Composite_VendorTransmit sont simulées ici, la flash du
+  *          spectacle est un tableau en RAM : chaque commande passe par
+  *          Bulk_Receive puis Bulk_Process, comme sur la carte.
+  *
+  *          Depuis la racine du dépôt :
+  *            gcc -std=c11 -Wall -Wextra -I tools/bulk_test/stubs -I Core/Inc \
+  *                -o bulk_test tools/bulk_test/bulk_test.c && ./bulk_test
+  *
+  *          Code de sortie 0 si toutes les vérifications passent.
+  ******************************************************************************
+  */
+#include "main.h"
+#include "tim.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Modules testés : les en-têtes de stubs/ masquent ceux de la carte */
+#include "../../Core/Src/bulk.c"
+#include "../../Core/Src/show.c"
+
+#define CHECK(cond) Test_Check((cond), #cond, __LINE__)
+
+static unsigned Test_Failures;
+static unsigned Test_Checks;
+
+static void Test_Check(int ok, const char *what, int line)
+{
+	Test_Checks++;
+	if (!ok) {
+		Test_Failures++;
+		printf("bulk_test.c:%d: échec : %s\n", line, what);
+	}
+}
+
+/* Interface vendeur simulée ------------------------------------------------*/
+
+USBD_HandleTypeDef hUsbDeviceFS;
+
+static uint8_t *Usb_RxBuf;
+static uint16_t Usb_RxSize;
+static uint32_t Usb_Armed;
+static uint8_t Usb_Tx[256];
+static uint16_t Usb_TxLen;
+static uint32_t Usb_Sent;
+
+uint8_t USBD_Composite_VendorReceive(USBD_HandleTypeDef *pdev, uint8_t *buf, uint16_t len)
+{
+	UNUSED(pdev);
+	Usb_RxBuf = buf;
+	Usb_RxSize = len;
+	Usb_Armed++;
+	return USBD_OK;
+}
+
+uint8_t USBD_Composite_VendorTransmit(USBD_HandleTypeDef *pdev, uint8_t *buf, uint16_t len)
+{
+	UNUSED(pdev);
+	if (len > sizeof(Usb_Tx)) {
+		return USBD_FAIL;
+	}
+	memcpy(Usb_Tx, buf, len);
+	Usb_TxLen = len;
+	Usb_Sent++;
+	return USBD_OK;
+}
+
+/* Transfert OUT puis traitement ; retourne la taille de la réponse, 0 sans */
+static uint16_t Usb_Transfer(const uint8_t *pkt, uint32_t len)
+{
+	uint32_t armed = Usb_Armed;
+	uint32_t sent = Usb_Sent;
+
+	CHECK(Usb_RxBuf != NULL && len <= Usb_RxSize);
+	if (Usb_RxBuf == NULL || len > Usb_RxSize) {
+		return 0;
+	}
+	memcpy(Usb_RxBuf, pkt, len);
+	Bulk_fops.Receive(Usb_RxBuf, len);
+	Bulk_Process();
+	/* Chaque commande réarme la réception, une seule fois */
+	CHECK(Usb_Armed == armed + 1U);
+	return (Usb_Sent != sent) ? Usb_TxLen : 0U;
+}
+
+/* Modules de la carte simulés ----------------------------------------------*/
+
+static uint32_t Test_Tick = 123456U;
+static uint8_t Test_DmxPresent[2];
+static Host_Stats_t Test_Host;
+static Clock_Stats_t Test_ClockStats;
+static Watchdog_Report_t Test_WatchdogNow;
+static Watchdog_Report_t Test_WatchdogLast;
+static uint8_t Test_WatchdogLastValid;
+static Latency_Stats_t Test_LatencyStats;
+static uint8_t Test_LatencyMode;
+static uint32_t Test_LatencySets;
+static Audio_Stats_t Test_Audio;
+static uint8_t Test_Recording;
+static uint8_t Test_Playing;
+static uint8_t Test_RecordFailed;
+
+static uint8_t Test_MergeSrc;
+static uint8_t Test_MergeSlots[DMX_UNIVERSE_SIZE];
+static uint16_t Test_MergeLength;
+static uint32_t Test_MergeCalls;
+
+uint32_t HAL_GetTick(void) { return Test_Tick; }
+uint8_t Output_GetSource(void) { return 2U; }
+uint8_t Dmx_IsPresent(uint8_t line) { return Test_DmxPresent[line]; }
+uint8_t Sync_GetState(void) { return 1U; }
+uint32_t Tempo_GetBPMx10(void) { return 1285U; }
+uint32_t Merge_GetHash(void) { return 0xCAFEF00DU; }
+const Host_Stats_t *Host_GetStats(void) { return &Test_Host; }
+int16_t Sensor_GetTemperature(void) { return -125; }
+uint16_t Sensor_GetVdda(void) { return 3297U; }
+uint32_t Sensor_GetDerate(void) { return 49152U; }
+const Audio_Stats_t *Audio_GetStats(void) { return &Test_Audio; }
+uint8_t Clock_GetProfile(void) { return CLOCK_PROFILE_ECO; }
+const Clock_Stats_t *Clock_GetStats(void) { return &Test_ClockStats; }
+const Watchdog_Report_t *Watchdog_GetReport(void) { return &Test_WatchdogNow; }
+const Watchdog_Report_t *Watchdog_GetLast(void) { return Test_WatchdogLastValid ? &Test_WatchdogLast : NULL; }
+uint8_t Latency_GetMode(void) { return Test_LatencyMode; }
+const Latency_Stats_t *Latency_GetStats(void) { return &Test_LatencyStats; }
+uint8_t Record_IsRecording(void) { return Test_Recording; }
+uint8_t Record_IsPlaying(void) { return Test_Playing; }
+uint8_t Record_HasFailed(void) { return Test_RecordFailed; }
+
+void Latency_SetMode(uint8_t mode)
+{
+	Test_LatencyMode = mode;
+	Test_LatencySets++;
+}
+
+void Merge_Submit(uint8_t src, const uint8_t *slots, uint16_t length)
+{
+	Test_MergeSrc = src;
+	memcpy(Test_MergeSlots, slots, length);
+	Test_MergeLength = length;
+	Test_MergeCalls++;
+}
+
+/* Flash du spectacle : SHOW_SIZE octets en RAM, contrôles de la L412 */
+static uint8_t Test_Flash[SHOW_SIZE];
+static uint32_t Test_Erases;
+static uint32_t Test_FlashErrors;
+static HAL_StatusTypeDef Test_FlashStatus = HAL_OK;     /* Echec simulé */
+
+HAL_StatusTypeDef Flash_ErasePage(uint32_t addr)
+{
+	if (Test_FlashStatus != HAL_OK) {
+		return Test_FlashStatus;
+	}
+	if (addr < SHOW_BASE || addr >= SHOW_BASE + SHOW_SIZE || (addr - SHOW_BASE) % FLASH_PAGE_SIZE != 0U) {
+		Test_FlashErrors++;
+		return HAL_ERROR;
+	}
+	memset(&Test_Flash[addr - SHOW_BASE], 0xFF, FLASH_PAGE_SIZE);
+	Test_Erases++;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef Flash_Program(uint32_t addr, const void *data, uint32_t len)
+{
+	static const uint8_t erased[FLASH_DWORD_SIZE] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	const uint8_t *src = data;
+	uint8_t *dst;
+
+	if (Test_FlashStatus != HAL_OK) {
+		return Test_FlashStatus;
+	}
+	if (addr < SHOW_BASE || addr + len > SHOW_BASE + SHOW_SIZE || (addr % FLASH_DWORD_SIZE) != 0U
+			|| (len % FLASH_DWORD_SIZE) != 0U) {
+		Test_FlashErrors++;
+		return HAL_ERROR;
+	}
+	for (dst = &Test_Flash[addr - SHOW_BASE]; len != 0U; len -= FLASH_DWORD_SIZE) {
+		if (memcmp(src, erased, FLASH_DWORD_SIZE) != 0) {
+			/* Un double-mot ne se programme qu'une fois après effacement */
+			if (memcmp(dst, erased, FLASH_DWORD_SIZE) != 0) {
+				Test_FlashErrors++;
+				return HAL_ERROR;
+			}
+			memcpy(dst, src, FLASH_DWORD_SIZE);
+		}
+		dst += FLASH_DWORD_SIZE;
+		src += FLASH_DWORD_SIZE;
+	}
+	return HAL_OK;
+}
+
+/* Codage des commandes côté hôte -------------------------------------------*/
+
+static uint16_t Host_Get16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t Host_Get32(const uint8_t *p) { return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static void Host_Put32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+/* Univers : 0xB0 0 len_l len_h + canaux */
+static uint32_t Host_EncodeUniverse(uint8_t *pkt, const uint8_t *slots, uint16_t n, uint16_t announced)
+{
+	pkt[0] = BULK_PKT_UNIVERSE;
+	pkt[1] = 0;
+	pkt[2] = (uint8_t)announced;
+	pkt[3] = (uint8_t)(announced >> 8);
+	memcpy(&pkt[BULK_UNIVERSE_HEADER], slots, n);
+	return BULK_UNIVERSE_HEADER + n;
+}
+
+/* Morceau de spectacle : 0xB5 0 off_l off_h + données */
+static uint32_t Host_EncodeShow(uint8_t *pkt, uint16_t offset, const uint8_t *data, uint32_t n)
+{
+	pkt[0] = BULK_PKT_SHOW;
+	pkt[1] = 0;
+	pkt[2] = (uint8_t)offset;
+	pkt[3] = (uint8_t)(offset >> 8);
+	memcpy(&pkt[BULK_SHOW_HEADER], data, n);
+	return BULK_SHOW_HEADER + n;
+}
+
+/* Fichier de spectacle : en-tête SHW1 + motif, complété à 8 octets */
+static uint32_t Host_MakeShow(uint8_t *file, uint32_t length)
+{
+	uint32_t i, padded = (length + 7U) & ~7U;
+
+	Host_Put32(&file[0], SHOW_MAGIC);
+	Host_Put32(&file[4], length);
+	for (i = 8; i < padded; i++) {
+		file[i] = (i < length) ? (uint8_t)(i * 7U + 3U) : 0xFFU;
+	}
+	return padded;
+}
+
+/* Envoie un morceau et décode l'accusé ; retourne l'état */
+static uint8_t Host_SendShow(uint16_t offset, const uint8_t *data, uint32_t n, uint32_t *next)
+{
+	uint8_t pkt[BULK_RX_SIZE];
+	uint16_t len = Usb_Transfer(pkt, Host_EncodeShow(pkt, offset, data, n));
+
+	CHECK(len == 8U);
+	CHECK(Usb_Tx[0] == BULK_PKT_SHOW);
+	if (next != NULL) {
+		*next = Host_Get32(&Usb_Tx[4]);
+	}
+	return Usb_Tx[1];
+}
+
+/* Essais --------------------------------------------------------------------*/
+
+static void Test_Layout(void)
+{
+	/* Format sur le bus, indépendant du compilateur */
+	CHECK(sizeof(Bulk_Show_t) == 8U);
+	CHECK(offsetof(Bulk_Show_t, next) == 4U);
+	CHECK(offsetof(Bulk_Latency_t, latency) == 4U);
+	CHECK(sizeof(Bulk_Latency_t) == 4U + 6U * 4U);
+	CHECK(offsetof(Bulk_Telemetry_t, uptime_ms) == 4U);
+	CHECK(offsetof(Bulk_Clock_t, clock) == 4U);
+	CHECK(offsetof(Bulk_Watchdog_t, now) == 4U);
+	CHECK(BULK_RX_SIZE % COMPOSITE_VENDOR_PACKET_SIZE == 0U);
+	CHECK(BULK_RX_SIZE >= BULK_UNIVERSE_HEADER + DMX_UNIVERSE_SIZE);
+}
+
+static void Test_Universe(void)
+{
+	uint8_t pkt[BULK_RX_SIZE];
+	uint8_t slots[DMX_UNIVERSE_SIZE];
+	uint16_t i;
+
+	for (i = 0; i < DMX_UNIVERSE_SIZE; i++) {
+		slots[i] = (uint8_t)(255U - i);
+	}
+
+	/* Univers complet : soumis à la fusion comme source hôte, sans réponse */
+	CHECK(Usb_Transfer(pkt, Host_EncodeUniverse(pkt, slots, DMX_UNIVERSE_SIZE, DMX_UNIVERSE_SIZE)) == 0U);
+	CHECK(Test_MergeCalls == 1U);
+	CHECK(Test_MergeSrc == MERGE_SRC_HOST);
+	CHECK(Test_MergeLength == DMX_UNIVERSE_SIZE);
+	CHECK(memcmp(Test_MergeSlots, slots, DMX_UNIVERSE_SIZE) == 0);
+
+	/* Longueur annoncée au-delà du transfert : limitée aux canaux reçus */
+	Usb_Transfer(pkt, Host_EncodeUniverse(pkt, slots, 3, 300));
+	CHECK(Test_MergeCalls == 2U);
+	CHECK(Test_MergeLength == 3U);
+	CHECK(Test_MergeSlots[0] == 255U && Test_MergeSlots[2] == 253U);
+
+	/* Longueur annoncée plus courte : le reste du transfert est ignoré */
+	Usb_Transfer(pkt, Host_EncodeUniverse(pkt, slots, 64, 10));
+	CHECK(Test_MergeLength == 10U);
+
+	/* En-tête tronqué : rien n'est soumis */
+	Usb_Transfer(pkt, 3);
+	CHECK(Test_MergeCalls == 3U);
+}
+
+static void Test_Telemetry(void)
+{
+	uint8_t cmd = BULK_PKT_TELEMETRY;
+	uint16_t len;
+
+	Test_DmxPresent[0] = 0;
+	Test_DmxPresent[1] = 1;
+	Test_Host.frames = 77U;
+	Test_Audio.busy_us = 210U;
+	Test_Audio.overruns = 0x12345U;
+	Test_RecordFailed = 1;
+
+	len = Usb_Transfer(&cmd, 1);
+	CHECK(len == sizeof(Bulk_Telemetry_t));
+	CHECK(Usb_Tx[0] == BULK_PKT_TELEMETRY);
+	CHECK(Usb_Tx[1] == 2U);
+	CHECK(Usb_Tx[2] == 0x02U);
+	CHECK(Usb_Tx[3] == 1U);
+	CHECK(Host_Get32(&Usb_Tx[offsetof(Bulk_Telemetry_t, uptime_ms)]) == Test_Tick);
+	CHECK(Host_Get32(&Usb_Tx[offsetof(Bulk_Telemetry_t, bpm_x10)]) == 1285U);
+	CHECK(Host_Get32(&Usb_Tx[offsetof(Bulk_Telemetry_t, merge_hash)]) == 0xCAFEF00DU);
+	CHECK(Host_Get32(&Usb_Tx[offsetof(Bulk_Telemetry_t, host) + offsetof(Host_Stats_t, frames)]) == 77U);
+	CHECK((int16_t)Host_Get16(&Usb_Tx[offsetof(Bulk_Telemetry_t, temperature)]) == -125);
+	CHECK(Host_Get16(&Usb_Tx[offsetof(Bulk_Telemetry_t, vdda_mv)]) == 3297U);
+	CHECK(Host_Get32(&Usb_Tx[offsetof(Bulk_Telemetry_t, derate)]) == 49152U);
+	CHECK(Host_Get16(&Usb_Tx[offsetof(Bulk_Telemetry_t, audio_us)]) == 210U);
+	CHECK(Host_Get16(&Usb_Tx[offsetof(Bulk_Telemetry_t, audio_lost)]) == 0x2345U);
+	CHECK(Usb_Tx[offsetof(Bulk_Telemetry_t, record)] == 0x04U);
+	Test_RecordFailed = 0;
+}
+
+static void Test_Clock(void)
+{
+	uint8_t cmd = BULK_PKT_CLOCK;
+
+	Test_ClockStats.switches = 9U;
+	Test_ClockStats.latency_max_us[CLOCK_PROFILE_ECO] = 41U;
+	CHECK(Usb_Transfer(&cmd, 1) == sizeof(Bulk_Clock_t));
+	CHECK(Usb_Tx[0] == BULK_PKT_CLOCK);
+	CHECK(Usb_Tx[1] == CLOCK_PROFILE_ECO);
+	CHECK(Host_Get32(&Usb_Tx[4 + offsetof(Clock_Stats_t, switches)]) == 9U);
+	CHECK(Host_Get16(&Usb_Tx[4 + offsetof(Clock_Stats_t, latency_max_us) + 2U * CLOCK_PROFILE_ECO]) == 41U);
+}
+
+static void Test_Watchdog(void)
+{
+	uint8_t cmd = BULK_PKT_WATCHDOG;
+	uint32_t last = offsetof(Bulk_Watchdog_t, last);
+
+	Test_WatchdogNow.uptime_ms = 1000U;
+	Test_WatchdogLast.late = 1U << WATCHDOG_TASK_DISPLAY;
+	Test_WatchdogLast.uptime_ms = 5000U;
+
+	/* Pas de reset IWDG : relevé précédent à zéro */
+	Test_WatchdogLastValid = 0;
+	CHECK(Usb_Transfer(&cmd, 1) == sizeof(Bulk_Watchdog_t));
+	CHECK(Usb_Tx[0] == BULK_PKT_WATCHDOG && Usb_Tx[1] == 0U);
+	CHECK(Host_Get32(&Usb_Tx[4 + offsetof(Watchdog_Report_t, uptime_ms)]) == 1000U);
+	CHECK(Host_Get32(&Usb_Tx[last + offsetof(Watchdog_Report_t, late)]) == 0U);
+
+	Test_WatchdogLastValid = 1;
+	Usb_Transfer(&cmd, 1);
+	CHECK(Usb_Tx[1] == 1U);
+	CHECK(Host_Get32(&Usb_Tx[last + offsetof(Watchdog_Report_t, late)]) == (1U << WATCHDOG_TASK_DISPLAY));
+	CHECK(Host_Get32(&Usb_Tx[last + offsetof(Watchdog_Report_t, uptime_ms)]) == 5000U);
+}
+
+static void Test_Latency(void)
+{
+	uint8_t cmd[2] = { BULK_PKT_LATENCY, LATENCY_MARKER };
+
+	Test_LatencyStats.count = 500U;
+	Test_LatencyStats.p99_us = 1900U;
+	Test_LatencyStats.max_us = 2350U;
+
+	/* Sans octet de mode : lecture seule */
+	CHECK(Usb_Transfer(cmd, 1) == sizeof(Bulk_Latency_t));
+	CHECK(Test_LatencySets == 0U);
+	CHECK(Usb_Tx[0] == BULK_PKT_LATENCY && Usb_Tx[1] == LATENCY_OFF);
+	CHECK(Host_Get32(&Usb_Tx[4 + offsetof(Latency_Stats_t, count)]) == 500U);
+	CHECK(Host_Get32(&Usb_Tx[4 + offsetof(Latency_Stats_t, p99_us)]) == 1900U);
+	CHECK(Host_Get32(&Usb_Tx[4 + offsetof(Latency_Stats_t, max_us)]) == 2350U);
+
+	/* Avec mode : appliqué avant la réponse */
+	CHECK(Usb_Transfer(cmd, 2) == sizeof(Bulk_Latency_t));
+	CHECK(Test_LatencySets == 1U);
+	CHECK(Usb_Tx[1] == LATENCY_MARKER);
+}
+
+static void Test_Show(void)
+{
+	static uint8_t file[SHOW_SIZE];
+	uint32_t size, offset, next, n;
+	uint8_t status = BULK_SHOW_OK;
+
+	memset(Test_Flash, 0, sizeof(Test_Flash));
+
+	/* Morceau hors écriture ouverte : refusé, flash intacte */
+	CHECK(Host_SendShow(64, file, 64, &next) == BULK_SHOW_REJECTED);
+	CHECK(next == 64U);
+	CHECK(Test_Erases == 0U);
+
+	/* Spectacle de trois pages, envoyé par morceaux de 512 octets */
+	size = Host_MakeShow(file, 5000U);
+	for (offset = 0; offset < size; offset += n) {
+		n = (size - offset > 512U) ? 512U : size - offset;
+		status = Host_SendShow((uint16_t)offset, &file[offset], n, &next);
+		CHECK(next == offset + n);
+		if (offset == 0U) {
+			/* L'en-tête n'est programmé qu'à la fin */
+			CHECK(Host_Get32(&Test_Flash[0]) == 0xFFFFFFFFU);
+		} else if (offset == 512U) {
+			/* Morceau répété : ignoré sans reprogrammer (Flash_Program le relèverait) */
+			CHECK(Host_SendShow((uint16_t)offset, &file[offset], n, NULL) == BULK_SHOW_OK);
+		}
+		if (offset + n < size) {
+			CHECK(status == BULK_SHOW_OK);
+		}
+	}
+	CHECK(status == BULK_SHOW_DONE);
+	CHECK(Test_Erases == 3U);
+	CHECK(Test_FlashErrors == 0U);
+	CHECK(memcmp(Test_Flash, file, size) == 0);
+	CHECK(Show_IsValid((const Show_Header_t *)Test_Flash));
+
+	/* Ecriture terminée : un morceau isolé est refusé */
+	CHECK(Host_SendShow(512, &file[512], 512, NULL) == BULK_SHOW_REJECTED);
+
+	/* Taille qui n'est pas un multiple de 8 */
+	CHECK(Host_SendShow(0, file, 12, NULL) == BULK_SHOW_REJECTED);
+
+	/* Enregistreur occupé : refusé, l'envoi est à reprendre depuis 0 */
+	size = Host_MakeShow(file, 24U);
+	Test_Recording = 1;
+	CHECK(Host_SendShow(0, file, size, NULL) == BULK_SHOW_REJECTED);
+	Test_Recording = 0;
+	Test_Playing = 1;
+	CHECK(Host_SendShow(0, file, size, NULL) == BULK_SHOW_REJECTED);
+	Test_Playing = 0;
+
+	/* Petit spectacle d'un seul morceau */
+	CHECK(Host_SendShow(0, file, size, &next) == BULK_SHOW_DONE);
+	CHECK(next == size);
+	CHECK(memcmp(Test_Flash, file, size) == 0);
+	CHECK(Test_FlashErrors == 0U);
+
+	/* Un nouveau morceau 0 recommence l'écriture, page effacée à nouveau */
+	size = Host_MakeShow(file, 40U);
+	CHECK(Host_SendShow(0, file, 16, NULL) == BULK_SHOW_OK);
+	CHECK(Host_SendShow(0, file, 16, NULL) == BULK_SHOW_OK);
+	CHECK(Host_SendShow(16, &file[16], size - 16U, NULL) == BULK_SHOW_DONE);
+	CHECK(memcmp(Test_Flash, file, size) == 0);
+	CHECK(Test_FlashErrors == 0U);
+
+	/* Morceau après un trou : refusé, le fichier n'est jamais scellé */
+	size = Host_MakeShow(file, 40U);
+	CHECK(Host_SendShow(0, file, 16, NULL) == BULK_SHOW_OK);
+	CHECK(Host_SendShow(24, &file[24], size - 24U, &next) == BULK_SHOW_REJECTED);
+	CHECK(next == 24U);
+	CHECK(Host_SendShow(16, &file[16], 8, NULL) == BULK_SHOW_REJECTED);
+	CHECK(!Show_IsValid((const Show_Header_t *)Test_Flash));
+	CHECK(Host_SendShow(0, file, size, NULL) == BULK_SHOW_DONE);
+	CHECK(memcmp(Test_Flash, file, size) == 0);
+
+	/* Flash occupée en cours d'envoi : refusé, la suite aussi jusqu'au morceau 0 */
+	size = Host_MakeShow(file, 40U);
+	CHECK(Host_SendShow(0, file, 16, NULL) == BULK_SHOW_OK);
+	Test_FlashStatus = HAL_BUSY;
+	CHECK(Host_SendShow(16, &file[16], 8, &next) == BULK_SHOW_REJECTED);
+	CHECK(next == 16U);
+	Test_FlashStatus = HAL_OK;
+	CHECK(Host_SendShow(24, &file[24], size - 24U, NULL) == BULK_SHOW_REJECTED);
+	CHECK(Host_SendShow(0, file, size, NULL) == BULK_SHOW_DONE);
+	CHECK(memcmp(Test_Flash, file, size) == 0);
+	CHECK(Test_FlashErrors == 0U);
+}
+
+static void Test_Unknown(void)
+{
+	uint8_t cmd[4] = { 0xAAU, 1, 2, 3 };
+	uint32_t merges = Test_MergeCalls;
+
+	/* Commande inconnue ou transfert vide : ignorés, réception réarmée */
+	CHECK(Usb_Transfer(cmd, sizeof(cmd)) == 0U);
+	CHECK(Usb_Transfer(cmd, 0) == 0U);
+	CHECK(Test_MergeCalls == merges);
+}
+
+int main(void)
+{
+	/* Configuration choisie par l'hôte : première réception armée */
+	Bulk_fops.Init();
+	CHECK(Usb_Armed == 1U && Usb_RxSize == BULK_RX_SIZE);
+
+	Test_Layout();
+	Test_Universe();
+	Test_Telemetry();
+	Test_Clock();
+	Test_Watchdog();
+	Test_Latency();
+	Test_Show();
+	Test_Unknown();
+
+	printf("bulk_test : %u vérifications, %u échecs\n", Test_Checks, Test_Failures);
+	return (Test_Failures == 0U) ? 0 : 1;
+}
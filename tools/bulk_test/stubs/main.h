@@ -0,0 +1,34 @@
+/**
+  ******************************************************************************
+  * @file    main.h
+  * @brief   Remplaçant hôte de main.h pour tools/bulk_test : types et macros
+  *          de la HAL utilisés par bulk.c et show.c.
+  ******************************************************************************
+  */
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+	HAL_OK = 0,
+	HAL_ERROR,
+	HAL_BUSY,
+	HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+/* Périphériques nommés par les en-têtes, jamais utilisés ici */
+typedef struct { uint32_t unused; } UART_HandleTypeDef;
+typedef struct { uint32_t unused; } DMA_HandleTypeDef;
+typedef struct { uint32_t unused; } TIM_HandleTypeDef;
+
+#define UNUSED(x)               ((void)(x))
+#define __disable_irq()         ((void)0)
+#define __enable_irq()          ((void)0)
+
+#define FLASH_PAGE_SIZE         0x800U
+
+uint32_t HAL_GetTick(void);
+
+#endif /* __MAIN_H */
@@ -0,0 +1,13 @@
+/**
+  ******************************************************************************
+  * @file    tim.h
+  * @brief   Remplaçant hôte de tim.h pour tools/bulk_test (inclus par
+  *          tempo.h, aucun timer n'est utilisé).
+  ******************************************************************************
+  */
+#ifndef __TIM_H__
+#define __TIM_H__
+
+#include "main.h"
+
+#endif /* __TIM_H__ */
@@ -0,0 +1,12 @@
+/**
+  ******************************************************************************
+  * @file    usb_device.h
+  * @brief   Remplaçant hôte de usb_device.h pour tools/bulk_test.
+  ******************************************************************************
+  */
+#ifndef __USB_DEVICE__H__
+#define __USB_DEVICE__H__
+
+#include "usbd_composite.h"
+
+#endif /* __USB_DEVICE__H__ */
@@ -0,0 +1,34 @@
+/**
+  ******************************************************************************
+  * @file    usbd_composite.h
+  * @brief   Remplaçant hôte de usbd_composite.h pour tools/bulk_test : seule
+  *          l'interface vendeur est déclarée, bulk_test.c la simule.
+  ******************************************************************************
+  */
+#ifndef __USBD_COMPOSITE_H__
+#define __USBD_COMPOSITE_H__
+
+#include "main.h"
+
+#define USBD_OK                         0U
+#define USBD_BUSY                       1U
+#define USBD_FAIL                       3U
+
+#define COMPOSITE_VENDOR_PACKET_SIZE    64U
+
+typedef struct {
+	uint8_t configured;
+} USBD_HandleTypeDef;
+
+typedef struct
+{
+  int8_t (*Init)(void);
+  int8_t (*DeInit)(void);
+  int8_t (*Receive)(uint8_t *buf, uint32_t len);
+  int8_t (*TransmitCplt)(void);
+} USBD_Vendor_ItfTypeDef;
+
+uint8_t USBD_Composite_VendorReceive(USBD_HandleTypeDef *pdev, uint8_t *buf, uint16_t len);
+uint8_t USBD_Composite_VendorTransmit(USBD_HandleTypeDef *pdev, uint8_t *buf, uint16_t len);
+
+#endif /* __USBD_COMPOSITE_H__ */